@@ -0,0 +1,45 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "allocator/stl_arena_alloc.h"
+#include "container/list.h"
+#include "container/slist.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("arena vs pool for request-scoped lists", "[!benchmark][stl_arena_alloc]") {
+    const int n = 1000000;
+    monotonic_arena arena;
+
+    BENCHMARK("build and destroy 1M-node list, alloc") {
+        list<int, alloc> l;
+        for (int i = 0; i < n; ++i) l.push_back(i);
+        return l.back();
+    };
+    BENCHMARK("build and destroy 1M-node list, arena") {
+        int back;
+        {
+            list<int, arena_allocator<int>> l(arena);
+            for (int i = 0; i < n; ++i) l.push_back(i);
+            back = l.back();
+        }
+        arena.reset();
+        return back;
+    };
+    BENCHMARK("build and destroy 1M-node slist, alloc") {
+        slist<int, alloc> l;
+        for (int i = 0; i < n; ++i) l.push_front(i);
+        return l.front();
+    };
+    BENCHMARK("build and destroy 1M-node slist, arena") {
+        int front;
+        {
+            slist<int, arena_allocator<int>> l(arena);
+            for (int i = 0; i < n; ++i) l.push_front(i);
+            front = l.front();
+        }
+        arena.reset();
+        return front;
+    };
+}
+
+SHADOW_STL_END_NAMESPACE
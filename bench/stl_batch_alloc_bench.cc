@@ -0,0 +1,42 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "container/list.h"
+#include "container/slist.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("bulk node inserts", "[!benchmark][stl_batch_alloc]") {
+    const int n = 1000000;
+    vector<int> src;
+    for (int i = 0; i < n; ++i) src.push_back(i);
+
+    BENCHMARK("1M-node list, push_back loop") {
+        list<int> l;
+        for (int i = 0; i < n; ++i) l.push_back(i);
+        return l.back();
+    };
+    BENCHMARK("1M-node list, range insert") {
+        list<int> l;
+        l.insert(l.end(), src.begin(), src.end());
+        return l.back();
+    };
+    BENCHMARK("1M-node list, fill insert") {
+        list<int> l;
+        l.insert(l.end(), n, 1);
+        return l.back();
+    };
+    BENCHMARK("1M-node slist, insert_after loop") {
+        slist<int> l;
+        slist<int>::iterator pos = l.before_begin();
+        for (int i = 0; i < n; ++i) pos = l.insert_after(pos, i);
+        return *pos;
+    };
+    BENCHMARK("1M-node slist, range insert") {
+        slist<int> l;
+        l.insert_after(l.before_begin(), src.begin(), src.end());
+        return l.front();
+    };
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,53 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "algorithm/stl_algobase.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+struct quad {
+    int a, b, c, d;
+};
+
+// The element-by-element loop fill used before the vector kernels.
+template <typename E>
+E* loop_fill(E* first, size_t n, const E& value) {
+    _fill_ptr(first, first + n, value, _false_type());
+    return first;
+}
+
+template <typename E>
+void fill_sizes(const char* type, const E& value) {
+    static const size_t sizes[] = {16, 256, 4 << 10, 64 << 10, 1 << 20, 16 << 20, 256 << 20,
+                                   1 << 30};
+    char name[96];
+    for (size_t bytes : sizes) {
+        const size_t n = bytes / sizeof(E);
+        E* buf = (E*)malloc(bytes);
+        memset(buf, 0, bytes);
+        const char* unit = bytes >= (1 << 20) ? "MB" : bytes >= 1024 ? "KB" : "B";
+        const size_t scaled = bytes >= (1 << 20) ? bytes >> 20 : bytes >= 1024 ? bytes >> 10 : bytes;
+        snprintf(name, sizeof name, "%zu %s of %s, loop", scaled, unit, type);
+        BENCHMARK(name) {
+            return loop_fill(buf, n, value);
+        };
+        snprintf(name, sizeof name, "%zu %s of %s, fill_n", scaled, unit, type);
+        BENCHMARK(name) {
+            return fill_n(buf, n, value);
+        };
+        free(buf);
+    }
+}
+}
+
+TEST_CASE("fill", "[!benchmark][stl_fill]") {
+    fill_sizes<short>("shorts", 0x1234);
+    fill_sizes<int>("ints", 0x12345678);
+    fill_sizes<double>("doubles", 2.25);
+    fill_sizes<quad>("16-byte PODs", quad{1, 2, 3, 4});
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,241 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <stdlib.h>
+#include <vector>
+#include "container/intrusive_list.h"
+#include "container/intrusive_slist.h"
+#include "container/list.h"
+#include "container/slist.h"
+#include "container/ulist.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+// A bounded request queue: every enqueue first checks the length.
+template <typename Length>
+size_t admit(int requests, size_t limit, Length length) {
+    list<int> queue;
+    size_t rejected = 0;
+    for (int i = 0; i < requests; ++i) {
+        if (length(queue) < limit) {
+            queue.push_back(i);
+        } else {
+            ++rejected;
+            queue.pop_front();
+        }
+    }
+    return rejected;
+}
+}
+
+TEST_CASE("list size", "[!benchmark][stl_list]") {
+    list<int> l(1000000, 1);
+    BENCHMARK("size() of a 1M-node list") {
+        return l.size();
+    };
+    BENCHMARK("walk over a 1M-node list (size() before)") {
+        return distance(l.begin(), l.end());
+    };
+
+    const int requests = 100000;
+    BENCHMARK("100k enqueues on a 1000-deep queue, size()") {
+        return admit(requests, 1000, [](const list<int>& q) { return q.size(); });
+    };
+    BENCHMARK("100k enqueues on a 1000-deep queue, walk") {
+        return admit(requests, 1000, [](const list<int>& q) {
+            return (size_t)distance(q.begin(), q.end());
+        });
+    };
+}
+
+namespace {
+template <typename List>
+List random_ints(int n) {
+    List l;
+    srand(1);
+    for (int i = 0; i < n; ++i) l.push_back(rand());
+    return l;
+}
+
+template <typename List>
+long sum(const List& l) {
+    long total = 0;
+    for (typename List::const_iterator i = l.begin(); i != l.end(); ++i) total += *i;
+    return total;
+}
+
+// Inserts n ints before an iterator that stays in the middle.
+template <typename List>
+size_t insert_middle(int n) {
+    List l(1000, 0);
+    typename List::iterator mid = l.begin();
+    for (int i = 0; i < 500; ++i) ++mid;
+    for (int i = 0; i < n; ++i) {
+        mid = l.insert(mid, i);
+        if (i % 2) ++mid;
+    }
+    return l.size();
+}
+}
+
+TEST_CASE("ulist against list", "[!benchmark][stl_list]") {
+    const int n = 1000000;
+    const list<int> l = random_ints<list<int>>(n);
+    const ulist<int> u = random_ints<ulist<int>>(n);
+    BENCHMARK("sum 1M ints, list") {
+        return sum(l);
+    };
+    BENCHMARK("sum 1M ints, ulist") {
+        return sum(u);
+    };
+
+    BENCHMARK("sort 1M random ints, list") {
+        list<int> c(l);
+        c.sort();
+        return c.front();
+    };
+    BENCHMARK("sort 1M random ints, ulist") {
+        ulist<int> c(u);
+        c.sort();
+        return c.front();
+    };
+
+    BENCHMARK("push_back 1M ints, list") {
+        list<int> c;
+        for (int i = 0; i < n; ++i) c.push_back(i);
+        return c.size();
+    };
+    BENCHMARK("push_back 1M ints, ulist") {
+        ulist<int> c;
+        for (int i = 0; i < n; ++i) c.push_back(i);
+        return c.size();
+    };
+    BENCHMARK("insert 1M ints mid-list, list") {
+        return insert_middle<list<int>>(n);
+    };
+    BENCHMARK("insert 1M ints mid-list, ulist") {
+        return insert_middle<ulist<int>>(n);
+    };
+}
+
+TEST_CASE("list sort", "[!benchmark][stl_list]") {
+    // Nodes allocated in order sit next to each other in memory; after
+    // one sort by value, walking the list jumps around.
+    list<int> l = random_ints<list<int>>(4000000);
+    list<int> scattered(l);
+    scattered.sort();
+    for (int& x : scattered) x = rand();
+    slist<int> s;
+    for (int x : l) s.push_front(x);
+
+    BENCHMARK("sort 4M random ints, list") {
+        list<int> c(l);
+        c.sort();
+        return c.front();
+    };
+    BENCHMARK("sort 4M random ints, list with scattered nodes") {
+        scattered.sort([](int a, int b) { return a > b; });
+        return scattered.front();
+    };
+    BENCHMARK("sort 4M random ints, slist") {
+        slist<int> c(s);
+        c.sort();
+        return c.front();
+    };
+    BENCHMARK("parallel_sort 4M random ints, list with scattered nodes") {
+        scattered.parallel_sort([](int a, int b) { return a < b; });
+        return scattered.front();
+    };
+    BENCHMARK("parallel_sort 4M random ints, slist") {
+        slist<int> c(s);
+        c.parallel_sort();
+        return c.front();
+    };
+}
+
+namespace {
+// Pooled requests, passed between queues.  The allocating containers
+// hold pointers to them.
+struct request {
+    int id;
+    list_hook queue_hook;
+    slist_hook free_hook;
+};
+
+// Moves every request through a queue, round by round: the front one is
+// taken off and requeued at the back.
+template <typename Push, typename Pop>
+long cycle(std::vector<request>& pool, int rounds, Push push, Pop pop) {
+    long total = 0;
+    for (request& r : pool) push(r);
+    for (int i = 0; i < rounds; ++i) {
+        request& r = pop();
+        total += r.id;
+        push(r);
+    }
+    for (size_t i = 0; i < pool.size(); ++i) pop();
+    return total;
+}
+
+// A free list: every round takes two requests and gives them back in
+// the other order.
+template <typename Push, typename Pop>
+long reuse(std::vector<request>& pool, int rounds, Push push, Pop pop) {
+    long total = 0;
+    for (request& r : pool) push(r);
+    for (int i = 0; i < rounds; ++i) {
+        request& a = pop();
+        request& b = pop();
+        total += a.id - b.id;
+        push(a);
+        push(b);
+    }
+    for (size_t i = 0; i < pool.size(); ++i) pop();
+    return total;
+}
+}
+
+TEST_CASE("intrusive lists against allocating lists", "[!benchmark][stl_list]") {
+    std::vector<request> pool(1000);
+    for (int i = 0; i < 1000; ++i) pool[i].id = i;
+    const int rounds = 10000000;
+
+    BENCHMARK("10M requeues over 1000 requests, list<request*>") {
+        list<request*> q;
+        return cycle(pool, rounds, [&q](request& r) { q.push_back(&r); },
+                     [&q]() -> request& {
+                         request* r = q.front();
+                         q.pop_front();
+                         return *r;
+                     });
+    };
+    BENCHMARK("10M requeues over 1000 requests, intrusive_list") {
+        intrusive_list<request, &request::queue_hook> q;
+        return cycle(pool, rounds, [&q](request& r) { q.push_back(r); },
+                     [&q]() -> request& {
+                         request& r = q.front();
+                         q.pop_front();
+                         return r;
+                     });
+    };
+    BENCHMARK("10M double reuses over 1000 requests, slist<request*>") {
+        slist<request*> q;
+        return reuse(pool, rounds, [&q](request& r) { q.push_front(&r); },
+                     [&q]() -> request& {
+                         request* r = q.front();
+                         q.pop_front();
+                         return *r;
+                     });
+    };
+    BENCHMARK("10M double reuses over 1000 requests, intrusive_slist") {
+        intrusive_slist<request, &request::free_hook> q;
+        return reuse(pool, rounds, [&q](request& r) { q.push_front(r); },
+                     [&q]() -> request& {
+                         request& r = q.front();
+                         q.pop_front();
+                         return r;
+                     });
+    };
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,45 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "allocator/stl_lockfree_alloc.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// Each thread allocates and frees a window of objects spread over all
+// 16 size classes.
+template <typename Alloc>
+static void size_class_churn(int nthreads, int rounds) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([rounds]() {
+            void* window[32];
+            for (int r = 0; r < rounds; ++r) {
+                for (int i = 0; i < 32; ++i) {
+                    window[i] = Alloc::allocate(8 * (1 + (i & 15)));
+                }
+                for (int i = 0; i < 32; ++i) {
+                    Alloc::deallocate(window[i], 8 * (1 + (i & 15)));
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+}
+
+TEST_CASE("lock-free free lists", "[!benchmark][stl_lockfree_alloc]") {
+    const int rounds = 4000;
+    for (int nthreads : {1, 4, 16, 32}) {
+        std::string suffix = " x" + std::to_string(nthreads) + " threads";
+        BENCHMARK(("mutex free lists" + suffix).c_str()) {
+            size_class_churn<alloc>(nthreads, rounds);
+        };
+        BENCHMARK(("lock-free free lists" + suffix).c_str()) {
+            size_class_churn<lockfree_alloc>(nthreads, rounds);
+        };
+    }
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,122 @@
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "allocator/stl_mmap_alloc.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// A single hardware or software counter of the calling thread.  Opening
+// fails without CAP_PERFMON or with a restrictive perf_event_paranoid;
+// the counter then reads as unavailable.
+class perf_counter {
+public:
+    perf_counter(uint32_t type, uint64_t config) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        _M_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if (_M_fd < 0 && type == PERF_TYPE_SOFTWARE) {
+            // Page faults are counted in the kernel.
+            attr.exclude_kernel = 0;
+            _M_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+    }
+    perf_counter(const perf_counter&) = delete;
+    ~perf_counter() { if (_M_fd >= 0) close(_M_fd); }
+
+    void start() {
+        if (_M_fd < 0) return;
+        ioctl(_M_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(_M_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    long long stop() {
+        long long count = -1;
+        if (_M_fd < 0) return count;
+        ioctl(_M_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(_M_fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+        return count;
+    }
+
+private:
+    int _M_fd;
+};
+
+static perf_counter dtlb_misses() {
+    return perf_counter(PERF_TYPE_HW_CACHE,
+                        PERF_COUNT_HW_CACHE_DTLB |
+                        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+}
+
+static perf_counter page_faults() {
+    return perf_counter(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+}
+
+static void print_count(const char* what, const char* name, long long count) {
+    if (count < 0) {
+        printf("  %-16s %-14s unavailable\n", what, name);
+    } else {
+        printf("  %-16s %-14s %lld\n", what, name, count);
+    }
+}
+
+// Fills a 1G vector, then reads it at random.  The page faults of the
+// fill and the dTLB misses of the reads are reported per allocator.
+template <typename Alloc>
+static void tlb_report(const char* name) {
+    const size_t n = (size_t)1 << 27;   // 1G of longs
+    perf_counter faults = page_faults();
+    perf_counter misses = dtlb_misses();
+
+    faults.start();
+    vector<long, Alloc> v(n, 1L);
+    long long nfaults = faults.stop();
+
+    misses.start();
+    long sum = 0;
+    size_t i = 12345;
+    for (int k = 0; k < 1 << 24; ++k) {
+        i = (i * 6364136223846793005ULL + 1442695040888963407ULL) & (n - 1);
+        sum += v[i];
+    }
+    long long nmisses = misses.stop();
+
+    print_count("page faults", name, nfaults);
+    print_count("dTLB misses", name, nmisses);
+    REQUIRE(sum == 1 << 24);
+}
+
+TEST_CASE("huge pages", "[!benchmark][stl_mmap_alloc]") {
+    printf("1G vector, fill then 16M random reads:\n");
+    tlb_report<malloc_alloc>("malloc_alloc");
+    tlb_report<mmap_alloc>("mmap_alloc");
+    tlb_report<huge_page_alloc>("huge_page_alloc");
+
+    const size_t n = (size_t)1 << 24;
+    BENCHMARK("fill 128M vector, malloc_alloc") {
+        vector<long, malloc_alloc> v(n, 1L);
+        return v[n - 1];
+    };
+    BENCHMARK("fill 128M vector, mmap_alloc") {
+        vector<long, mmap_alloc> v(n, 1L);
+        return v[n - 1];
+    };
+    BENCHMARK("fill 128M vector, huge_page_alloc") {
+        vector<long, huge_page_alloc> v(n, 1L);
+        return v[n - 1];
+    };
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,97 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "allocator/stl_pthread_alloc.h"
+#include "container/list.h"
+#include "container/slist.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// Every thread repeatedly grabs a window of node-sized objects and
+// releases it again, which is what a busy list/slist does to the node
+// allocator.
+template <typename Alloc>
+static void alloc_churn(int nthreads, int rounds) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([rounds]() {
+            void* window[64];
+            for (int r = 0; r < rounds; ++r) {
+                for (int i = 0; i < 64; ++i) {
+                    window[i] = Alloc::allocate(24 + 8 * (i & 3));
+                }
+                for (int i = 0; i < 64; ++i) {
+                    Alloc::deallocate(window[i], 24 + 8 * (i & 3));
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+}
+
+template <typename Alloc>
+static void list_churn(int nthreads, int rounds) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([rounds]() {
+            list<int, Alloc> l;
+            slist<long, Alloc> sl;
+            for (int r = 0; r < rounds; ++r) {
+                for (int i = 0; i < 64; ++i) {
+                    l.push_back(i);
+                    sl.push_front(i);
+                }
+                l.clear();
+                sl.clear();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+}
+
+TEST_CASE("node allocator contention", "[!benchmark][stl_pthread_alloc]") {
+    const int rounds = 2000;
+    for (int nthreads : {1, 4, 32}) {
+        std::string suffix = " x" + std::to_string(nthreads) + " threads";
+        BENCHMARK(("alloc churn, locked alloc" + suffix).c_str()) {
+            alloc_churn<alloc>(nthreads, rounds);
+        };
+        BENCHMARK(("alloc churn, pthread_alloc" + suffix).c_str()) {
+            alloc_churn<pthread_alloc>(nthreads, rounds);
+        };
+        BENCHMARK(("list/slist churn, locked alloc" + suffix).c_str()) {
+            list_churn<alloc>(nthreads, rounds);
+        };
+        BENCHMARK(("list/slist churn, pthread_alloc" + suffix).c_str()) {
+            list_churn<pthread_alloc>(nthreads, rounds);
+        };
+    }
+}
+
+TEST_CASE("node allocator lock policies", "[!benchmark][stl_pthread_alloc]") {
+    const int rounds = 2000;
+    using Mutex = _default_alloc_template<true, 10, _Default_size_classes, _Shadow_STL_mutex_lock>;
+    using Adaptive = _default_alloc_template<true, 10, _Default_size_classes, _Shadow_STL_adaptive_lock<>>;
+    using Ticket = _default_alloc_template<true, 10, _Default_size_classes, _Shadow_STL_ticket_lock<>>;
+    using Mcs = _default_alloc_template<true, 10, _Default_size_classes, _Shadow_STL_mcs_lock<>>;
+    for (int nthreads : {1, 4}) {
+        std::string suffix = " x" + std::to_string(nthreads) + " threads";
+        BENCHMARK(("alloc churn, pthread mutex" + suffix).c_str()) {
+            alloc_churn<Mutex>(nthreads, rounds);
+        };
+        BENCHMARK(("alloc churn, spin-then-park" + suffix).c_str()) {
+            alloc_churn<Adaptive>(nthreads, rounds);
+        };
+        BENCHMARK(("alloc churn, ticket" + suffix).c_str()) {
+            alloc_churn<Ticket>(nthreads, rounds);
+        };
+        BENCHMARK(("alloc churn, MCS" + suffix).c_str()) {
+            alloc_churn<Mcs>(nthreads, rounds);
+        };
+    }
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,157 @@
+#include <pthread.h>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include "include/stl_threads.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// The mutex-per-count scheme _Refcount_Base used to implement, kept
+// for comparison.
+struct mutex_refcount {
+    size_t _M_ref_count;
+    pthread_mutex_t _M_lock;
+    mutex_refcount(size_t n) : _M_ref_count(n) { pthread_mutex_init(&_M_lock, nullptr); }
+    void _M_incr() {
+        pthread_mutex_lock(&_M_lock);
+        ++_M_ref_count;
+        pthread_mutex_unlock(&_M_lock);
+    }
+    size_t _M_decr() {
+        pthread_mutex_lock(&_M_lock);
+        size_t tmp = --_M_ref_count;
+        pthread_mutex_unlock(&_M_lock);
+        return tmp;
+    }
+};
+
+// nthreads threads increment and decrement rounds times each; shared
+// decides whether they all use the same count or one count apiece.
+template <typename Count>
+static size_t refcount_churn(int nthreads, int rounds, bool shared) {
+    std::vector<Count*> counts;
+    for (int t = 0; t < nthreads; ++t) {
+        counts.push_back(shared && t > 0 ? counts[0] : new Count(1));
+    }
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        Count* c = counts[t];
+        threads.emplace_back([c, rounds]() {
+            for (int r = 0; r < rounds; ++r) {
+                c->_M_incr();
+                c->_M_decr();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    size_t result = counts[0]->_M_ref_count;
+    for (int t = 0; t < nthreads; ++t) {
+        if (!shared || t == 0) delete counts[t];
+    }
+    return result;
+}
+
+TEST_CASE("refcount increments", "[!benchmark][stl_threads]") {
+    const int rounds = 1000000;
+
+    BENCHMARK("uncontended, 1 thread, mutex") {
+        mutex_refcount c(1);
+        for (int r = 0; r < rounds; ++r) {
+            c._M_incr();
+            c._M_decr();
+        }
+        return c._M_ref_count;
+    };
+    BENCHMARK("uncontended, 1 thread, atomic") {
+        _Refcount_Base c(1);
+        for (int r = 0; r < rounds; ++r) {
+            c._M_incr();
+            c._M_decr();
+        }
+        return (size_t)c._M_ref_count;
+    };
+    BENCHMARK("uncontended, 4 threads with own counts, mutex") {
+        return refcount_churn<mutex_refcount>(4, rounds, false);
+    };
+    BENCHMARK("uncontended, 4 threads with own counts, atomic") {
+        return refcount_churn<_Refcount_Base>(4, rounds, false);
+    };
+    BENCHMARK("contended, 4 threads on one count, mutex") {
+        return refcount_churn<mutex_refcount>(4, rounds, true);
+    };
+    BENCHMARK("contended, 4 threads on one count, atomic") {
+        return refcount_churn<_Refcount_Base>(4, rounds, true);
+    };
+}
+
+TEST_CASE("atomic swap", "[!benchmark][stl_threads]") {
+    const int rounds = 1000000;
+
+    BENCHMARK("_Atomic_swap, 4 threads on one word") {
+        unsigned long word = 0;
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&word, rounds]() {
+                for (int r = 0; r < rounds; ++r) _Atomic_swap(&word, (unsigned long)r);
+            });
+        }
+        for (auto& th : threads) th.join();
+        return word;
+    };
+    BENCHMARK("_Atomic_swap, 4 threads on their own words") {
+        unsigned long words[4 * 8] = {};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            unsigned long* w = &words[t * 8];
+            threads.emplace_back([w, rounds]() {
+                for (int r = 0; r < rounds; ++r) _Atomic_swap(w, (unsigned long)r);
+            });
+        }
+        for (auto& th : threads) th.join();
+        return words[0];
+    };
+}
+
+// nthreads threads each enter a critical section of a few pointer
+// swaps rounds times.
+template <typename Lock>
+static long lock_churn(int nthreads, int rounds) {
+    static Lock lock;
+    static void* slots[4];
+    long entered = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nthreads; ++t) {
+        threads.emplace_back([rounds, &entered]() {
+            for (int r = 0; r < rounds; ++r) {
+                _Shadow_STL_auto_lock<Lock> guard(lock);
+                void* tmp = slots[r & 3];
+                slots[r & 3] = slots[(r + 1) & 3];
+                slots[(r + 1) & 3] = tmp;
+                ++entered;
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    return entered;
+}
+
+TEST_CASE("internal locks", "[!benchmark][stl_threads]") {
+    const int rounds = 250000;
+
+    BENCHMARK("4 threads, pthread mutex") {
+        return lock_churn<_Shadow_STL_mutex_lock>(4, rounds);
+    };
+    BENCHMARK("4 threads, spin-then-park") {
+        return lock_churn<_Shadow_STL_adaptive_lock<>>(4, rounds);
+    };
+    BENCHMARK("4 threads, ticket") {
+        return lock_churn<_Shadow_STL_ticket_lock<>>(4, rounds);
+    };
+    BENCHMARK("4 threads, MCS") {
+        return lock_churn<_Shadow_STL_mcs_lock<>>(4, rounds);
+    };
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,244 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <utility>
+#include "container/small_vector.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+long copies = 0;
+long allocations = 0;
+
+char* counted_strdup(const char* s) {
+    ++allocations;
+    return strdup(s);
+}
+
+// Records owning a heap buffer.  copy_only_record is written like a
+// pre-C++11 class, movable_record also has (noexcept) move operations.
+struct copy_only_record {
+    char* text;
+
+    copy_only_record(const char* t) : text(counted_strdup(t)) {}
+    copy_only_record(const copy_only_record& x) : text(counted_strdup(x.text)) { ++copies; }
+    copy_only_record& operator=(const copy_only_record& x) {
+        if (this != &x) {
+            free(text);
+            text = counted_strdup(x.text);
+            ++copies;
+        }
+        return *this;
+    }
+    ~copy_only_record() { free(text); }
+};
+
+struct movable_record {
+    char* text;
+
+    movable_record(const char* t) : text(counted_strdup(t)) {}
+    movable_record(const movable_record& x) : text(counted_strdup(x.text)) { ++copies; }
+    movable_record(movable_record&& x) noexcept : text(x.text) { x.text = nullptr; }
+    movable_record& operator=(const movable_record& x) {
+        if (this != &x) {
+            free(text);
+            text = counted_strdup(x.text);
+            ++copies;
+        }
+        return *this;
+    }
+    movable_record& operator=(movable_record&& x) noexcept {
+        std::swap(text, x.text);
+        return *this;
+    }
+    ~movable_record() { free(text); }
+};
+
+// movable_record relocated with memcpy.
+struct relocatable_record : movable_record {
+    using movable_record::movable_record;
+};
+}
+
+template <>
+struct _Is_trivially_relocatable<relocatable_record> {
+    using _Relocatable = _true_type;
+};
+
+namespace {
+const char* const text = "a record of sixty-four bytes, more than any small string buffer";
+
+// An int without trivial copies, so that vector relocates it element by
+// element.
+struct boxed_int {
+    int value;
+    boxed_int(int v) : value(v) {}
+    boxed_int(const boxed_int& x) : value(x.value) {}
+    boxed_int& operator=(const boxed_int& x) {
+        value = x.value;
+        return *this;
+    }
+};
+
+// Appends n records, then inserts 100 at the front.
+template <typename Record>
+size_t build(int n) {
+    vector<Record> v;
+    for (int i = 0; i < n; ++i) v.push_back(Record(text));
+    for (int i = 0; i < 100; ++i) v.insert(v.begin(), Record(text));
+    return v.size();
+}
+
+template <typename Record>
+void report(const char* name, int n) {
+    copies = allocations = 0;
+    build<Record>(n);
+    printf("  %-18s %10ld copies %10ld allocations\n", name, copies, allocations);
+}
+}
+
+TEST_CASE("vector element moves", "[!benchmark][stl_vector]") {
+    const int n = 100000;
+    printf("100k push_backs and 100 front inserts:\n");
+    report<copy_only_record>("copy-only record", n);
+    report<movable_record>("movable record", n);
+    report<relocatable_record>("relocatable record", n);
+
+    BENCHMARK("100k records, copy-only") {
+        return build<copy_only_record>(n);
+    };
+    BENCHMARK("100k records, movable") {
+        return build<movable_record>(n);
+    };
+    BENCHMARK("100k records, trivially relocatable") {
+        return build<relocatable_record>(n);
+    };
+}
+
+TEST_CASE("vector append growth", "[!benchmark][stl_vector]") {
+    const int n = 100000000;
+    BENCHMARK("append 100M ints, reallocate") {
+        vector<int> v;
+        for (int i = 0; i < n; ++i) v.push_back(i);
+        return v.back();
+    };
+    BENCHMARK("append 100M ints, copy") {
+        vector<boxed_int> v;
+        for (int i = 0; i < n; ++i) v.push_back(i);
+        return v.back().value;
+    };
+}
+
+// Capacity left unused, in percent of the elements stored, over
+// vectors of 1000 sizes spread from 1 to about 10M.
+template <typename Growth>
+static void overhead_report(const char* name) {
+    size_t used = 0, reserved = 0;
+    size_t n = 1;
+    for (int k = 0; k < 1000; ++k) {
+        vector<int, alloc, Growth> v;
+        for (size_t i = 0; i < n; ++i) v.push_back(0);
+        used += v.size();
+        reserved += v.capacity();
+        n = n * 1017 / 1000 + 1;
+        if (n > 10000000) n = 1 + k;
+    }
+    printf("  %-22s %5.1f%% unused\n", name, 100.0 * (reserved - used) / used);
+}
+
+template <typename Growth>
+static size_t push_ints(size_t n) {
+    vector<int, alloc, Growth> v;
+    for (size_t i = 0; i < n; ++i) v.push_back((int)i);
+    return v.size();
+}
+
+TEST_CASE("vector growth policies", "[!benchmark][stl_vector]") {
+    printf("vector growth, memory overhead:\n");
+    overhead_report<grow_by_doubling>("grow_by_doubling");
+    overhead_report<grow_by_half>("grow_by_half");
+    overhead_report<grow_to_fit_allocator>("grow_to_fit_allocator");
+
+    const size_t n = 10000000;
+    BENCHMARK("push_back 10M ints, grow_by_doubling") {
+        return push_ints<grow_by_doubling>(n);
+    };
+    BENCHMARK("push_back 10M ints, grow_by_half") {
+        return push_ints<grow_by_half>(n);
+    };
+    BENCHMARK("push_back 10M ints, grow_to_fit_allocator") {
+        return push_ints<grow_to_fit_allocator>(n);
+    };
+    BENCHMARK("push_back 1000x16 ints, grow_by_doubling") {
+        size_t total = 0;
+        for (int i = 0; i < 1000; ++i) total += push_ints<grow_by_doubling>(16);
+        return total;
+    };
+    BENCHMARK("push_back 1000x16 ints, grow_to_fit_allocator") {
+        size_t total = 0;
+        for (int i = 0; i < 1000; ++i) total += push_ints<grow_to_fit_allocator>(16);
+        return total;
+    };
+}
+
+// Builds count short-lived vectors of 1 to max_len ints.
+template <typename Vector>
+static long short_lived(int count, int max_len) {
+    long total = 0;
+    for (int i = 0; i < count; ++i) {
+        Vector v;
+        const int len = 1 + i % max_len;
+        for (int j = 0; j < len; ++j) v.push_back(j);
+        total += v.back();
+    }
+    return total;
+}
+
+TEST_CASE("small_vector against vector", "[!benchmark][stl_vector]") {
+    const int n = 1000000;
+    BENCHMARK("1M vectors of 1-8 ints, vector") {
+        return short_lived<vector<int>>(n, 8);
+    };
+    BENCHMARK("1M vectors of 1-8 ints, small_vector<int, 8>") {
+        return short_lived<small_vector<int, 8>>(n, 8);
+    };
+    BENCHMARK("1M vectors of 1-32 ints, vector") {
+        return short_lived<vector<int>>(n, 32);
+    };
+    BENCHMARK("1M vectors of 1-32 ints, small_vector<int, 8>") {
+        return short_lived<small_vector<int, 8>>(n, 32);
+    };
+}
+
+// An I/O buffer sized, then filled by read().
+TEST_CASE("vector default-initialization", "[!benchmark][stl_vector]") {
+    const size_t n = 256 << 20;
+    const int fd = open("/dev/zero", O_RDONLY);
+    REQUIRE(fd >= 0);
+    BENCHMARK("256 MB buffer, vector(n) then read") {
+        vector<char> buf(n);
+        return read(fd, &buf[0], n);
+    };
+    BENCHMARK("256 MB buffer, vector(n, default_init) then read") {
+        vector<char> buf(n, default_init);
+        return read(fd, &buf[0], n);
+    };
+    BENCHMARK("256 MB buffer, resize(n) then read") {
+        vector<char> buf;
+        buf.resize(n);
+        return read(fd, &buf[0], n);
+    };
+    BENCHMARK("256 MB buffer, resize_default_init(n) then read") {
+        vector<char> buf;
+        buf.resize_default_init(n);
+        return read(fd, &buf[0], n);
+    };
+    close(fd);
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -17,11 +17,16 @@
 #include "iterator/stl_iterator_base.h"
 #endif // SHADOW_STL_INTERNAL_ITERATOR_H
 
+#ifndef SHADOW_STL_INTERNAL_SIMD_FILL_H
+#include "algorithm/stl_simd_fill.h"
+#endif // SHADOW_STL_INTERNAL_SIMD_FILL_H
+
 #include <cstring>
 #include <climits>
 #include <cstddef>
 #include <cstdlib>
 #include <new>
+#include <utility>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -29,9 +34,9 @@ SHADOW_STL_BEGIN_NAMESPACE
 // swap an iter_swap
 template <typename ForwardIter1, typename ForwardIter2, typename T>
 inline void _iter_swap(ForwardIter1 a, ForwardIter2 b, T*) {
-    T tmp = *a;
-    *a = *b;
-    *b = tmp;
+    T tmp = std::move(*a);
+    *a = std::move(*b);
+    *b = std::move(tmp);
 }
 
 template <typename ForwardIter1, typename ForwardIter2>
@@ -41,9 +46,9 @@ inline void iter_swap(ForwardIter1 a, ForwardIter2 b) {
 
 template <typename T>
 inline void swap(T& a, T& b) {
-    T tmp = a;
-    a = b;
-    b = tmp;
+    T tmp = std::move(a);
+    a = std::move(b);
+    b = std::move(tmp);
 }
 
 //--------------------------------------------------
@@ -137,7 +142,8 @@ static OutputIter copy(InputIter first, InputIter last, OutputIter result) {
 
 template <typename T>
 static T* copy(const T* first, const T* last, T* result) {
-    return _copy_trivial(first, last, result);
+    using Trivial = typename _type_traits<T>::has_trivial_assignment_operator;
+    return _copy_aux2(first, last, result, Trivial());
 }
 
 //--------------------------------------------------
@@ -163,6 +169,66 @@ inline BidirectionalIter2 copy_backward(BidirectionalIter1 first, BidirectionalI
     return _copy_backward(first, last, result, iterator_category(first), distance_type(first));
 }
 
+//--------------------------------------------------
+// move and move_backward
+// copy and copy_backward with move assignment.  Elements with trivial
+// assignment are still memmoved.
+template <typename InputIter, typename OutputIter>
+inline OutputIter move(InputIter first, InputIter last, OutputIter result) {
+    for (; first != last; ++first, ++result) {
+        *result = std::move(*first);
+    }
+    return result;
+}
+
+template <typename T>
+inline T* _move_aux(T* first, T* last, T* result, _false_type) {
+    for (; first != last; ++first, ++result) {
+        *result = std::move(*first);
+    }
+    return result;
+}
+
+template <typename T>
+inline T* _move_aux(T* first, T* last, T* result, _true_type) {
+    return _copy_trivial(first, last, result);
+}
+
+template <typename T>
+inline T* move(T* first, T* last, T* result) {
+    using Trivial = typename _type_traits<T>::has_trivial_assignment_operator;
+    return _move_aux(first, last, result, Trivial());
+}
+
+template <typename BidirectionalIter1, typename BidirectionalIter2>
+inline BidirectionalIter2 move_backward(BidirectionalIter1 first, BidirectionalIter1 last, BidirectionalIter2 result) {
+    while (first != last) {
+        *--result = std::move(*--last);
+    }
+    return result;
+}
+
+template <typename T>
+inline T* _move_backward_aux(T* first, T* last, T* result, _false_type) {
+    while (first != last) {
+        *--result = std::move(*--last);
+    }
+    return result;
+}
+
+template <typename T>
+inline T* _move_backward_aux(T* first, T* last, T* result, _true_type) {
+    const ptrdiff_t n = last - first;
+    memmove(result - n, first, sizeof(T) * n);
+    return result - n;
+}
+
+template <typename T>
+inline T* move_backward(T* first, T* last, T* result) {
+    using Trivial = typename _type_traits<T>::has_trivial_assignment_operator;
+    return _move_backward_aux(first, last, result, Trivial());
+}
+
 //--------------------------------------------------
 // copy_n (not part of the C++ standard)
 template <typename InputIter, typename Size, typename OutputIter>
@@ -235,6 +301,50 @@ inline char* fill_n(char* first, Size count, const char& c) {
     return first + count;
 }
 
+// Filling pointers to trivially copyable types of 2 to 16 bytes (and
+// single bytes other than chars) stores T(value) as bytes, with
+// vector instructions (see stl_simd_fill.h).  That is what assigning
+// value does when it is a T, or when both are arithmetic types.
+template <typename T, typename U>
+struct _Is_simd_fillable {
+    using _Tp = std::remove_cv_t<U>;
+    static const bool _S_value =
+        std::is_trivially_copyable<T>::value && std::is_trivially_copy_assignable<T>::value &&
+        !std::is_volatile<T>::value &&
+        (std::is_same<T, _Tp>::value ||
+         (std::is_arithmetic<T>::value && std::is_arithmetic<_Tp>::value)) &&
+        (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8 ||
+         sizeof(T) == 16);
+    using _Fillable = std::conditional_t<_S_value, _true_type, _false_type>;
+};
+
+template <typename T, typename U>
+inline void _fill_ptr(T* first, T* last, const U& value, _true_type) {
+    const T tmp = value;
+    _Simd_fill::_S_fill(first, &tmp, sizeof(T), (last - first) * sizeof(T));
+}
+
+template <typename T, typename U>
+inline void _fill_ptr(T* first, T* last, const U& value, _false_type) {
+    for (; first != last; ++first) {
+        *first = value;
+    }
+}
+
+template <typename T, typename U>
+inline void fill(T* first, T* last, const U& value) {
+    _fill_ptr(first, last, value, typename _Is_simd_fillable<T, U>::_Fillable());
+}
+
+template <typename T, typename Size, typename U>
+inline T* fill_n(T* first, Size count, const U& value) {
+    if (count <= 0) {
+        return first;
+    }
+    _fill_ptr(first, first + count, value, typename _Is_simd_fillable<T, U>::_Fillable());
+    return first + count;
+}
+
 //--------------------------------------------------
 // equal and mismatch
 template <typename InputIter1, typename InputIter2>
@@ -0,0 +1,92 @@
+#ifndef SHADOW_STL_INTERNAL_MERGE_SORT_H
+#define SHADOW_STL_INTERNAL_MERGE_SORT_H
+
+// A stable bottom-up merge sort of an array of cheap, copyable values,
+// such as pointers, using a buffer of the same length.  Node-based
+// containers sort pointers to their elements with it, then relink (or
+// move) the elements once, instead of chasing pointers through every
+// merge pass.
+
+#include <stddef.h>
+
+#include "include/stl_config.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// Runs of this many values are sorted by insertion first.
+const size_t _S_merge_sort_run = 16;
+
+template <typename T, typename Compare>
+void _insertion_sort_run(T* first, T* last, Compare& comp) {
+    for (T* i = first + 1; i < last; ++i) {
+        T value = *i;
+        T* j = i;
+        for (; j != first && comp(value, *(j - 1)); --j) {
+            *j = *(j - 1);
+        }
+        *j = value;
+    }
+}
+
+// When sorting pointers, the comparisons are what miss the cache: each
+// loads the value behind a pointer.  The merge loads the targets of the
+// pointers this far ahead of each input, so those loads overlap.
+const ptrdiff_t _S_merge_prefetch_distance = 32;
+
+template <typename T>
+inline void _merge_prefetch(const T&) {}
+
+template <typename T>
+inline void _merge_prefetch(T* const& p) {
+    __builtin_prefetch(p);
+}
+
+// Merges [first1, last1) and [first2, last2) into out.  On ties the
+// first range goes first, which keeps the sort stable.
+template <typename T, typename Compare>
+T* _merge_runs(const T* first1, const T* last1, const T* first2, const T* last2, T* out,
+               Compare& comp) {
+    const ptrdiff_t d = _S_merge_prefetch_distance;
+    while (first1 != last1 && first2 != last2) {
+        if (comp(*first2, *first1)) {
+            if (last2 - first2 > d) _merge_prefetch(first2[d]);
+            *out++ = *first2++;
+        } else {
+            if (last1 - first1 > d) _merge_prefetch(first1[d]);
+            *out++ = *first1++;
+        }
+    }
+    while (first1 != last1) *out++ = *first1++;
+    while (first2 != last2) *out++ = *first2++;
+    return out;
+}
+
+// Sorts [first, last) by comp, stably.  buf has room for last - first
+// values.
+template <typename T, typename Compare>
+void _merge_sort_buffered(T* first, T* last, T* buf, Compare comp) {
+    const size_t n = last - first;
+    for (size_t i = 0; i < n; i += _S_merge_sort_run) {
+        _insertion_sort_run(first + i, first + (n - i < _S_merge_sort_run ? n : i + _S_merge_sort_run),
+                            comp);
+    }
+    T* from = first;
+    T* to = buf;
+    for (size_t width = _S_merge_sort_run; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            const size_t mid = lo + width < n ? lo + width : n;
+            const size_t hi = mid + width < n ? mid + width : n;
+            _merge_runs(from + lo, from + mid, from + mid, from + hi, to + lo, comp);
+        }
+        T* tmp = from;
+        from = to;
+        to = tmp;
+    }
+    if (from != first) {
+        for (size_t i = 0; i < n; ++i) first[i] = from[i];
+    }
+}
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_MERGE_SORT_H
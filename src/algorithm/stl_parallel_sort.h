@@ -0,0 +1,101 @@
+#ifndef SHADOW_STL_INTERNAL_PARALLEL_SORT_H
+#define SHADOW_STL_INTERNAL_PARALLEL_SORT_H
+
+// _merge_sort_buffered on a thread pool.  The array is cut into one run
+// per thread, the runs are sorted at once, then merged pairwise, level
+// by level.  Each merge is cut into pieces of equal output length at
+// the points where a stable merge crosses them, so the last levels,
+// with fewer merges than threads, keep every thread busy too.  The
+// result is the one _merge_sort_buffered gives: a stable sort has only
+// one.  comp is called from several threads at once.
+
+#include <stddef.h>
+
+#include "algorithm/stl_merge_sort.h"
+#include "include/stl_config.h"
+#include "include/stl_thread_pool.h"
+
+#ifndef SHADOW_STL_PARALLEL_SORT_MIN_RUN
+#define SHADOW_STL_PARALLEL_SORT_MIN_RUN (1u << 15)
+#endif
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// The number of values of [a, a + na) among the first d values of a
+// stable merge of it with [b, b + nb).
+template <typename T, typename Compare>
+size_t _merge_split(const T* a, size_t na, const T* b, size_t nb, size_t d, Compare& comp) {
+    size_t lo = d > nb ? d - nb : 0;
+    size_t hi = d < na ? d : na;
+    // The first i for which b[d - i - 1] goes before a[i].
+    while (lo < hi) {
+        const size_t i = lo + (hi - lo) / 2;
+        if (comp(b[d - i - 1], a[i])) {
+            hi = i;
+        } else {
+            lo = i + 1;
+        }
+    }
+    return lo;
+}
+
+// Sorts [first, last) by comp, stably, on pool.  buf has room for
+// last - first values.  Runs shorter than min_run are not worth a
+// thread.
+template <typename T, typename Compare>
+void _parallel_merge_sort_buffered(T* first, T* last, T* buf, Compare comp,
+                                   _Shadow_STL_thread_pool& pool =
+                                       _Shadow_STL_thread_pool::_S_default(),
+                                   size_t min_run = SHADOW_STL_PARALLEL_SORT_MIN_RUN) {
+    const size_t n = last - first;
+    const size_t threads = pool._M_concurrency();
+    size_t runs = n / (min_run ? min_run : 1);
+    if (runs > threads) runs = threads;
+    if (runs < 2) {
+        _merge_sort_buffered(first, last, buf, comp);
+        return;
+    }
+    auto bound = [n, runs](size_t r) { return r >= runs ? n : n / runs * r; };
+
+    auto sort_run = [&](size_t r) {
+        _merge_sort_buffered(first + bound(r), first + bound(r + 1), buf + bound(r), comp);
+    };
+    pool._M_for_each(runs, sort_run);
+
+    T* from = first;
+    T* to = buf;
+    for (size_t width = 1; width < runs; width *= 2) {
+        const size_t merges = (runs + 2 * width - 1) / (2 * width);
+        const size_t pieces = threads > merges ? (threads + merges - 1) / merges : 1;
+        auto merge_piece = [&, width, pieces](size_t t) {
+            const size_t r = t / pieces * 2 * width;
+            const size_t lo = bound(r);
+            const size_t mid = bound(r + width);
+            const size_t hi = bound(r + 2 * width);
+            const T* a = from + lo;
+            const T* b = from + mid;
+            const size_t na = mid - lo;
+            const size_t nb = hi - mid;
+            const size_t piece = t % pieces;
+            const size_t d0 = (na + nb) * piece / pieces;
+            const size_t d1 = (na + nb) * (piece + 1) / pieces;
+            const size_t i0 = _merge_split(a, na, b, nb, d0, comp);
+            const size_t i1 = _merge_split(a, na, b, nb, d1, comp);
+            _merge_runs(a + i0, a + i1, b + (d0 - i0), b + (d1 - i1), to + lo + d0, comp);
+        };
+        pool._M_for_each(merges * pieces, merge_piece);
+        T* tmp = from;
+        from = to;
+        to = tmp;
+    }
+    if (from != first) {
+        auto copy_back = [&](size_t t) {
+            for (size_t i = n * t / threads; i < n * (t + 1) / threads; ++i) first[i] = from[i];
+        };
+        pool._M_for_each(threads, copy_back);
+    }
+}
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_PARALLEL_SORT_H
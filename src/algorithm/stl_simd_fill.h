@@ -0,0 +1,147 @@
+#ifndef SHADOW_STL_INTERNAL_SIMD_FILL_H
+#define SHADOW_STL_INTERNAL_SIMD_FILL_H
+
+// Vectorized fill of memory with a pattern of 1, 2, 4, 8 or 16 bytes,
+// behind fill and fill_n on pointers to trivially copyable types (see
+// stl_algobase.h).  The kernel is picked once, at the first large fill:
+// AVX2 when the CPU has it, SSE2 on any other x86, a plain loop
+// elsewhere.  Fills of SHADOW_STL_FILL_STREAM_BYTES or more use
+// non-temporal stores, which do not pull the destination into the
+// cache: it would not fit anyway, and evicting everything else for it
+// costs more than the fill.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "include/stl_config.h"
+
+#ifndef SHADOW_STL_FILL_STREAM_BYTES
+#define SHADOW_STL_FILL_STREAM_BYTES (32u << 20)
+#endif
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+struct _Simd_fill {
+    // Fills below this many bytes are plain loops.
+    static const size_t _S_min_bytes = 64;
+
+    // A kernel fills bytes >= _S_min_bytes bytes at dst, a multiple of
+    // the pattern size, from lane: the pattern repeated over 64 bytes.
+    using _Kernel = void (*)(unsigned char* dst, size_t bytes, const unsigned char* lane,
+                             size_t size);
+
+    static void _S_fill_loop(unsigned char* dst, size_t bytes, const unsigned char* lane,
+                             size_t size) {
+        for (size_t i = 0; i < bytes; i += size) {
+            memcpy(dst + i, lane, size);
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // The unaligned first and last stores cover the ends; the aligned
+    // stores in between start at a pattern offset, so they store the
+    // lane rotated by it.  Both ends are whole patterns away from dst,
+    // because the vector width is a multiple of the pattern size.
+    __attribute__((target("sse2")))
+    static void _S_fill_sse2(unsigned char* dst, size_t bytes, const unsigned char* lane,
+                             size_t size) {
+        unsigned char* const end = dst + bytes;
+        const __m128i v = _mm_loadu_si128((const __m128i*)lane);
+        const size_t skew = (16 - ((uintptr_t)dst & 15)) & 15;
+        const __m128i r = _mm_loadu_si128((const __m128i*)(lane + skew % size));
+        _mm_storeu_si128((__m128i*)dst, v);
+        unsigned char* p = dst + skew;
+        if (bytes >= SHADOW_STL_FILL_STREAM_BYTES) {
+            for (; p + 64 <= end; p += 64) {
+                _mm_stream_si128((__m128i*)p, r);
+                _mm_stream_si128((__m128i*)(p + 16), r);
+                _mm_stream_si128((__m128i*)(p + 32), r);
+                _mm_stream_si128((__m128i*)(p + 48), r);
+            }
+            _mm_sfence();
+        }
+        for (; p + 64 <= end; p += 64) {
+            _mm_store_si128((__m128i*)p, r);
+            _mm_store_si128((__m128i*)(p + 16), r);
+            _mm_store_si128((__m128i*)(p + 32), r);
+            _mm_store_si128((__m128i*)(p + 48), r);
+        }
+        for (; p + 16 <= end; p += 16) {
+            _mm_store_si128((__m128i*)p, r);
+        }
+        _mm_storeu_si128((__m128i*)(end - 16), v);
+    }
+
+    __attribute__((target("avx2")))
+    static void _S_fill_avx2(unsigned char* dst, size_t bytes, const unsigned char* lane,
+                             size_t size) {
+        unsigned char* const end = dst + bytes;
+        const __m256i v = _mm256_loadu_si256((const __m256i*)lane);
+        const size_t skew = (32 - ((uintptr_t)dst & 31)) & 31;
+        const __m256i r = _mm256_loadu_si256((const __m256i*)(lane + skew % size));
+        _mm256_storeu_si256((__m256i*)dst, v);
+        unsigned char* p = dst + skew;
+        if (bytes >= SHADOW_STL_FILL_STREAM_BYTES) {
+            for (; p + 128 <= end; p += 128) {
+                _mm256_stream_si256((__m256i*)p, r);
+                _mm256_stream_si256((__m256i*)(p + 32), r);
+                _mm256_stream_si256((__m256i*)(p + 64), r);
+                _mm256_stream_si256((__m256i*)(p + 96), r);
+            }
+            _mm_sfence();
+        }
+        for (; p + 128 <= end; p += 128) {
+            _mm256_store_si256((__m256i*)p, r);
+            _mm256_store_si256((__m256i*)(p + 32), r);
+            _mm256_store_si256((__m256i*)(p + 64), r);
+            _mm256_store_si256((__m256i*)(p + 96), r);
+        }
+        for (; p + 32 <= end; p += 32) {
+            _mm256_store_si256((__m256i*)p, r);
+        }
+        _mm256_storeu_si256((__m256i*)(end - 32), v);
+    }
+#endif
+
+    static _Kernel _S_select() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return _S_fill_avx2;
+        if (__builtin_cpu_supports("sse2")) return _S_fill_sse2;
+#endif
+        return _S_fill_loop;
+    }
+
+    static _Kernel _S_kernel() {
+        static const _Kernel kernel = _S_select();
+        return kernel;
+    }
+
+    // Fills bytes bytes at dst with copies of the size bytes at pattern.
+    // size is 1, 2, 4, 8 or 16, and divides bytes.
+    static void _S_fill(void* dst, const void* pattern, size_t size, size_t bytes) {
+        if (size == 1) {
+            memset(dst, *(const unsigned char*)pattern, bytes);
+            return;
+        }
+        unsigned char lane[64];
+        memcpy(lane, pattern, size);
+        for (size_t k = size; k < sizeof lane; k *= 2) {
+            memcpy(lane + k, lane, k);
+        }
+        if (bytes < _S_min_bytes) {
+            _S_fill_loop((unsigned char*)dst, bytes, lane, size);
+        } else {
+            _S_kernel()((unsigned char*)dst, bytes, lane, size);
+        }
+    }
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_SIMD_FILL_H
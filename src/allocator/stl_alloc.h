@@ -21,18 +21,33 @@
 #endif // SHADOW_STL_NO_BAD_ALLOC
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 // #ifndef SHADOW_STL_CONFIG_H
 // #include "include/stl_config.h"
 // #endif  // SHADOW_STL_CONFIG_H
 #include "include/stl_threads.h"
+#include "include/type_traits.h"
+#include "include/stl_lock_profile.h"
+#include "allocator/stl_alloc_stats.h"
+#include "allocator/stl_numa.h"
+#include "allocator/stl_size_classes.h"
 
 #define SHADOW_NODE_ALLOCATOR_THREADS true
+#ifdef SHADOW_STL_ALLOC_STATS
+#define SHADOW_NODE_ALLOCATOR_LOCK if (threads) \
+    { _S_acquire_lock_counted(); }
+#else
 #define SHADOW_NODE_ALLOCATOR_LOCK if (threads) \
     { _S_node_allocator_lock._M_acquire_lock(); }
+#endif
 #define SHADOW_NODE_ALLOCATOR_UNLOCK if (threads) \
     { _S_node_allocator_lock._M_release_lock(); }
 
@@ -46,11 +61,17 @@ private:
     // handle oom
     static void* _S_oom_malloc(size_t);
     static void* _S_oom_realloc(void*, size_t);
+    static void* _S_oom_memalign(size_t, size_t);
 
     static void (* __malloc_alloc_oom_handler)();
 
+    enum { _STAT_ALLOC, _STAT_FREE, _STAT_REALLOC, _STAT_BYTES, _STAT_OOM, _STAT_COUNT };
+    using _Stats = _Thread_counters<_malloc_alloc_template, _STAT_COUNT>;
+
 public:
     static void* allocate(size_t n) {
+        SHADOW_ALLOC_STAT(_Stats, _STAT_ALLOC, 1);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_BYTES, n);
         void* result = malloc(n);
         // allocate failed
         if (result == nullptr) result = _S_oom_malloc(n);
@@ -58,10 +79,41 @@ public:
     }
 
     static void deallocate(void* p, size_t /* n */) {
+        SHADOW_ALLOC_STAT(_Stats, _STAT_FREE, 1);
         free(p);
     }
 
+    // align must be a power of two.  malloc already aligns for
+    // max_align_t; stricter alignments go through posix_memalign.
+    static void* allocate(size_t n, size_t align) {
+        if (align <= alignof(max_align_t)) return allocate(n);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_ALLOC, 1);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_BYTES, n);
+        void* result;
+        if (posix_memalign(&result, align, n) != 0) result = _S_oom_memalign(n, align);
+        return result;
+    }
+
+    static void deallocate(void* p, size_t n, size_t /* align */) {
+        deallocate(p, n);
+    }
+
+    // The smallest size of at least n bytes for which malloc uses the
+    // whole block it hands out, so that asking for it costs nothing
+    // more than asking for n: n plus glibc's 8 byte chunk header rounded
+    // up to 16 bytes, and blocks of 128K and more (which glibc maps
+    // separately by default) rounded up to whole pages.
+    static size_t good_size(size_t n) {
+        enum { _HEADER = 8, _GRANULE = 16, _MMAP_HEADER = 16, _MMAP_THRESHOLD = 128 * 1024 };
+        if (n < (size_t)_MMAP_THRESHOLD) {
+            return ((n + _HEADER + _GRANULE - 1) & ~(size_t)(_GRANULE - 1)) - _HEADER;
+        }
+        static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        return ((n + _MMAP_HEADER + page - 1) & ~(page - 1)) - _MMAP_HEADER;
+    }
+
     static void* reallocate(void* p, size_t /* old_sz */, size_t new_sz) {
+        SHADOW_ALLOC_STAT(_Stats, _STAT_REALLOC, 1);
         void* result = realloc(p, new_sz);
         if (result == nullptr) result = _S_oom_realloc(p, new_sz);
         return result;
@@ -73,6 +125,43 @@ public:
         __malloc_alloc_oom_handler = f;
         return old;
     }
+
+    // Event counts, all zero unless SHADOW_STL_ALLOC_STATS is defined.
+    struct stats_type {
+        bool counters_enabled;
+        uint64_t allocations;
+        uint64_t deallocations;
+        uint64_t reallocations;
+        uint64_t bytes_allocated;   // sum of the sizes passed to allocate
+        uint64_t oom_handler_calls;
+    };
+    static stats_type stats() {
+        uint64_t count[_STAT_COUNT] = {};
+        stats_type result;
+#ifdef SHADOW_STL_ALLOC_STATS
+        _Stats::_S_sum(count);
+        result.counters_enabled = true;
+#else
+        result.counters_enabled = false;
+#endif
+        result.allocations = count[_STAT_ALLOC];
+        result.deallocations = count[_STAT_FREE];
+        result.reallocations = count[_STAT_REALLOC];
+        result.bytes_allocated = count[_STAT_BYTES];
+        result.oom_handler_calls = count[_STAT_OOM];
+        return result;
+    }
+    // Writes stats() as a JSON object.
+    static void dump_stats(FILE* out) {
+        stats_type st = stats();
+        fprintf(out, "{\"counters_enabled\": %s, \"allocations\": %llu, "
+                     "\"deallocations\": %llu, \"reallocations\": %llu, "
+                     "\"bytes_allocated\": %llu, \"oom_handler_calls\": %llu}",
+                st.counters_enabled ? "true" : "false",
+                (unsigned long long)st.allocations, (unsigned long long)st.deallocations,
+                (unsigned long long)st.reallocations, (unsigned long long)st.bytes_allocated,
+                (unsigned long long)st.oom_handler_calls);
+    }
 };
 
 // malloc_alloc out-of-memory handling
@@ -88,6 +177,7 @@ void* _malloc_alloc_template<__inst>::_S_oom_malloc(size_t n) {
         my_malloc_handler = __malloc_alloc_oom_handler;
         if (my_malloc_handler == nullptr) { SHADOW_THROW_BAD_ALLOC; }
         // call oom handler, and try to free some memory
+        SHADOW_ALLOC_STAT(_Stats, _STAT_OOM, 1);
         (*my_malloc_handler)();
         // try to allocate again
         result = malloc(n);
@@ -104,6 +194,7 @@ void* _malloc_alloc_template<__inst>::_S_oom_realloc(void* p, size_t n) {
         my_malloc_handler = __malloc_alloc_oom_handler;
         if (my_malloc_handler == nullptr) { SHADOW_THROW_BAD_ALLOC; }
         // call oom handler, and try to free some memory
+        SHADOW_ALLOC_STAT(_Stats, _STAT_OOM, 1);
         (*my_malloc_handler)();
         // try to allocate again
         result = realloc(p, n);
@@ -111,22 +202,155 @@ void* _malloc_alloc_template<__inst>::_S_oom_realloc(void* p, size_t n) {
     }
 }
 
+template <int __inst>
+void* _malloc_alloc_template<__inst>::_S_oom_memalign(size_t n, size_t align) {
+    void (* my_malloc_handler)();
+    void* result;
+
+    for (;;) {
+        my_malloc_handler = __malloc_alloc_oom_handler;
+        if (my_malloc_handler == nullptr) { SHADOW_THROW_BAD_ALLOC; }
+        // call oom handler, and try to free some memory
+        SHADOW_ALLOC_STAT(_Stats, _STAT_OOM, 1);
+        (*my_malloc_handler)();
+        // try to allocate again
+        if (posix_memalign(&result, align, n) == 0) return result;
+    }
+}
+
 using malloc_alloc = _malloc_alloc_template<0>;
 
+// Hands the alignment on to SGI-style allocators that take one
+// (allocate(n, align) and deallocate(p, n, align)); the others only see
+// the size.
+template <typename _Alloc>
+struct _Aligned_alloc {
+private:
+    template <typename _A>
+    static auto _S_allocate(size_t n, size_t align, int)
+        -> decltype(_A::allocate(n, align)) {
+        return _A::allocate(n, align);
+    }
+    template <typename _A>
+    static void* _S_allocate(size_t n, size_t /* align */, long) {
+        return _A::allocate(n);
+    }
+    template <typename _A>
+    static auto _S_deallocate(void* p, size_t n, size_t align, int)
+        -> decltype(_A::deallocate(p, n, align)) {
+        return _A::deallocate(p, n, align);
+    }
+    template <typename _A>
+    static void _S_deallocate(void* p, size_t n, size_t /* align */, long) {
+        _A::deallocate(p, n);
+    }
+
+public:
+    static void* allocate(size_t n, size_t align) {
+        return _S_allocate<_Alloc>(n, align, 0);
+    }
+    static void deallocate(void* p, size_t n, size_t align) {
+        _S_deallocate<_Alloc>(p, n, align, 0);
+    }
+};
+
 template <typename _Tp, typename _Alloc>
 class simple_alloc {
+private:
+    // Allocators with allocate_batch/deallocate_batch (see
+    // _default_alloc_template) get the whole batch at once; for the
+    // others we loop.
+    template <typename _A>
+    static auto _S_allocate_batch(_Tp** out, size_t count, int)
+        -> decltype(_A::allocate_batch(sizeof(_Tp), (void**)out, count, alignof(_Tp))) {
+        return _A::allocate_batch(sizeof(_Tp), (void**)out, count, alignof(_Tp));
+    }
+    template <typename _A>
+    static void _S_allocate_batch(_Tp** out, size_t count, long) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = allocate();
+        }
+    }
+    template <typename _A>
+    static auto _S_deallocate_batch(_Tp** p, size_t count, int)
+        -> decltype(_A::deallocate_batch(sizeof(_Tp), (void**)p, count, alignof(_Tp))) {
+        return _A::deallocate_batch(sizeof(_Tp), (void**)p, count, alignof(_Tp));
+    }
+    template <typename _A>
+    static void _S_deallocate_batch(_Tp** p, size_t count, long) {
+        for (size_t i = 0; i < count; ++i) {
+            deallocate(p[i]);
+        }
+    }
+
+    // Allocators with reallocate may grow the block in place; the
+    // others get a new block.  reallocate only promises the alignment of
+    // allocate(n), which is at least that of a pointer, so over-aligned
+    // objects get a new block too.
+    template <typename _A>
+    static auto _S_reallocate(_Tp* p, size_t old_n, size_t new_n, int)
+        -> decltype(_A::reallocate((void*)p, old_n, new_n), (_Tp*)nullptr) {
+        if (alignof(_Tp) > alignof(void*)) {
+            return _S_reallocate<_A>(p, old_n, new_n, 0L);
+        }
+        return (_Tp*)_A::reallocate(p, old_n * sizeof(_Tp), new_n * sizeof(_Tp));
+    }
+    template <typename _A>
+    static _Tp* _S_reallocate(_Tp* p, size_t old_n, size_t new_n, long) {
+        _Tp* result = allocate(new_n);
+        memcpy((void*)result, (const void*)p, (old_n < new_n ? old_n : new_n) * sizeof(_Tp));
+        deallocate(p, old_n);
+        return result;
+    }
+
+    template <typename _A>
+    static auto _S_good_size(size_t n, int) -> decltype(_A::good_size(n)) {
+        return _A::good_size(n);
+    }
+    template <typename _A>
+    static size_t _S_good_size(size_t n, long) {
+        return n;
+    }
+
+    using _Aligned = _Aligned_alloc<_Alloc>;
+
 public:
+    // The objects are aligned for _Tp, as far as _Alloc takes an
+    // alignment (see _Aligned_alloc).
     static _Tp* allocate(size_t n) {
-        return n == 0 ? nullptr : (_Tp*)_Alloc::allocate(n * sizeof(_Tp));
+        return n == 0 ? nullptr : (_Tp*)_Aligned::allocate(n * sizeof(_Tp), alignof(_Tp));
     }
     static _Tp* allocate(void) {
-        return (_Tp*)_Alloc::allocate(sizeof(_Tp));
+        return (_Tp*)_Aligned::allocate(sizeof(_Tp), alignof(_Tp));
     }
     static void deallocate(_Tp* p, size_t n) {
-        if (n != 0) _Alloc::deallocate(p, n * sizeof(_Tp));
+        if (n != 0) _Aligned::deallocate(p, n * sizeof(_Tp), alignof(_Tp));
     }
     static void deallocate(_Tp* p) {
-        _Alloc::deallocate(p, sizeof(_Tp));
+        _Aligned::deallocate(p, sizeof(_Tp), alignof(_Tp));
+    }
+    // The number of objects, at least n, that fit in the block allocate(n)
+    // really takes, for allocators with good_size; n for the others.
+    static size_t good_size(size_t n) {
+        return n == 0 ? 0 : _S_good_size<_Alloc>(n * sizeof(_Tp), 0) / sizeof(_Tp);
+    }
+    // Resizes the array p of old_n objects to new_n objects, keeping
+    // the bytes of the first min(old_n, new_n).  The objects are moved as
+    // bytes, so _Tp must be trivially relocatable.
+    static _Tp* reallocate(_Tp* p, size_t old_n, size_t new_n) {
+        if (old_n == 0) return allocate(new_n);
+        if (new_n == 0) {
+            deallocate(p, old_n);
+            return nullptr;
+        }
+        return _S_reallocate<_Alloc>(p, old_n, new_n, 0);
+    }
+    // count single objects, into or from out[0 .. count)
+    static void allocate_batch(_Tp** out, size_t count) {
+        _S_allocate_batch<_Alloc>(out, count, 0);
+    }
+    static void deallocate_batch(_Tp** p, size_t count) {
+        _S_deallocate_batch<_Alloc>(p, count, 0);
     }
 };
 
@@ -181,29 +405,65 @@ public:
 //    _S_round_up(requested_size).  Thus the client has enough size
 //    information that we can return the object to the proper free list
 //    without permanently losing part of the object.
+// 3. Objects are carved out of fixed size chunks that are aligned to
+//    their size, so the chunk of an object is found by masking its
+//    address.  Every chunk counts the objects it has handed out, and
+//    trim() gives chunks without live objects back to the system.
 //
 
 // The first template parameter specifies whether more than one thread
-// may use this allocator.  It is safe to allocate an object from
-// one instance of a default_alloc and deallocate it with another
-// one.  This effectively transfers its ownership to the second one.
-// This may have undesirable effects on reference locality.
+// may use this allocator.  An object must go back to the
+// default_alloc instance it came from.  Its chunk counts it as live
+// under that instance's lock, and that instance's trim() unmaps the
+// chunk once the count drops to zero, so an object freed into another
+// instance's free lists could be handed out after its chunk is gone.
 // The second parameter is unreferenced and serves only to allow the
 // creation of multiple default_alloc instances.
 // Node that containers built on different allocator instances have
 // different types, limiting the utility of this approach.
+// The third parameter is the size class table (see stl_size_classes.h).
+// It decides the alignment of the objects, the largest request served
+// from the free lists, and how requests are rounded up.  The default
+// reproduces the classic 16 lists of 8 byte granularity up to 128 bytes.
+// The fourth parameter is the lock type guarding the free lists and
+// the chunks, any of the locks in stl_threads.h.  It defaults to
+// SHADOW_NODE_ALLOCATOR_MUTEX, the spin-then-park lock unless defined
+// otherwise.  With SHADOW_STL_LOCK_PROFILING it shows up in
+// lock_profile as "node allocator" (see stl_lock_profile.h).
+
+
+// Smallest power of two no smaller than n.
+inline constexpr size_t _Ceil_pow2(size_t n) {
+    size_t result = 1;
+    while (result < n) result *= 2;
+    return result;
+}
 
+// Header of the chunks of _default_alloc_template.
+struct _Pool_chunk {
+    _Pool_chunk* _M_next;       // all chunks in use, or the spare chunks
+    _Pool_chunk* _M_prev;
+    size_t _M_live;             // objects handed out and not yet returned
+    void* _M_malloc_base;       // non-null if the chunk came from malloc_alloc
+    int _M_node;                // _S_numa_node of the owning pool
+    bool _M_releasing;          // scratch flag used by trim()
+};
 
 // SGI STL second level allocator
-template <bool threads, int inst>
+template <bool threads, int inst, typename _SizeClasses = _Default_size_classes,
+          typename _Mutex = SHADOW_NODE_ALLOCATOR_MUTEX>
 class _default_alloc_template {
 private:
-    enum { _ALIGN = 8 };
-    enum { _MAX_BYTES = 128 };
-    enum { _NFREELISTS = _MAX_BYTES / _ALIGN };
+    enum { _ALIGN = _SizeClasses::_S_align };
+    enum { _MAX_BYTES = _SizeClasses::_S_max_bytes };
+    enum { _NFREELISTS = _SizeClasses::_S_nclasses };
 
+    // round up to the size of the smallest class that fits
+    static constexpr size_t _S_round_up(size_t bytes) {
+        return _SizeClasses::_S_round_up(bytes);
+    }
     // round up to multiple of _ALIGN
-    static size_t _S_round_up(size_t bytes) {
+    static constexpr size_t _S_align_up(size_t bytes) {
         return (((bytes) + (size_t)_ALIGN - 1) & ~((size_t)(_ALIGN) - 1));
     }
 
@@ -215,8 +475,8 @@ private:
     static _Obj* volatile _S_free_list[];
 
     // Get a reference to the free list for a given block size.
-    static size_t _S_freelist_index(size_t bytes) {
-        return (((bytes) + (size_t)_ALIGN - 1) / (size_t)_ALIGN - 1);
+    static constexpr size_t _S_freelist_index(size_t bytes) {
+        return _SizeClasses::_S_index(bytes);
     }
 
     // Returns an object of size n, and optionally adds to size n free list.
@@ -225,11 +485,102 @@ private:
     // if it is inconvenient to allocate the requested number.
     static char* _S_chunk_alloc(size_t size, int& nobjs);
 
+    // Batch transfers used by the per-thread caches in stl_pthread_alloc.h.
+    // Both expect n to be properly aligned and take the allocation lock
+    // exactly once.
+    template <int, typename> friend class _Pthread_alloc_template;
+
+    // Removes up to nobjs objects of size n from the free list, carving
+    // them out of the pool if the list is empty.  Returns them as a
+    // null-terminated chain; nobjs is set to the length of the chain.
+    static _Obj* _S_fetch_batch(size_t n, int& nobjs);
+    // Pushes the chain [first, last] onto the free list for size n.
+    static void _S_release_batch(size_t n, _Obj* first, _Obj* last);
+
+    // Per-node pools of _numa_alloc_template find the owner of an
+    // object through its chunk.
+    template <bool, int, typename> friend class _numa_alloc_template;
+
+    // Every chunk starts with this header.  Chunks are _CHUNK_BYTES long
+    // and aligned to _CHUNK_BYTES.
+    using _Chunk = _Pool_chunk;
+
+    // NUMA node the chunks are bound to, or -1 (see stl_numa.h).
+    static constexpr int _S_numa_node = _Numa_node_of<_SizeClasses>::value;
+
+    // At least 256K, and large enough for several refills of the
+    // biggest class.
+    enum : size_t { _CHUNK_BYTES = _Ceil_pow2(64 * (size_t)_MAX_BYTES > ((size_t)1 << 18)
+                                              ? 64 * (size_t)_MAX_BYTES
+                                              : ((size_t)1 << 18)) };
+    enum : size_t { _CHUNK_HEADER = (sizeof(_Chunk) + (size_t)_ALIGN - 1) & ~((size_t)_ALIGN - 1) };
+
+    static _Chunk* _S_chunk_of(const void* p) {
+        return (_Chunk*)((uintptr_t)p & ~((uintptr_t)_CHUNK_BYTES - 1));
+    }
+    // Obtains a fresh chunk and links it into the chunk list.
+    static _Chunk* _S_new_chunk();
+    // Gives the memory of a chunk that is no longer linked back.
+    static void _S_release_chunk(_Chunk* chunk);
+
+    // Periodic trimming, see start_periodic_trim.
+    static void* _S_trim_loop(void*);
+
     // Chunk allocation state.
     static char* _S_start_free; // start of memory pool
     static char* _S_end_free;   // end of memory pool
-    static size_t _S_heap_size;
-    static _Shadow_STL_mutex_lock _S_node_allocator_lock;
+    static _Chunk* _S_current_chunk;  // the chunk [start, end) lies in
+    static _Chunk* _S_chunks;         // chunks holding objects
+    static _Chunk* _S_spare_chunks;   // trimmed chunks kept for reuse
+    static size_t _S_heap_size;       // bytes in _S_chunks
+    static _Shadow_STL_profiled_t<_Mutex> _S_node_allocator_lock;
+
+    static pthread_mutex_t _S_trim_mutex;
+    static pthread_cond_t _S_trim_cond;
+    static pthread_t _S_trim_thread;
+    static bool _S_trim_running;
+    static unsigned _S_trim_interval_ms;
+    static size_t _S_trim_retain;
+
+    // Counters, see stl_alloc_stats.h.  The per size class counters come
+    // first, _NFREELISTS of each.
+    enum {
+        _STAT_ALLOC = 0,
+        _STAT_FREE = _STAT_ALLOC + _NFREELISTS,
+        _STAT_REFILL = _STAT_FREE + _NFREELISTS,
+        _STAT_LARGE_ALLOC = _STAT_REFILL + _NFREELISTS,
+        _STAT_LARGE_FREE,
+        _STAT_CHUNK_MAP,        // chunks obtained with mmap
+        _STAT_SPARE_REUSE,      // chunks taken from the spare list
+        _STAT_SCAVENGE,         // mmap failed, a free object was carved up
+        _STAT_MALLOC_FALLBACK,  // mmap failed, chunk from malloc_alloc
+        _STAT_TRIM,
+        _STAT_TRIM_BYTES,
+        _STAT_LOCK,
+        _STAT_LOCK_CONTENDED,
+        _STAT_LOCK_WAIT_NS,
+        _STAT_COUNT
+    };
+    using _Stats = _Thread_counters<_default_alloc_template, _STAT_COUNT>;
+
+#ifdef SHADOW_STL_ALLOC_STATS
+    // Takes the node allocator lock, and measures how long we waited
+    // for it if it was taken.
+    static void _S_acquire_lock_counted() {
+        SHADOW_ALLOC_STAT(_Stats, _STAT_LOCK, 1);
+        if (_S_node_allocator_lock._M_try_acquire_lock()) {
+            return;
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        _S_node_allocator_lock._M_acquire_lock();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_LOCK_CONTENDED, 1);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_LOCK_WAIT_NS,
+                          (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000u +
+                          end.tv_nsec - start.tv_nsec);
+    }
+#endif
     // It would be nice to use _STL_auto_lock here.  But we
     // don't need the NULL check.  And we do need a test whether
     // threads have actually been started.
@@ -250,8 +601,10 @@ public:
 
         // If n > _MAX_BYTES, allocate directly from malloc.
         if (n > (size_t)_MAX_BYTES) {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_ALLOC, 1);
             ret = malloc_alloc::allocate(n);
         } else {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_ALLOC + _S_freelist_index(n), 1);
             _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
             // Acquire the lock here with a constructor call.
             // This ensures that it is released in exit or during stack
@@ -266,41 +619,184 @@ public:
                 *my_free_list = result->_M_free_list_link;
                 ret = result;
             }
+            ++_S_chunk_of(ret)->_M_live;
         }
         return ret;
     }
 
+    // p must come from this instance (see above).
     static void deallocate(void* p, size_t n) {
         if (n > (size_t)_MAX_BYTES) {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_FREE, 1);
             malloc_alloc::deallocate(p, n);
         } else {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_FREE + _S_freelist_index(n), 1);
             _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
             _Obj* q = (_Obj*)p;
             _Lock lock_instance;
             // deallocate will put the block back to the free list.
             q->_M_free_list_link = *my_free_list;
             *my_free_list = q;
+            --_S_chunk_of(q)->_M_live;
         }
     }
     static void* reallocate(void* p, size_t old_sz, size_t new_sz);
+
+    // n rounded up to its size class, or as malloc_alloc::good_size for
+    // large requests: what a request of n bytes really takes.
+    static size_t good_size(size_t n) {
+        if (n > (size_t)_MAX_BYTES) return malloc_alloc::good_size(n);
+        return n == 0 ? 0 : _S_round_up(n);
+    }
+
+    // align must be a power of two.  The free lists only hold objects
+    // aligned to _ALIGN, so more strictly aligned requests go to
+    // malloc_alloc.
+    static void* allocate(size_t n, size_t align) {
+        if (align <= (size_t)_ALIGN) return allocate(n);
+        SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_ALLOC, 1);
+        return malloc_alloc::allocate(n, align);
+    }
+    static void deallocate(void* p, size_t n, size_t align) {
+        if (align <= (size_t)_ALIGN) {
+            deallocate(p, n);
+        } else {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_FREE, 1);
+            malloc_alloc::deallocate(p, n, align);
+        }
+    }
+
+    // Fills out[0 .. count) with objects of n bytes.  The lock is taken
+    // once for the whole batch.
+    static void allocate_batch(size_t n, void** out, size_t count, size_t align = _ALIGN);
+    // Returns the count objects of n bytes in p[0 .. count), which came
+    // from this instance, with one lock acquisition and one splice into
+    // the free list.
+    static void deallocate_batch(size_t n, void** p, size_t count, size_t align = _ALIGN);
+
+    // Returns chunks that hold no live objects to the system and answers
+    // the number of bytes released.  Up to retain_bytes of them are kept
+    // mapped, with their pages discarded by madvise(MADV_DONTNEED), so
+    // that the pool can grow again without a system call.  Objects held
+    // in the caches of _Pthread_alloc_template count as live; flush()
+    // those first for a thorough trim.
+    static size_t trim(size_t retain_bytes = 0);
+
+    // Calls trim(retain_bytes) every interval_ms milliseconds from a
+    // background thread until stop_periodic_trim() is called.  Returns
+    // false if periodic trimming is already running or the thread could
+    // not be created.
+    static bool start_periodic_trim(unsigned interval_ms, size_t retain_bytes = 0);
+    static void stop_periodic_trim();
+
+    // Bytes currently obtained from the system for objects.
+    static size_t heap_size() {
+        _Lock lock_instance;
+        return _S_heap_size;
+    }
+
+    // A snapshot of the pool.  The sizes are always exact; the event
+    // counts are all zero unless SHADOW_STL_ALLOC_STATS is defined.
+    struct stats_type {
+        bool counters_enabled;
+        size_t heap_size;
+        size_t chunks;
+        size_t spare_chunks;
+        struct size_class {
+            size_t size;
+            size_t free_objects;    // on the shared free list
+            uint64_t allocations;
+            uint64_t deallocations;
+            uint64_t refills;
+        } classes[_NFREELISTS];
+        uint64_t large_allocations;  // passed through to malloc_alloc
+        uint64_t large_deallocations;
+        uint64_t chunk_maps;
+        uint64_t spare_chunk_reuses;
+        uint64_t scavenges;
+        uint64_t malloc_fallbacks;
+        uint64_t trims;
+        uint64_t trimmed_bytes;
+        uint64_t lock_acquisitions;
+        uint64_t lock_contentions;
+        uint64_t lock_wait_ns;
+    };
+    static stats_type stats();
+    // Writes stats() as a JSON object.
+    static void dump_stats(FILE* out);
 };
 
 using alloc = _default_alloc_template<SHADOW_NODE_ALLOCATOR_THREADS, 0>;
 using single_client_alloc = _default_alloc_template<false, 0>;
 
-template <bool threads, int inst>
-inline bool operator!=(const _default_alloc_template<threads, inst>&,
-                    const _default_alloc_template<threads, inst>&) {
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+inline bool operator!=(const _default_alloc_template<threads, inst, _SizeClasses, _Mutex>&,
+                    const _default_alloc_template<threads, inst, _SizeClasses, _Mutex>&) {
     return false;
 }
 
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Chunk*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_new_chunk() {
+    _Chunk* chunk = _S_spare_chunks;
+
+    if (chunk != nullptr) {
+        SHADOW_ALLOC_STAT(_Stats, _STAT_SPARE_REUSE, 1);
+        _S_spare_chunks = chunk->_M_next;
+    } else {
+        // mmap only guarantees page alignment.  Map twice the size and
+        // unmap whatever lies outside the aligned chunk.
+        size_t map_bytes = 2 * (size_t)_CHUNK_BYTES;
+        char* p = (char*)mmap(nullptr, map_bytes, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == (char*)MAP_FAILED) {
+            return nullptr;
+        }
+        char* aligned = (char*)(((uintptr_t)p + _CHUNK_BYTES - 1) & ~((uintptr_t)_CHUNK_BYTES - 1));
+        if (aligned != p) {
+            munmap(p, aligned - p);
+        }
+        if (aligned + _CHUNK_BYTES != p + map_bytes) {
+            munmap(aligned + _CHUNK_BYTES, p + map_bytes - (aligned + _CHUNK_BYTES));
+        }
+        // Bind before the header below touches the first page.
+        if (_S_numa_node >= 0 && _Numa::_S_node_count() > 1) {
+            _Numa::_S_prefer(aligned, _CHUNK_BYTES, _S_numa_node);
+        }
+        SHADOW_ALLOC_STAT(_Stats, _STAT_CHUNK_MAP, 1);
+        chunk = (_Chunk*)aligned;
+        chunk->_M_malloc_base = nullptr;
+    }
+    chunk->_M_node = _S_numa_node;
+    chunk->_M_live = 0;
+    chunk->_M_releasing = false;
+    chunk->_M_prev = nullptr;
+    chunk->_M_next = _S_chunks;
+    if (_S_chunks != nullptr) {
+        _S_chunks->_M_prev = chunk;
+    }
+    _S_chunks = chunk;
+    _S_heap_size += _CHUNK_BYTES;
+    return chunk;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_release_chunk(_Chunk* chunk) {
+    if (chunk->_M_malloc_base != nullptr) {
+        malloc_alloc::deallocate(chunk->_M_malloc_base, 2 * (size_t)_CHUNK_BYTES);
+    } else {
+        munmap(chunk, _CHUNK_BYTES);
+    }
+}
+
 /* We allocate memory in large chunks in order to avoid fragmenting     */
 /* the malloc heap too much.                                            */
 /* We assume that size is properly aligned.                             */
 /* We hold the allocation lock.                                         */
-template <bool threads, int inst>
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
 char*
-_default_alloc_template<threads, inst>::_S_chunk_alloc(size_t size, int& nobjs) {
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_chunk_alloc(size_t size, int& nobjs) {
     char* result;
 
     size_t total_bytes = size * nobjs;
@@ -317,27 +813,32 @@ _default_alloc_template<threads, inst>::_S_chunk_alloc(size_t size, int& nobjs)
         _S_start_free += total_bytes;
         return result;
     } else {
-        size_t bytes_to_get = 2 * total_bytes + _S_round_up(_S_heap_size >> 4);
-        // Try to make use of the left-over piece.
+        // Try to make use of the left-over piece.  With a non-linear size
+        // class table it may not match a class exactly; the remainder of
+        // the piece is lost.
         if (bytes_left > 0) {
-            _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(bytes_left);
+            _Obj* volatile* my_free_list = _S_free_list + _SizeClasses::_S_index_floor(bytes_left);
             ((_Obj*)_S_start_free)->_M_free_list_link = *my_free_list;
             *my_free_list = (_Obj*)_S_start_free;
         }
-        _S_start_free = (char*)malloc(bytes_to_get);
-        // malloc failed
-        if (_S_start_free == nullptr) {
+        _Chunk* chunk = _S_new_chunk();
+        // mmap failed
+        if (chunk == nullptr) {
             size_t i;
+            size_t index;
             _Obj* volatile* my_free_list;
             _Obj* p;
             // Try to make do with what we have.  That can't
             // hurt.  We do not try smaller requests, since that tends
             // to result in disaster on multi-process machines.
-            for (i = size; i <= (size_t)_MAX_BYTES; i += (size_t)_ALIGN) {
-                my_free_list = _S_free_list + _S_freelist_index(i);
+            for (index = _S_freelist_index(size); index < (size_t)_NFREELISTS; ++index) {
+                i = _SizeClasses::_S_class_size(index);
+                my_free_list = _S_free_list + index;
                 p = *my_free_list;
                 if (p != nullptr) {
+                    SHADOW_ALLOC_STAT(_Stats, _STAT_SCAVENGE, 1);
                     *my_free_list = p->_M_free_list_link;
+                    _S_current_chunk = _S_chunk_of(p);
                     _S_start_free = (char*)p;
                     _S_end_free = _S_start_free + i;
                     // Recurse to use up the space.
@@ -346,15 +847,22 @@ _default_alloc_template<threads, inst>::_S_chunk_alloc(size_t size, int& nobjs)
                     // right free list.
                 }
             }
-            _S_end_free = nullptr;
-            // Use the first allocator.
-            _S_start_free = (char*)malloc_alloc::allocate(bytes_to_get);
+            // Use the first allocator.  Over-allocate so that an aligned
+            // chunk fits inside.
+            SHADOW_ALLOC_STAT(_Stats, _STAT_MALLOC_FALLBACK, 1);
+            void* base = malloc_alloc::allocate(2 * (size_t)_CHUNK_BYTES);
             // This should either throw an
             // exception or remedy the situation.  Thus we assume it
             // succeeded.
+            _Chunk* saved_spare = _S_spare_chunks;
+            _S_spare_chunks = (_Chunk*)(((uintptr_t)base + _CHUNK_BYTES - 1) & ~((uintptr_t)_CHUNK_BYTES - 1));
+            _S_spare_chunks->_M_next = saved_spare;
+            _S_spare_chunks->_M_malloc_base = base;
+            chunk = _S_new_chunk();
         }
-        _S_heap_size += bytes_to_get;
-        _S_end_free = _S_start_free + bytes_to_get;
+        _S_current_chunk = chunk;
+        _S_start_free = (char*)chunk + _CHUNK_HEADER;
+        _S_end_free = (char*)chunk + _CHUNK_BYTES;
         // Recurse to allocate the chunk.
         return _S_chunk_alloc(size, nobjs);
     }
@@ -363,9 +871,10 @@ _default_alloc_template<threads, inst>::_S_chunk_alloc(size_t size, int& nobjs)
 /* Returns an object of size __n, and optionally adds to size __n free list.*/
 /* We assume that __n is properly aligned.                                */
 /* We hold the allocation lock.                                         */
-template <bool threads, int inst>
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
 void*
-_default_alloc_template<threads, inst>::_S_refill(size_t n) {
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_refill(size_t n) {
+    SHADOW_ALLOC_STAT(_Stats, _STAT_REFILL + _S_freelist_index(n), 1);
     int nobjs = 20;
     char* chunk = _S_chunk_alloc(n, nobjs);
     _Obj* volatile* my_free_list;
@@ -396,16 +905,370 @@ _default_alloc_template<threads, inst>::_S_refill(size_t n) {
     return result;
 }
 
-template <bool threads, int inst>
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Obj*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_fetch_batch(size_t n, int& nobjs) {
+    _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
+    _Lock lock_instance;
+    _Obj* result = *my_free_list;
+    _Obj* last;
+    int i;
+
+    if (result == nullptr) {
+        // Nothing cached: hand out a fresh run straight from the pool
+        // instead of threading it through the free list first.
+        char* chunk = _S_chunk_alloc(n, nobjs);
+        _S_chunk_of(chunk)->_M_live += nobjs;
+        result = last = (_Obj*)chunk;
+        for (i = 1; i < nobjs; ++i) {
+            last->_M_free_list_link = (_Obj*)((char*)last + n);
+            last = last->_M_free_list_link;
+        }
+    } else {
+        last = result;
+        ++_S_chunk_of(last)->_M_live;
+        for (i = 1; i < nobjs && last->_M_free_list_link != nullptr; ++i) {
+            last = last->_M_free_list_link;
+            ++_S_chunk_of(last)->_M_live;
+        }
+        nobjs = i;
+        *my_free_list = last->_M_free_list_link;
+    }
+    SHADOW_ALLOC_STAT(_Stats, _STAT_REFILL + _S_freelist_index(n), 1);
+    SHADOW_ALLOC_STAT(_Stats, _STAT_ALLOC + _S_freelist_index(n), nobjs);
+    last->_M_free_list_link = nullptr;
+    return result;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_release_batch(size_t n, _Obj* first, _Obj* last) {
+    _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
+    _Lock lock_instance;
+    size_t count = 1;
+    for (_Obj* p = first; p != last; p = p->_M_free_list_link) {
+        --_S_chunk_of(p)->_M_live;
+        ++count;
+    }
+    --_S_chunk_of(last)->_M_live;
+    SHADOW_ALLOC_STAT(_Stats, _STAT_FREE + _S_freelist_index(n), count);
+    last->_M_free_list_link = *my_free_list;
+    *my_free_list = first;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::allocate_batch(size_t n, void** out, size_t count,
+                                                                    size_t align) {
+    size_t i;
+
+    if (n > (size_t)_MAX_BYTES || align > (size_t)_ALIGN) {
+        try {
+            for (i = 0; i < count; ++i) {
+                SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_ALLOC, 1);
+                out[i] = malloc_alloc::allocate(n, align);
+            }
+        } catch (...) {
+            while (i > 0) malloc_alloc::deallocate(out[--i], n);
+            throw;
+        }
+        return;
+    }
+    SHADOW_ALLOC_STAT(_Stats, _STAT_ALLOC + _S_freelist_index(n), count);
+    size_t size = _S_round_up(n);
+    _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
+    _Lock lock_instance;
+    _Obj* p = *my_free_list;
+    for (i = 0; i < count && p != nullptr; ++i) {
+        out[i] = p;
+        ++_S_chunk_of(p)->_M_live;
+        p = p->_M_free_list_link;
+    }
+    *my_free_list = p;
+    try {
+        // Carve the rest straight out of the pool.
+        while (i < count) {
+            int nobjs = count - i > (size_t)INT_MAX ? INT_MAX : (int)(count - i);
+            char* chunk = _S_chunk_alloc(size, nobjs);
+            _S_chunk_of(chunk)->_M_live += nobjs;
+            for (int j = 0; j < nobjs; ++j) {
+                out[i++] = chunk + j * size;
+            }
+        }
+    } catch (...) {
+        // Put back what we already took.
+        while (i > 0) {
+            _Obj* q = (_Obj*)out[--i];
+            --_S_chunk_of(q)->_M_live;
+            q->_M_free_list_link = *my_free_list;
+            *my_free_list = q;
+        }
+        throw;
+    }
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::deallocate_batch(size_t n, void** p, size_t count,
+                                                                      size_t align) {
+    size_t i;
+
+    if (count == 0) {
+        return;
+    }
+    if (n > (size_t)_MAX_BYTES || align > (size_t)_ALIGN) {
+        for (i = 0; i < count; ++i) {
+            SHADOW_ALLOC_STAT(_Stats, _STAT_LARGE_FREE, 1);
+            malloc_alloc::deallocate(p[i], n);
+        }
+        return;
+    }
+    SHADOW_ALLOC_STAT(_Stats, _STAT_FREE + _S_freelist_index(n), count);
+    // Chain the objects together before taking the lock.
+    for (i = 0; i + 1 < count; ++i) {
+        ((_Obj*)p[i])->_M_free_list_link = (_Obj*)p[i + 1];
+    }
+    _Obj* volatile* my_free_list = _S_free_list + _S_freelist_index(n);
+    _Lock lock_instance;
+    for (i = 0; i < count; ++i) {
+        --_S_chunk_of(p[i])->_M_live;
+    }
+    ((_Obj*)p[count - 1])->_M_free_list_link = *my_free_list;
+    *my_free_list = (_Obj*)p[0];
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+size_t
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::trim(size_t retain_bytes) {
+    _Lock lock_instance;
+    _Chunk* chunk;
+    _Chunk* next;
+    size_t released = 0;
+    bool any = false;
+
+    for (chunk = _S_chunks; chunk != nullptr; chunk = chunk->_M_next) {
+        chunk->_M_releasing = chunk->_M_live == 0;
+        any = any || chunk->_M_releasing;
+    }
+    if (!any) {
+        return 0;
+    }
+    // An idle current chunk goes too; the rest of it is simply dropped.
+    if (_S_current_chunk != nullptr && _S_current_chunk->_M_releasing) {
+        _S_current_chunk = nullptr;
+        _S_start_free = _S_end_free = nullptr;
+    }
+
+    // Unlink the free objects that live in the released chunks.
+    for (size_t index = 0; index < (size_t)_NFREELISTS; ++index) {
+        _Obj* volatile* link = _S_free_list + index;
+        while (*link != nullptr) {
+            if (_S_chunk_of(*link)->_M_releasing) {
+                *link = (*link)->_M_free_list_link;
+            } else {
+                link = &(*link)->_M_free_list_link;
+            }
+        }
+    }
+
+    // Spare chunks beyond the new retain limit go back first.
+    size_t spare_bytes = 0;
+    for (_Chunk** link = &_S_spare_chunks; *link != nullptr;) {
+        if (spare_bytes + _CHUNK_BYTES <= retain_bytes) {
+            spare_bytes += _CHUNK_BYTES;
+            link = &(*link)->_M_next;
+        } else {
+            chunk = *link;
+            *link = chunk->_M_next;
+            _S_release_chunk(chunk);
+        }
+    }
+
+    for (chunk = _S_chunks; chunk != nullptr; chunk = next) {
+        next = chunk->_M_next;
+        if (!chunk->_M_releasing) {
+            continue;
+        }
+        if (chunk->_M_prev != nullptr) {
+            chunk->_M_prev->_M_next = next;
+        } else {
+            _S_chunks = next;
+        }
+        if (next != nullptr) {
+            next->_M_prev = chunk->_M_prev;
+        }
+        _S_heap_size -= _CHUNK_BYTES;
+        released += _CHUNK_BYTES;
+
+        if (chunk->_M_malloc_base == nullptr && spare_bytes + _CHUNK_BYTES <= retain_bytes) {
+            // Keep the mapping, but let the kernel drop everything past
+            // the page holding the header.
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t keep = (_CHUNK_HEADER + page - 1) & ~(page - 1);
+            madvise((char*)chunk + keep, _CHUNK_BYTES - keep, MADV_DONTNEED);
+            chunk->_M_next = _S_spare_chunks;
+            _S_spare_chunks = chunk;
+            spare_bytes += _CHUNK_BYTES;
+        } else {
+            _S_release_chunk(chunk);
+        }
+    }
+    SHADOW_ALLOC_STAT(_Stats, _STAT_TRIM, 1);
+    SHADOW_ALLOC_STAT(_Stats, _STAT_TRIM_BYTES, released);
+    return released;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::stats_type
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::stats() {
+    uint64_t count[_STAT_COUNT] = {};
+    stats_type result;
+    _Chunk* chunk;
+    size_t index;
+
+#ifdef SHADOW_STL_ALLOC_STATS
+    _Stats::_S_sum(count);
+    result.counters_enabled = true;
+#else
+    result.counters_enabled = false;
+#endif
+    {
+        _Lock lock_instance;
+        result.heap_size = _S_heap_size;
+        result.chunks = 0;
+        for (chunk = _S_chunks; chunk != nullptr; chunk = chunk->_M_next) {
+            ++result.chunks;
+        }
+        result.spare_chunks = 0;
+        for (chunk = _S_spare_chunks; chunk != nullptr; chunk = chunk->_M_next) {
+            ++result.spare_chunks;
+        }
+        for (index = 0; index < (size_t)_NFREELISTS; ++index) {
+            size_t length = 0;
+            for (_Obj* p = _S_free_list[index]; p != nullptr; p = p->_M_free_list_link) {
+                ++length;
+            }
+            result.classes[index].free_objects = length;
+        }
+    }
+    for (index = 0; index < (size_t)_NFREELISTS; ++index) {
+        result.classes[index].size = _SizeClasses::_S_class_size(index);
+        result.classes[index].allocations = count[_STAT_ALLOC + index];
+        result.classes[index].deallocations = count[_STAT_FREE + index];
+        result.classes[index].refills = count[_STAT_REFILL + index];
+    }
+    result.large_allocations = count[_STAT_LARGE_ALLOC];
+    result.large_deallocations = count[_STAT_LARGE_FREE];
+    result.chunk_maps = count[_STAT_CHUNK_MAP];
+    result.spare_chunk_reuses = count[_STAT_SPARE_REUSE];
+    result.scavenges = count[_STAT_SCAVENGE];
+    result.malloc_fallbacks = count[_STAT_MALLOC_FALLBACK];
+    result.trims = count[_STAT_TRIM];
+    result.trimmed_bytes = count[_STAT_TRIM_BYTES];
+    result.lock_acquisitions = count[_STAT_LOCK];
+    result.lock_contentions = count[_STAT_LOCK_CONTENDED];
+    result.lock_wait_ns = count[_STAT_LOCK_WAIT_NS];
+    return result;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::dump_stats(FILE* out) {
+    stats_type st = stats();
+    fprintf(out, "{\"counters_enabled\": %s, \"heap_size\": %zu, \"chunks\": %zu, "
+                 "\"spare_chunks\": %zu, \"classes\": [",
+            st.counters_enabled ? "true" : "false", st.heap_size, st.chunks, st.spare_chunks);
+    for (size_t index = 0; index < (size_t)_NFREELISTS; ++index) {
+        const typename stats_type::size_class& c = st.classes[index];
+        fprintf(out, "%s{\"size\": %zu, \"free_objects\": %zu, \"allocations\": %llu, "
+                     "\"deallocations\": %llu, \"refills\": %llu}",
+                index == 0 ? "" : ", ", c.size, c.free_objects,
+                (unsigned long long)c.allocations, (unsigned long long)c.deallocations,
+                (unsigned long long)c.refills);
+    }
+    fprintf(out, "], \"large_allocations\": %llu, \"large_deallocations\": %llu, "
+                 "\"chunk_maps\": %llu, \"spare_chunk_reuses\": %llu, \"scavenges\": %llu, "
+                 "\"malloc_fallbacks\": %llu, \"trims\": %llu, \"trimmed_bytes\": %llu, "
+                 "\"lock_acquisitions\": %llu, \"lock_contentions\": %llu, \"lock_wait_ns\": %llu}",
+            (unsigned long long)st.large_allocations, (unsigned long long)st.large_deallocations,
+            (unsigned long long)st.chunk_maps, (unsigned long long)st.spare_chunk_reuses,
+            (unsigned long long)st.scavenges, (unsigned long long)st.malloc_fallbacks,
+            (unsigned long long)st.trims, (unsigned long long)st.trimmed_bytes,
+            (unsigned long long)st.lock_acquisitions, (unsigned long long)st.lock_contentions,
+            (unsigned long long)st.lock_wait_ns);
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_loop(void*) {
+    pthread_mutex_lock(&_S_trim_mutex);
+    while (_S_trim_running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += _S_trim_interval_ms / 1000;
+        deadline.tv_nsec += (long)(_S_trim_interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+        // Sleep out the whole interval unless we are being stopped.
+        while (_S_trim_running &&
+               pthread_cond_timedwait(&_S_trim_cond, &_S_trim_mutex, &deadline) == 0) {
+        }
+        if (_S_trim_running) {
+            trim(_S_trim_retain);
+        }
+    }
+    pthread_mutex_unlock(&_S_trim_mutex);
+    return nullptr;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+bool
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::start_periodic_trim(unsigned interval_ms,
+                                                                          size_t retain_bytes) {
+    // Without the node allocator lock the trimming thread would race
+    // with the client.
+    if (!threads) {
+        return false;
+    }
+    pthread_mutex_lock(&_S_trim_mutex);
+    bool started = false;
+    if (!_S_trim_running) {
+        _S_trim_interval_ms = interval_ms;
+        _S_trim_retain = retain_bytes;
+        _S_trim_running = true;
+        started = pthread_create(&_S_trim_thread, nullptr, _S_trim_loop, nullptr) == 0;
+        _S_trim_running = started;
+    }
+    pthread_mutex_unlock(&_S_trim_mutex);
+    return started;
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+void
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::stop_periodic_trim() {
+    pthread_mutex_lock(&_S_trim_mutex);
+    bool running = _S_trim_running;
+    _S_trim_running = false;
+    pthread_cond_signal(&_S_trim_cond);
+    pthread_mutex_unlock(&_S_trim_mutex);
+    if (running) {
+        pthread_join(_S_trim_thread, nullptr);
+    }
+}
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
 void*
-_default_alloc_template<threads, inst>::reallocate(void* p, size_t old_sz, size_t new_sz) {
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::reallocate(void* p, size_t old_sz, size_t new_sz) {
     void* result;
     size_t copy_sz;
 
     if (old_sz > (size_t)_MAX_BYTES && new_sz > (size_t)_MAX_BYTES) {
-        return realloc(p, new_sz);
+        return malloc_alloc::reallocate(p, old_sz, new_sz);
     }
-    if (_S_round_up(old_sz) == _S_round_up(new_sz)) {
+    if (old_sz <= (size_t)_MAX_BYTES && new_sz <= (size_t)_MAX_BYTES &&
+        _S_round_up(old_sz) == _S_round_up(new_sz)) {
         return p;
     }
     result = allocate(new_sz);
@@ -416,21 +1279,53 @@ _default_alloc_template<threads, inst>::reallocate(void* p, size_t old_sz, size_
 }
 
 #ifdef SHADOW_STL_THREADS
-template <bool threads, int inst>
-_Shadow_STL_mutex_lock _default_alloc_template<threads, inst>::_S_node_allocator_lock;
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+_Shadow_STL_profiled_t<_Mutex> _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_node_allocator_lock
+    SHADOW_STL_LOCK_NAME("node allocator");
 #endif
 
-template <bool threads, int inst>
-char* _default_alloc_template<threads, inst>::_S_start_free = nullptr;
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+char* _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_start_free = nullptr;
 
-template <bool threads, int inst>
-char* _default_alloc_template<threads, inst>::_S_end_free = nullptr;
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+char* _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_end_free = nullptr;
 
-template <bool threads, int inst>
-typename _default_alloc_template<threads, inst>::_Obj* volatile _default_alloc_template<threads, inst>::_S_free_list[_NFREELISTS] = {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+// All heads start out null.
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Obj* volatile _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_free_list[_NFREELISTS];
 
-template <bool threads, int inst>
-size_t _default_alloc_template<threads, inst>::_S_heap_size = 0;
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+size_t _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_heap_size = 0;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Chunk*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_current_chunk = nullptr;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Chunk*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_chunks = nullptr;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+typename _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_Chunk*
+_default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_spare_chunks = nullptr;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+pthread_mutex_t _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+pthread_cond_t _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_cond = PTHREAD_COND_INITIALIZER;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+pthread_t _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_thread;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+bool _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_running = false;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+unsigned _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_interval_ms = 0;
+
+template <bool threads, int inst, typename _SizeClasses, typename _Mutex>
+size_t _default_alloc_template<threads, inst, _SizeClasses, _Mutex>::_S_trim_retain = 0;
 
 template <typename T>
 class allocator {
@@ -461,14 +1356,15 @@ public:
     }
 
     // n is permitted to be 0.  The C++ standard says nothing about what
-    // the return value is when n == 0.
+    // the return value is when n == 0.  The storage is aligned for T,
+    // including over-aligned types.
     static T* allocate(size_type n, const void* hint = 0) {
-        return n != 0 ? static_cast<T*>(_Alloc::allocate(n * sizeof(T))): nullptr;
+        return n != 0 ? static_cast<T*>(_Alloc::allocate(n * sizeof(T), alignof(T))): nullptr;
     }
 
     // p is not permitted to be a null pointer.
     static void deallocate(pointer p, size_type n) {
-        _Alloc::deallocate(p, n * sizeof(T));
+        _Alloc::deallocate(p, n * sizeof(T), alignof(T));
     }
 
     size_type max_size() const noexcept {
@@ -637,11 +1533,11 @@ struct _Alloc_traits<T, _malloc_alloc_template<inst>> {
     using allocator_type = _malloc_alloc_template<inst>;
 };
 
-template <typename T, bool threads, int inst>
-struct _Alloc_traits<T, _default_alloc_template<threads, inst>> {
+template <typename T, bool threads, int inst, typename _SizeClasses, typename _Mutex>
+struct _Alloc_traits<T, _default_alloc_template<threads, inst, _SizeClasses, _Mutex>> {
     static const bool _S_instanceless = true;
-    using _Alloc_type = simple_alloc<T, _default_alloc_template<threads, inst>>;
-    using allocator_type = _default_alloc_template<threads, inst>;
+    using _Alloc_type = simple_alloc<T, _default_alloc_template<threads, inst, _SizeClasses, _Mutex>>;
+    using allocator_type = _default_alloc_template<threads, inst, _SizeClasses, _Mutex>;
 };
 
 template <typename T, typename _Alloc>
@@ -660,11 +1556,11 @@ struct _Alloc_traits<T1, _allocator<T2, _malloc_alloc_template<inst>>> {
     using allocator_type = _allocator<T2, _malloc_alloc_template<inst>>;
 };
 
-template <typename T1, typename T2, bool threads, int inst>
-struct _Alloc_traits<T1, _allocator<T2, _default_alloc_template<threads, inst>>> {
+template <typename T1, typename T2, bool threads, int inst, typename _SizeClasses, typename _Mutex>
+struct _Alloc_traits<T1, _allocator<T2, _default_alloc_template<threads, inst, _SizeClasses, _Mutex>>> {
     static const bool _S_instanceless = true;
-    using _Alloc_type = simple_alloc<T1, _default_alloc_template<threads, inst>>;
-    using allocator_type = _allocator<T2, _default_alloc_template<threads, inst>>;
+    using _Alloc_type = simple_alloc<T1, _default_alloc_template<threads, inst, _SizeClasses, _Mutex>>;
+    using allocator_type = _allocator<T2, _default_alloc_template<threads, inst, _SizeClasses, _Mutex>>;
 };
 
 template <typename T1, typename T2, typename _Alloc>
@@ -674,6 +1570,16 @@ struct _Alloc_traits<T1, _allocator<T2, debug_alloc<_Alloc>>> {
     using allocator_type = _allocator<T2, debug_alloc<_Alloc>>;
 };
 
+// _Is_monotonic_alloc<_Alloc>::_Monotonic is _true_type for allocators
+// whose deallocate does nothing, because their memory is released all
+// at once (see monotonic_arena).  Containers use it to skip walking
+// their nodes on destruction when the elements are trivially
+// destructible.
+template <typename _Alloc>
+struct _Is_monotonic_alloc {
+    using _Monotonic = _false_type;
+};
+
 
 SHADOW_STL_END_NAMESPACE
 
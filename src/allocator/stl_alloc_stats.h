@@ -0,0 +1,106 @@
+#ifndef SHADOW_STL_INTERNAL_ALLOC_STATS_H
+#define SHADOW_STL_INTERNAL_ALLOC_STATS_H
+
+// Optional event counters for the allocators.  Compile with
+// SHADOW_STL_ALLOC_STATS defined to enable them.  Otherwise
+// SHADOW_ALLOC_STAT expands to nothing, and the allocators carry no
+// counting code at all.
+//
+// Every thread increments its own copy of the counters, so counting
+// needs neither atomic read-modify-write operations nor shared cache
+// lines.  Reading the counters sums the copies of all live threads plus
+// whatever exited threads left behind.
+
+#include <atomic>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "include/stl_config.h"
+
+#ifdef SHADOW_STL_ALLOC_STATS
+#define SHADOW_ALLOC_STAT(__counters, __which, __n) __counters::_S_add((__which), (__n))
+#else
+#define SHADOW_ALLOC_STAT(__counters, __which, __n) ((void)0)
+#endif
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// _N counters per thread.  _Tag only serves to give every user its own
+// set of counters.
+template <typename _Tag, size_t _N>
+class _Thread_counters {
+private:
+    struct _Block {
+        // Written only by the owning thread, read by anyone.
+        std::atomic<uint64_t> _M_count[_N];
+        _Block* _M_next;
+        _Block* _M_prev;
+
+        _Block() : _M_prev(nullptr) {
+            for (size_t i = 0; i < _N; ++i) {
+                _M_count[i].store(0, std::memory_order_relaxed);
+            }
+            pthread_mutex_lock(&_S_mutex);
+            _M_next = _S_blocks;
+            if (_S_blocks != nullptr) _S_blocks->_M_prev = this;
+            _S_blocks = this;
+            pthread_mutex_unlock(&_S_mutex);
+        }
+        // Hands the counts of an exiting thread over to _S_retired.
+        ~_Block() {
+            pthread_mutex_lock(&_S_mutex);
+            for (size_t i = 0; i < _N; ++i) {
+                _S_retired[i] += _M_count[i].load(std::memory_order_relaxed);
+            }
+            if (_M_prev != nullptr) {
+                _M_prev->_M_next = _M_next;
+            } else {
+                _S_blocks = _M_next;
+            }
+            if (_M_next != nullptr) _M_next->_M_prev = _M_prev;
+            pthread_mutex_unlock(&_S_mutex);
+        }
+    };
+
+    static thread_local _Block _S_block;
+    static pthread_mutex_t _S_mutex;
+    static _Block* _S_blocks;
+    static uint64_t _S_retired[_N];
+
+public:
+    static void _S_add(size_t which, uint64_t n) {
+        std::atomic<uint64_t>& count = _S_block._M_count[which];
+        count.store(count.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Stores the totals over all threads in result[0 .. _N).
+    static void _S_sum(uint64_t* result) {
+        pthread_mutex_lock(&_S_mutex);
+        for (size_t i = 0; i < _N; ++i) {
+            result[i] = _S_retired[i];
+        }
+        for (_Block* b = _S_blocks; b != nullptr; b = b->_M_next) {
+            for (size_t i = 0; i < _N; ++i) {
+                result[i] += b->_M_count[i].load(std::memory_order_relaxed);
+            }
+        }
+        pthread_mutex_unlock(&_S_mutex);
+    }
+};
+
+template <typename _Tag, size_t _N>
+thread_local typename _Thread_counters<_Tag, _N>::_Block _Thread_counters<_Tag, _N>::_S_block;
+
+template <typename _Tag, size_t _N>
+pthread_mutex_t _Thread_counters<_Tag, _N>::_S_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+template <typename _Tag, size_t _N>
+typename _Thread_counters<_Tag, _N>::_Block* _Thread_counters<_Tag, _N>::_S_blocks = nullptr;
+
+template <typename _Tag, size_t _N>
+uint64_t _Thread_counters<_Tag, _N>::_S_retired[_N];
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_ALLOC_STATS_H
@@ -0,0 +1,185 @@
+#ifndef SHADOW_STL_INTERNAL_ARENA_ALLOC_H
+#define SHADOW_STL_INTERNAL_ARENA_ALLOC_H
+
+// Monotonic arena for containers that live and die together, e.g. for
+// the duration of one request.  Allocation bumps a pointer through a
+// chain of blocks obtained from malloc_alloc; deallocation does nothing.
+// reset() rewinds the arena to its first block in constant time and
+// keeps every block for reuse; release() gives the blocks back.
+//
+// arena_allocator<T> is a standard-conforming allocator that refers to
+// an arena.  Containers store it (it has distinct instances), and skip
+// freeing their nodes one by one when the elements are trivially
+// destructible (see _Is_monotonic_alloc).
+//
+// The arena is not thread safe.  It must not be reset or released
+// before every container using it has been destroyed.
+
+#include <stddef.h>
+
+#include "allocator/stl_alloc.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+class monotonic_arena {
+private:
+    struct _Block {
+        _Block* _M_next;
+        size_t _M_size;         // usable bytes following the header
+    };
+    enum { _HEADER = (sizeof(_Block) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1) };
+    enum { _MIN_BLOCK = 4096 - _HEADER };
+
+    _Block* _M_first;           // blocks in the order they are used
+    _Block* _M_current;         // block the bump pointer lies in
+    char* _M_cur;
+    char* _M_end;
+    size_t _M_next_size;        // size of the next block to get
+
+    static char* _S_data(_Block* b) { return (char*)b + _HEADER; }
+    static char* _S_align_up(char* p, size_t align) {
+        return (char*)(((size_t)p + align - 1) & ~(align - 1));
+    }
+
+    // Moves on to a block that has room for n bytes aligned to align,
+    // reusing the blocks after the current one.
+    void* _M_allocate_slow(size_t n, size_t align) {
+        _Block* next = _M_current != nullptr ? _M_current->_M_next : _M_first;
+        if (next == nullptr || next->_M_size < n + align - 1) {
+            size_t size = _M_next_size;
+            while (size < n + align - 1) size *= 2;
+            _M_next_size = size * 2;
+            _Block* b = (_Block*)malloc_alloc::allocate(_HEADER + size);
+            b->_M_size = size;
+            b->_M_next = next;
+            if (_M_current != nullptr) {
+                _M_current->_M_next = b;
+            } else {
+                _M_first = b;
+            }
+            next = b;
+        }
+        _M_current = next;
+        _M_cur = _S_data(next);
+        _M_end = _M_cur + next->_M_size;
+        return allocate(n, align);
+    }
+
+public:
+    explicit monotonic_arena(size_t initial_bytes = _MIN_BLOCK)
+        : _M_first(nullptr), _M_current(nullptr), _M_cur(nullptr), _M_end(nullptr),
+          _M_next_size(initial_bytes < (size_t)_MIN_BLOCK ? (size_t)_MIN_BLOCK : initial_bytes) {}
+    monotonic_arena(const monotonic_arena&) = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+    ~monotonic_arena() { release(); }
+
+    // align must be a power of two.
+    void* allocate(size_t n, size_t align = alignof(max_align_t)) {
+        char* result = _S_align_up(_M_cur, align);
+        if (_M_cur == nullptr || n > (size_t)(_M_end - result)) {
+            return _M_allocate_slow(n, align);
+        }
+        _M_cur = result + n;
+        return result;
+    }
+
+    void deallocate(void* /* p */, size_t /* n */) {}
+
+    // Makes all memory handed out so far available again.  Constant
+    // time; the blocks are kept.
+    void reset() {
+        _M_current = _M_first;
+        _M_cur = _M_first != nullptr ? _S_data(_M_first) : nullptr;
+        _M_end = _M_first != nullptr ? _M_cur + _M_first->_M_size : nullptr;
+    }
+
+    // Returns every block to malloc_alloc.
+    void release() {
+        while (_M_first != nullptr) {
+            _Block* next = _M_first->_M_next;
+            malloc_alloc::deallocate(_M_first, _HEADER + _M_first->_M_size);
+            _M_first = next;
+        }
+        _M_current = nullptr;
+        _M_cur = _M_end = nullptr;
+    }
+
+    // Bytes obtained from malloc_alloc, excluding block headers.
+    size_t capacity() const {
+        size_t result = 0;
+        for (_Block* b = _M_first; b != nullptr; b = b->_M_next) {
+            result += b->_M_size;
+        }
+        return result;
+    }
+};
+
+template <typename T>
+class arena_allocator {
+    template <typename T1> friend class arena_allocator;
+
+    monotonic_arena* _M_arena;
+
+public:
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+    using value_type = T;
+
+    template <typename T1> struct rebind {
+        using other = arena_allocator<T1>;
+    };
+
+    arena_allocator(monotonic_arena& a) noexcept : _M_arena(&a) {}
+    arena_allocator(const arena_allocator& a) noexcept : _M_arena(a._M_arena) {}
+    template <typename T1> arena_allocator(const arena_allocator<T1>& a) noexcept : _M_arena(a._M_arena) {}
+    ~arena_allocator() noexcept {}
+
+    monotonic_arena& arena() const noexcept { return *_M_arena; }
+
+    pointer address(reference x) const noexcept {
+        return &x;
+    }
+    const_pointer address(const_reference x) const noexcept {
+        return &x;
+    }
+
+    T* allocate(size_type n, const void* /* hint */ = 0) {
+        return n != 0 ? static_cast<T*>(_M_arena->allocate(n * sizeof(T), alignof(T))) : nullptr;
+    }
+
+    void deallocate(pointer /* p */, size_type /* n */) {}
+
+    size_type max_size() const noexcept {
+        return size_t(-1) / sizeof(T);
+    }
+
+    void construct(pointer p, const T& val) {
+        new (p) T(val);
+    }
+    void destroy(pointer p) {
+        p->~T();
+    }
+};
+
+template <typename T1, typename T2>
+inline bool operator==(const arena_allocator<T1>& a, const arena_allocator<T2>& b) {
+    return &a.arena() == &b.arena();
+}
+
+template <typename T1, typename T2>
+inline bool operator!=(const arena_allocator<T1>& a, const arena_allocator<T2>& b) {
+    return &a.arena() != &b.arena();
+}
+
+template <typename T>
+struct _Is_monotonic_alloc<arena_allocator<T>> {
+    using _Monotonic = _true_type;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_ARENA_ALLOC_H
@@ -2,6 +2,7 @@
 #define SHADOW_STL_INTERNAL_CONSTRUCT_H
 
 #include <new>  // placement new
+#include <utility>
 
 #include "include/type_traits.h"
 #include "iterator/stl_iterator_base.h"
@@ -14,14 +15,10 @@
 
 // Internal names
 
-template <typename T1, typename T2>
-inline void _Construct(T1* p, const T2& value) {
-    new ((void*)p) T1(value);
-}
-
-template <typename T>
-inline void _Construct(T* p) {
-    new ((void*)p) T();
+// Constructs a T1 at p from args, value-initializes it without args.
+template <typename T1, typename... Args>
+inline void _Construct(T1* p, Args&&... args) {
+    new ((void*)p) T1(std::forward<Args>(args)...);
 }
 
 template <typename T>
@@ -33,7 +30,7 @@ template <typename ForwardIterator>
 void 
 _destroy_aux(ForwardIterator first, ForwardIterator last, _false_type) {
     for (; first < last; ++first) {
-        destroy(&*first);
+        _Destroy(&*first);
     }
 }
 
@@ -64,14 +61,9 @@ inline void _Destroy(double*, double*) {}
 
 // --------------------------------------------------
 // Old names from the HP STL.
-template <typename T1, typename T2>
-inline void construct(T1* p, const T2& value) {
-    _Construct(p, value);
-}
-
-template <typename T>
-inline void construct(T* p) {
-    _Construct(p);
+template <typename T1, typename... Args>
+inline void construct(T1* p, Args&&... args) {
+    _Construct(p, std::forward<Args>(args)...);
 }
 
 template <typename T>
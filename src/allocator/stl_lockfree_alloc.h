@@ -0,0 +1,266 @@
+#ifndef SHADOW_STL_INTERNAL_LOCKFREE_ALLOC_H
+#define SHADOW_STL_INTERNAL_LOCKFREE_ALLOC_H
+
+// Node allocator with lock-free free lists.  It has the same size classes
+// as _default_alloc_template and also carves objects out of large
+// chunks, but every free list head is an atomic Treiber stack, so allocate and
+// deallocate never lock as long as the free list is not empty.  Only
+// refilling an empty list, which may need to grow the pool, takes the
+// pool lock.
+//
+// Memory handed to the pool is never returned to the system; unlike
+// _default_alloc_template there is no trim().  The
+// Treiber stack relies on this: a thread may read the link of a node that
+// another thread has just popped, and that read must not fault.
+
+#include <atomic>
+#include <stdint.h>
+
+#include "allocator/stl_alloc.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+template <int inst, typename _SizeClasses = _Default_size_classes>
+class _Lockfree_alloc_template {
+private:
+    enum { _ALIGN = _SizeClasses::_S_align };
+    enum { _MAX_BYTES = _SizeClasses::_S_max_bytes };
+    enum { _NFREELISTS = _SizeClasses::_S_nclasses };
+    enum { _CACHE_LINE = 64 };
+
+    static constexpr size_t _S_round_up(size_t bytes) {
+        return _SizeClasses::_S_round_up(bytes);
+    }
+    static constexpr size_t _S_align_up(size_t bytes) {
+        return (((bytes) + (size_t)_ALIGN - 1) & ~((size_t)(_ALIGN) - 1));
+    }
+    static constexpr size_t _S_freelist_index(size_t bytes) {
+        return _SizeClasses::_S_index(bytes);
+    }
+
+    union _Obj {
+        union _Obj* _M_free_list_link;
+        char _M_client_data[1]; // The client sees this.
+    };
+
+    // A free list head packs a 16 bit modification count into the unused
+    // top bits of the pointer.  Every push and pop bumps the count, so a
+    // head that was popped and pushed back between our load and our CAS
+    // no longer compares equal (the ABA problem).  This assumes user
+    // space addresses fit in 48 bits, which holds on x86-64 and AArch64.
+    using _Tagged = uintptr_t;
+    enum { _TAG_SHIFT = 48 };
+    static_assert(sizeof(void*) == 8, "tagged free lists need 64 bit pointers");
+
+    static _Obj* _S_ptr(_Tagged t) {
+        return (_Obj*)(t & (((uintptr_t)1 << _TAG_SHIFT) - 1));
+    }
+    static _Tagged _S_retag(_Tagged old, _Obj* p) {
+        return (uintptr_t)p | (((old >> _TAG_SHIFT) + 1) << _TAG_SHIFT);
+    }
+
+    // The link of a node may be read by a popping thread while the node's
+    // new owner overwrites it.  The value read is then discarded by the
+    // failing CAS, but the accesses themselves must be atomic.
+    static _Obj* _S_load_link(_Obj* p) {
+        return __atomic_load_n(&p->_M_free_list_link, __ATOMIC_RELAXED);
+    }
+    static void _S_store_link(_Obj* p, _Obj* next) {
+        __atomic_store_n(&p->_M_free_list_link, next, __ATOMIC_RELAXED);
+    }
+
+    // One head per cache line, so that threads working on different size
+    // classes do not contend.
+    struct alignas(_CACHE_LINE) _Head {
+        std::atomic<_Tagged> _M_top;
+    };
+    static _Head _S_free_list[_NFREELISTS];
+
+    static _Obj* _S_pop(_Head& head) {
+        _Tagged old = head._M_top.load(std::memory_order_acquire);
+        for (;;) {
+            _Obj* result = _S_ptr(old);
+            if (result == nullptr) {
+                return nullptr;
+            }
+            _Tagged next = _S_retag(old, _S_load_link(result));
+            if (head._M_top.compare_exchange_weak(old, next,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_acquire)) {
+                return result;
+            }
+        }
+    }
+
+    // Pushes the chain [first, last].
+    static void _S_push(_Head& head, _Obj* first, _Obj* last) {
+        _Tagged old = head._M_top.load(std::memory_order_relaxed);
+        for (;;) {
+            _S_store_link(last, _S_ptr(old));
+            if (head._M_top.compare_exchange_weak(old, _S_retag(old, first),
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    // Returns an object of size n, and adds more objects to the size n
+    // free list.  Takes the pool lock.
+    static void* _S_refill(size_t n);
+    // Allocates a chunk for nobjs of size "size".  nobjs may be reduced
+    // if it is inconvenient to allocate the requested number.  We hold
+    // the pool lock.
+    static char* _S_chunk_alloc(size_t size, int& nobjs);
+
+    // Chunk allocation state, guarded by _S_pool_lock.
+    static char* _S_start_free;
+    static char* _S_end_free;
+    static size_t _S_heap_size;
+    static _Shadow_STL_profiled_t<_Shadow_STL_mutex_lock> _S_pool_lock;
+
+public:
+    static void* allocate(size_t n) {
+        if (n > (size_t)_MAX_BYTES) {
+            return malloc_alloc::allocate(n);
+        }
+        _Obj* result = _S_pop(_S_free_list[_S_freelist_index(n)]);
+        if (result == nullptr) {
+            return _S_refill(_S_round_up(n));
+        }
+        return result;
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (n > (size_t)_MAX_BYTES) {
+            malloc_alloc::deallocate(p, n);
+        } else {
+            _S_push(_S_free_list[_S_freelist_index(n)], (_Obj*)p, (_Obj*)p);
+        }
+    }
+
+    static void* reallocate(void* p, size_t old_sz, size_t new_sz);
+};
+
+using lockfree_alloc = _Lockfree_alloc_template<0>;
+
+template <int inst, typename _SizeClasses>
+char* _Lockfree_alloc_template<inst, _SizeClasses>::_S_chunk_alloc(size_t size, int& nobjs) {
+    char* result;
+    size_t total_bytes = size * nobjs;
+    size_t bytes_left = _S_end_free - _S_start_free;
+
+    if (bytes_left >= total_bytes) {
+        result = _S_start_free;
+        _S_start_free += total_bytes;
+        return result;
+    } else if (bytes_left >= size) {
+        nobjs = (int)(bytes_left / size);
+        total_bytes = size * nobjs;
+        result = _S_start_free;
+        _S_start_free += total_bytes;
+        return result;
+    } else {
+        size_t bytes_to_get = 2 * total_bytes + _S_align_up(_S_heap_size >> 4);
+        // Slack to align chunks for over-aligned size classes.
+        size_t slack = (size_t)_ALIGN > alignof(max_align_t)
+                           ? (size_t)_ALIGN - alignof(max_align_t) : 0;
+        // Try to make use of the left-over piece.
+        if (bytes_left > 0) {
+            _Obj* left_over = (_Obj*)_S_start_free;
+            _S_push(_S_free_list[_SizeClasses::_S_index_floor(bytes_left)], left_over, left_over);
+        }
+        // Unlike _default_alloc_template we cannot scavenge the free lists
+        // for a larger object when malloc fails: other threads pop from
+        // them without holding the pool lock.  malloc_alloc either
+        // succeeds or runs the out-of-memory handler.
+        _S_start_free = (char*)malloc_alloc::allocate(bytes_to_get + slack);
+        _S_start_free = (char*)_S_align_up((size_t)_S_start_free);
+        _S_heap_size += bytes_to_get;
+        _S_end_free = _S_start_free + bytes_to_get;
+        return _S_chunk_alloc(size, nobjs);
+    }
+}
+
+template <int inst, typename _SizeClasses>
+void* _Lockfree_alloc_template<inst, _SizeClasses>::_S_refill(size_t n) {
+    _Head& head = _S_free_list[_S_freelist_index(n)];
+    _Shadow_STL_auto_lock lock_instance(_S_pool_lock);
+
+    // Another thread may have refilled the list while we were waiting.
+    _Obj* result = _S_pop(head);
+    if (result != nullptr) {
+        return result;
+    }
+
+    int nobjs = 20;
+    char* chunk = _S_chunk_alloc(n, nobjs);
+    if (1 == nobjs) {
+        return chunk;
+    }
+
+    // Link objects 1 .. nobjs-1 privately, then publish them with one CAS.
+    _Obj* first = (_Obj*)(chunk + n);
+    _Obj* last = first;
+    for (int i = 2; i < nobjs; ++i) {
+        _Obj* next = (_Obj*)((char*)last + n);
+        last->_M_free_list_link = next;
+        last = next;
+    }
+    _S_push(head, first, last);
+    return chunk;
+}
+
+template <int inst, typename _SizeClasses>
+void* _Lockfree_alloc_template<inst, _SizeClasses>::reallocate(void* p, size_t old_sz, size_t new_sz) {
+    void* result;
+    size_t copy_sz;
+
+    if (old_sz > (size_t)_MAX_BYTES && new_sz > (size_t)_MAX_BYTES) {
+        return malloc_alloc::reallocate(p, old_sz, new_sz);
+    }
+    if (old_sz <= (size_t)_MAX_BYTES && new_sz <= (size_t)_MAX_BYTES &&
+        _S_round_up(old_sz) == _S_round_up(new_sz)) {
+        return p;
+    }
+    result = allocate(new_sz);
+    copy_sz = new_sz > old_sz ? old_sz : new_sz;
+    memcpy(result, p, copy_sz);
+    deallocate(p, old_sz);
+    return result;
+}
+
+template <int inst, typename _SizeClasses>
+typename _Lockfree_alloc_template<inst, _SizeClasses>::_Head
+_Lockfree_alloc_template<inst, _SizeClasses>::_S_free_list[_NFREELISTS];
+
+template <int inst, typename _SizeClasses>
+char* _Lockfree_alloc_template<inst, _SizeClasses>::_S_start_free = nullptr;
+
+template <int inst, typename _SizeClasses>
+char* _Lockfree_alloc_template<inst, _SizeClasses>::_S_end_free = nullptr;
+
+template <int inst, typename _SizeClasses>
+size_t _Lockfree_alloc_template<inst, _SizeClasses>::_S_heap_size = 0;
+
+template <int inst, typename _SizeClasses>
+_Shadow_STL_profiled_t<_Shadow_STL_mutex_lock> _Lockfree_alloc_template<inst, _SizeClasses>::_S_pool_lock
+    SHADOW_STL_LOCK_NAME("lockfree pool");
+
+template <typename T, int inst, typename _SizeClasses>
+struct _Alloc_traits<T, _Lockfree_alloc_template<inst, _SizeClasses>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T, _Lockfree_alloc_template<inst, _SizeClasses>>;
+    using allocator_type = _Lockfree_alloc_template<inst, _SizeClasses>;
+};
+
+template <typename T1, typename T2, int inst, typename _SizeClasses>
+struct _Alloc_traits<T1, _allocator<T2, _Lockfree_alloc_template<inst, _SizeClasses>>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T1, _Lockfree_alloc_template<inst, _SizeClasses>>;
+    using allocator_type = _allocator<T2, _Lockfree_alloc_template<inst, _SizeClasses>>;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_LOCKFREE_ALLOC_H
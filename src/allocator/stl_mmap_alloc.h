@@ -0,0 +1,247 @@
+#ifndef SHADOW_STL_INTERNAL_MMAP_ALLOC_H
+#define SHADOW_STL_INTERNAL_MMAP_ALLOC_H
+
+// Allocator for large blocks that maps them straight from the kernel.
+// Every block of at least _MMAP_THRESHOLD bytes gets its own virtual
+// range, reserved with twice the requested size.  Only the requested
+// part is accessible; the rest stays PROT_NONE and is committed when the
+// block grows through reallocate, so a growing block keeps its address
+// as long as it fits its reservation, and moves with mremap, without
+// copying, when it does not.  Smaller requests go to malloc_alloc.
+//
+// With huge_pages set, blocks are aligned to 2M, committed in 2M steps,
+// and marked MADV_HUGEPAGE, so that transparent huge pages can back
+// them.  This cuts the TLB misses of multi-GB vectors.  Whether huge
+// pages are actually used is up to the kernel (see
+// /sys/kernel/mm/transparent_hugepage/enabled).
+//
+// A block starts with the page following its header page:
+//
+//   [header page][committed ... | PROT_NONE ...]
+//                ^ client pointer
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "allocator/stl_alloc.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+template <bool huge_pages, int inst>
+class _mmap_alloc_template {
+private:
+    enum : size_t { _MMAP_THRESHOLD = 128 * 1024 };
+    enum : size_t { _HUGE_PAGE = 2 * 1024 * 1024 };
+
+    // Lives at the start of the header page.  Sizes exclude the header
+    // page.
+    struct _Header {
+        size_t _M_reserved;
+        size_t _M_committed;
+    };
+
+    static size_t _S_page_size() {
+        static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        return page;
+    }
+    // Unit in which blocks are committed.
+    static size_t _S_granule() {
+        return huge_pages ? (size_t)_HUGE_PAGE : _S_page_size();
+    }
+    static size_t _S_round_up(size_t bytes, size_t unit) {
+        return (bytes + unit - 1) & ~(unit - 1);
+    }
+    static _Header* _S_header(void* p) {
+        return (_Header*)((char*)p - _S_page_size());
+    }
+
+    // Reserves a PROT_NONE range with room for the header page and
+    // reserved client bytes, and returns the client pointer, or nullptr.
+    static char* _S_reserve(size_t reserved);
+    // Makes the client bytes [from, to) of p accessible.
+    static bool _S_commit(char* p, size_t from, size_t to);
+    static void* _S_map(size_t n);
+    static void* _S_remap(void* p, size_t old_sz, size_t new_sz);
+
+public:
+    static void* allocate(size_t n) {
+        if (n < (size_t)_MMAP_THRESHOLD) {
+            return malloc_alloc::allocate(n);
+        }
+        void* result = _S_map(n);
+        if (result == nullptr) { SHADOW_THROW_BAD_ALLOC; }
+        return result;
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (n < (size_t)_MMAP_THRESHOLD) {
+            malloc_alloc::deallocate(p, n);
+        } else {
+            munmap(_S_header(p), _S_page_size() + _S_header(p)->_M_reserved);
+        }
+    }
+
+    static void* reallocate(void* p, size_t old_sz, size_t new_sz);
+};
+
+using mmap_alloc = _mmap_alloc_template<false, 0>;
+using huge_page_alloc = _mmap_alloc_template<true, 0>;
+
+template <bool huge_pages, int inst>
+char* _mmap_alloc_template<huge_pages, inst>::_S_reserve(size_t reserved) {
+    size_t page = _S_page_size();
+    // Huge page mode needs the client bytes 2M aligned: map extra and
+    // cut the range down afterwards.
+    size_t slack = huge_pages ? (size_t)_HUGE_PAGE : 0;
+    size_t map_bytes = page + reserved + slack;
+    char* base = (char*)mmap(nullptr, map_bytes, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (char*)MAP_FAILED) {
+        return nullptr;
+    }
+    char* result = (char*)_S_round_up((size_t)base + page, _S_granule());
+    char* head = result - page;
+    char* tail = result + reserved;
+    if (head != base) {
+        munmap(base, head - base);
+    }
+    if (tail != base + map_bytes) {
+        munmap(tail, base + map_bytes - tail);
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+        // Covering the header page too keeps header and committed bytes
+        // in one mapping, which _S_remap relies on.
+        madvise(head, page + reserved, MADV_HUGEPAGE);
+    }
+#endif
+    return result;
+}
+
+template <bool huge_pages, int inst>
+bool _mmap_alloc_template<huge_pages, inst>::_S_commit(char* p, size_t from, size_t to) {
+    return from >= to || mprotect(p + from, to - from, PROT_READ | PROT_WRITE) == 0;
+}
+
+template <bool huge_pages, int inst>
+void* _mmap_alloc_template<huge_pages, inst>::_S_map(size_t n) {
+    size_t committed = _S_round_up(n, _S_granule());
+    size_t reserved = 2 * committed;
+    char* result = _S_reserve(reserved);
+    if (result == nullptr) {
+        return nullptr;
+    }
+    char* head = result - _S_page_size();
+    if (mprotect(head, _S_page_size() + committed, PROT_READ | PROT_WRITE) != 0) {
+        munmap(head, _S_page_size() + reserved);
+        return nullptr;
+    }
+    ((_Header*)head)->_M_reserved = reserved;
+    ((_Header*)head)->_M_committed = committed;
+    return result;
+}
+
+/* Grows or shrinks a mapped block.  Both sizes are at least            */
+/* _MMAP_THRESHOLD.  Returns nullptr if the system is out of memory.   */
+template <bool huge_pages, int inst>
+void* _mmap_alloc_template<huge_pages, inst>::_S_remap(void* p, size_t old_sz, size_t new_sz) {
+    _Header* header = _S_header(p);
+    size_t committed = _S_round_up(new_sz, _S_granule());
+
+    if (committed <= header->_M_reserved) {
+        if (committed > header->_M_committed) {
+            if (!_S_commit((char*)p, header->_M_committed, committed)) {
+                return nullptr;
+            }
+        } else if (committed < header->_M_committed) {
+            // Give the pages back, but keep the reservation for regrowth.
+            char* tail = (char*)p + committed;
+            size_t tail_bytes = header->_M_committed - committed;
+            madvise(tail, tail_bytes, MADV_DONTNEED);
+            mprotect(tail, tail_bytes, PROT_NONE);
+        }
+        header->_M_committed = committed;
+        return p;
+    }
+
+    void* result;
+#if defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+    // Move the header page and the committed bytes, which form a single
+    // mapping, onto the front of a bigger reservation.  The kernel moves
+    // the page tables; nothing is copied.  The new tail is committed
+    // first, so that a failure leaves the block where it is.
+    size_t page = _S_page_size();
+    size_t reserved = 2 * committed;
+    size_t old_committed = header->_M_committed;
+    size_t old_reserved = header->_M_reserved;
+    char* moved = _S_reserve(reserved);
+    if (moved == nullptr) {
+        return nullptr;
+    }
+    if (_S_commit(moved, old_committed, committed) &&
+        mremap(header, page + old_committed, page + old_committed,
+               MREMAP_MAYMOVE | MREMAP_FIXED, moved - page) != MAP_FAILED) {
+        // Only the PROT_NONE tail of the old reservation is left.
+        if (old_reserved > old_committed) {
+            munmap((char*)p + old_committed, old_reserved - old_committed);
+        }
+        header = _S_header(moved);
+        header->_M_reserved = reserved;
+        header->_M_committed = committed;
+        return moved;
+    }
+    munmap(moved - page, page + reserved);
+#endif
+    // Fall back to copying.
+    result = _S_map(new_sz);
+    if (result != nullptr) {
+        memcpy(result, p, old_sz);
+        deallocate(p, old_sz);
+    }
+    return result;
+}
+
+template <bool huge_pages, int inst>
+void* _mmap_alloc_template<huge_pages, inst>::reallocate(void* p, size_t old_sz, size_t new_sz) {
+    void* result;
+    size_t copy_sz;
+
+    if (old_sz < (size_t)_MMAP_THRESHOLD && new_sz < (size_t)_MMAP_THRESHOLD) {
+        return malloc_alloc::reallocate(p, old_sz, new_sz);
+    }
+    if (old_sz >= (size_t)_MMAP_THRESHOLD && new_sz >= (size_t)_MMAP_THRESHOLD) {
+        result = _S_remap(p, old_sz, new_sz);
+        if (result == nullptr) { SHADOW_THROW_BAD_ALLOC; }
+        return result;
+    }
+    result = allocate(new_sz);
+    copy_sz = new_sz > old_sz ? old_sz : new_sz;
+    memcpy(result, p, copy_sz);
+    deallocate(p, old_sz);
+    return result;
+}
+
+template <bool huge_pages, int inst>
+inline bool operator!=(const _mmap_alloc_template<huge_pages, inst>&,
+                       const _mmap_alloc_template<huge_pages, inst>&) {
+    return false;
+}
+
+template <typename T, bool huge_pages, int inst>
+struct _Alloc_traits<T, _mmap_alloc_template<huge_pages, inst>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T, _mmap_alloc_template<huge_pages, inst>>;
+    using allocator_type = _mmap_alloc_template<huge_pages, inst>;
+};
+
+template <typename T1, typename T2, bool huge_pages, int inst>
+struct _Alloc_traits<T1, _allocator<T2, _mmap_alloc_template<huge_pages, inst>>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T1, _mmap_alloc_template<huge_pages, inst>>;
+    using allocator_type = _allocator<T2, _mmap_alloc_template<huge_pages, inst>>;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_MMAP_ALLOC_H
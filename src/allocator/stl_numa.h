@@ -0,0 +1,83 @@
+#ifndef SHADOW_STL_INTERNAL_NUMA_H
+#define SHADOW_STL_INTERNAL_NUMA_H
+
+// The few NUMA primitives the allocators need, on top of the raw Linux
+// system calls, so that nothing beyond libc (no libnuma) is required.
+// Every one of them degrades to a machine with the single node 0 when
+// the kernel lacks NUMA support or the calls are not permitted.
+
+#include <sched.h>
+#include <stddef.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "include/stl_config.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+struct _Numa {
+    // From <linux/mempolicy.h>.
+    enum { _MPOL_PREFERRED = 1 };
+    enum { _MPOL_F_MEMS_ALLOWED = 1 << 2 };
+    // Bits in the node masks we pass around; generous enough for any
+    // kernel's MAX_NUMNODES.
+    enum { _MASK_BITS = 1024 };
+    enum { _WORD_BITS = 8 * sizeof(unsigned long) };
+
+    // One more than the highest node this process may allocate on.
+    static int _S_node_count() {
+        static const int count = _S_query_node_count();
+        return count;
+    }
+
+    // The node of the CPU the calling thread runs on.  getcpu goes
+    // through the vDSO, so this is cheap enough to ask on every
+    // allocation.  The answer may be stale by the time it is used.
+    static int _S_current_node() {
+        unsigned cpu, node;
+        return getcpu(&cpu, &node) == 0 ? (int)node : 0;
+    }
+
+    // Asks the kernel to place the pages of [p, p + len) on node when they
+    // are first touched.  p must be page aligned.  Falls back to the
+    // default policy silently.
+    static void _S_prefer(void* p, size_t len, int node) {
+        if (node < 0 || node >= (int)_MASK_BITS) return;
+        unsigned long mask[_MASK_BITS / _WORD_BITS] = {};
+        mask[node / _WORD_BITS] = 1UL << (node % _WORD_BITS);
+        // The kernel drops the last bit of maxnode.
+        syscall(SYS_mbind, p, len, (int)_MPOL_PREFERRED, mask, (unsigned long)_MASK_BITS + 1, 0U);
+    }
+
+private:
+    static int _S_query_node_count() {
+        unsigned long mask[_MASK_BITS / _WORD_BITS] = {};
+        if (syscall(SYS_get_mempolicy, nullptr, mask, (unsigned long)_MASK_BITS + 1,
+                    nullptr, (unsigned long)_MPOL_F_MEMS_ALLOWED) != 0) {
+            return 1;
+        }
+        int count = 1;
+        for (int i = 0; i < (int)_MASK_BITS; ++i) {
+            if (mask[i / _WORD_BITS] & (1UL << (i % _WORD_BITS))) count = i + 1;
+        }
+        return count;
+    }
+};
+
+// _Numa_node_of<_SizeClasses>::value is the node that a pool with this
+// size class table binds its chunks to: _SizeClasses::_S_numa_node if
+// the table has one (see _Numa_size_classes), and -1, no binding,
+// otherwise.
+template <typename _SizeClasses, typename = void>
+struct _Numa_node_of {
+    static constexpr int value = -1;
+};
+
+template <typename _SizeClasses>
+struct _Numa_node_of<_SizeClasses, decltype((void)_SizeClasses::_S_numa_node)> {
+    static constexpr int value = _SizeClasses::_S_numa_node;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_NUMA_H
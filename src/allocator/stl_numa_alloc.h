@@ -0,0 +1,184 @@
+#ifndef SHADOW_STL_INTERNAL_NUMA_ALLOC_H
+#define SHADOW_STL_INTERNAL_NUMA_ALLOC_H
+
+// NUMA-aware node allocator.  It keeps one _default_alloc_template pool
+// per NUMA node and serves every request from the pool of the node the
+// calling thread currently runs on.  The chunks of a pool are bound to
+// its node with mbind, so nodes allocated on a socket live in that
+// socket's memory instead of wherever the chunk was first touched.
+//
+// Objects go back to the pool they came from, whichever thread frees
+// them: their chunk header names the owner.  Threads on nodes
+// numbered _MAX_NODES and up share one more pool, whose chunks are not
+// bound to any node, rather than take memory bound to another node
+// from the pool of a lower one.  On a single-node
+// machine, or when the kernel refuses the NUMA system calls, only the
+// pool of node 0 is used and nothing is bound, which makes this
+// equivalent to _default_alloc_template.
+//
+// The per-node pools are distinct instantiations of
+// _default_alloc_template (through _Numa_size_classes), so they do not
+// share free lists or locks with alloc or with each other.
+
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+#include "allocator/stl_alloc.h"
+#include "allocator/stl_numa.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// _SizeClasses, tagged with the NUMA node a pool binds its chunks to.
+template <typename _SizeClasses, int _Node>
+struct _Numa_size_classes : public _SizeClasses {
+    static constexpr int _S_numa_node = _Node;
+};
+
+template <bool threads, int inst, typename _SizeClasses = _Default_size_classes>
+class _numa_alloc_template {
+private:
+    enum { _MAX_NODES = 8 };
+    enum { _ALIGN = _SizeClasses::_S_align };
+    enum { _MAX_BYTES = _SizeClasses::_S_max_bytes };
+
+    template <int _Node>
+    using _Pool = _default_alloc_template<threads, inst, _Numa_size_classes<_SizeClasses, _Node>>;
+
+    // The entry points of one pool.
+    struct _Pool_ops {
+        void* (*_M_allocate)(size_t);
+        void (*_M_deallocate)(void*, size_t);
+        size_t (*_M_trim)(size_t);
+        size_t (*_M_heap_size)();
+    };
+
+    template <int _Node>
+    static constexpr _Pool_ops _S_ops_of() {
+        return _Pool_ops{static_cast<void* (*)(size_t)>(&_Pool<_Node>::allocate),
+                         static_cast<void (*)(void*, size_t)>(&_Pool<_Node>::deallocate),
+                         &_Pool<_Node>::trim, &_Pool<_Node>::heap_size};
+    }
+    // The pools of nodes 0 to _MAX_NODES - 1, then the unbound pool
+    // (node -1) at _MAX_NODES.
+    template <int... _Nodes>
+    static const _Pool_ops* _S_make_pools(std::integer_sequence<int, _Nodes...>) {
+        static constexpr _Pool_ops pools[] = {_S_ops_of<_Nodes>()..., _S_ops_of<-1>()};
+        return pools;
+    }
+    static const _Pool_ops* _S_pools() {
+        return _S_make_pools(std::make_integer_sequence<int, _MAX_NODES>());
+    }
+    static const _Pool_ops& _S_pool_of(int node) {
+        return _S_pools()[node >= 0 && node < _MAX_NODES ? node : (int)_MAX_NODES];
+    }
+
+    // The pool of the calling thread's node.
+    static const _Pool_ops& _S_local_pool() {
+        return _S_pool_of(_Numa::_S_node_count() > 1 ? _Numa::_S_current_node() : 0);
+    }
+    // The pool a small object came from.  Every pool uses the same chunk
+    // size, so any of them can locate the chunk.
+    static const _Pool_ops& _S_owner_pool(void* p) {
+        return _S_pool_of(_Pool<0>::_S_chunk_of(p)->_M_node);
+    }
+
+public:
+    static void* allocate(size_t n) {
+        if (n > (size_t)_MAX_BYTES) return malloc_alloc::allocate(n);
+        return _S_local_pool()._M_allocate(n);
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (n > (size_t)_MAX_BYTES) {
+            malloc_alloc::deallocate(p, n);
+        } else {
+            _S_owner_pool(p)._M_deallocate(p, n);
+        }
+    }
+
+    // align must be a power of two.  As in _default_alloc_template,
+    // alignments beyond _ALIGN are left to malloc_alloc.
+    static void* allocate(size_t n, size_t align) {
+        if (align <= (size_t)_ALIGN) return allocate(n);
+        return malloc_alloc::allocate(n, align);
+    }
+    static void deallocate(void* p, size_t n, size_t align) {
+        if (align <= (size_t)_ALIGN) {
+            deallocate(p, n);
+        } else {
+            malloc_alloc::deallocate(p, n, align);
+        }
+    }
+
+    static void* reallocate(void* p, size_t old_sz, size_t new_sz) {
+        if (old_sz > (size_t)_MAX_BYTES && new_sz > (size_t)_MAX_BYTES) {
+            return malloc_alloc::reallocate(p, old_sz, new_sz);
+        }
+        if (old_sz <= (size_t)_MAX_BYTES && new_sz <= (size_t)_MAX_BYTES &&
+            _SizeClasses::_S_round_up(old_sz) == _SizeClasses::_S_round_up(new_sz)) {
+            return p;
+        }
+        void* result = allocate(new_sz);
+        memcpy(result, p, new_sz > old_sz ? old_sz : new_sz);
+        deallocate(p, old_sz);
+        return result;
+    }
+
+    // Number of nodes the process may allocate on, 1 on machines without
+    // NUMA.
+    static int node_count() {
+        return _Numa::_S_node_count();
+    }
+
+    // trim(), see _default_alloc_template, applied to every pool.
+    // retain_bytes is per pool.
+    static size_t trim(size_t retain_bytes = 0) {
+        size_t result = 0;
+        for (int i = 0; i <= _MAX_NODES; ++i) {
+            result += _S_pools()[i]._M_trim(retain_bytes);
+        }
+        return result;
+    }
+
+    // Bytes held by all pools together.
+    static size_t heap_size() {
+        size_t result = 0;
+        for (int i = 0; i <= _MAX_NODES; ++i) {
+            result += _S_pools()[i]._M_heap_size();
+        }
+        return result;
+    }
+
+    // Bytes held by the pool of the given node; for nodes _MAX_NODES and
+    // up, by the unbound pool they share.
+    static size_t heap_size(int node) {
+        return _S_pool_of(node)._M_heap_size();
+    }
+};
+
+using numa_alloc = _numa_alloc_template<SHADOW_NODE_ALLOCATOR_THREADS, 0>;
+
+template <bool threads, int inst, typename _SizeClasses>
+inline bool operator!=(const _numa_alloc_template<threads, inst, _SizeClasses>&,
+                       const _numa_alloc_template<threads, inst, _SizeClasses>&) {
+    return false;
+}
+
+template <typename T, bool threads, int inst, typename _SizeClasses>
+struct _Alloc_traits<T, _numa_alloc_template<threads, inst, _SizeClasses>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T, _numa_alloc_template<threads, inst, _SizeClasses>>;
+    using allocator_type = _numa_alloc_template<threads, inst, _SizeClasses>;
+};
+
+template <typename T1, typename T2, bool threads, int inst, typename _SizeClasses>
+struct _Alloc_traits<T1, _allocator<T2, _numa_alloc_template<threads, inst, _SizeClasses>>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T1, _numa_alloc_template<threads, inst, _SizeClasses>>;
+    using allocator_type = _allocator<T2, _numa_alloc_template<threads, inst, _SizeClasses>>;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_NUMA_ALLOC_H
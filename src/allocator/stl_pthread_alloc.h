@@ -0,0 +1,238 @@
+#ifndef SHADOW_STL_INTERNAL_PTHREAD_ALLOC_H
+#define SHADOW_STL_INTERNAL_PTHREAD_ALLOC_H
+
+// Per-thread node allocator.  Every thread owns a private copy of the
+// free lists of the shared _default_alloc_template, and only takes the
+// node allocator lock to move a whole batch of objects between its own
+// lists and the shared ones.  allocate and deallocate themselves never
+// lock.
+//
+// Objects may be allocated in one thread and deallocated in another;
+// they simply end up in the cache of the deallocating thread.  Because
+// the caches sit on top of the shared pool, an object obtained from
+// _Pthread_alloc_template<inst, _SizeClasses> may also be released
+// through _default_alloc_template<true, inst, _SizeClasses>, and vice
+// versa.
+//
+// A thread's cache is returned to the shared pool when the thread exits,
+// or earlier by calling flush().  Cached objects count as live for
+// _default_alloc_template::trim(), so flush before trimming.
+
+#include <pthread.h>
+
+#include "allocator/stl_alloc.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+template <int inst, typename _SizeClasses = _Default_size_classes>
+class _Pthread_alloc_template {
+private:
+    using _Pool = _default_alloc_template<true, inst, _SizeClasses>;
+    using _Obj = typename _Pool::_Obj;
+
+    enum { _MAX_BYTES = _Pool::_MAX_BYTES };
+    enum { _NFREELISTS = _Pool::_NFREELISTS };
+    // Bounds on the number of objects moved per lock acquisition.
+    enum { _MIN_BATCH = 4 };
+    enum { _MAX_BATCH = 64 };
+    // Preferred number of bytes moved per lock acquisition.
+    enum { _BATCH_BYTES = 2048 };
+
+    // Number of objects moved between a thread cache and the shared pool
+    // at a time.  Small objects travel in larger batches, so that every
+    // lock acquisition covers roughly the same amount of memory.
+    static int _S_batch_size(size_t n) {
+        size_t nobjs = (size_t)_BATCH_BYTES / n;
+        if (nobjs > (size_t)_MAX_BATCH) return _MAX_BATCH;
+        if (nobjs < (size_t)_MIN_BATCH) return _MIN_BATCH;
+        return (int)nobjs;
+    }
+
+    // The cache of one thread.  It must stay trivially constructible and
+    // destructible, so that accessing it never goes through a TLS guard;
+    // thread exit is handled through a pthread key instead.
+    struct _Per_thread_state {
+        _Obj* _M_free_list[_NFREELISTS];
+        int _M_count[_NFREELISTS];
+        // A list is drained once it holds more than this many objects.
+        int _M_high_water[_NFREELISTS];
+        bool _M_registered;
+    };
+    static thread_local _Per_thread_state _S_state;
+
+    static pthread_key_t _S_key;
+    static pthread_once_t _S_key_once;
+
+    static void _S_make_key() {
+        pthread_key_create(&_S_key, _S_destructor);
+    }
+    // Called on thread exit with the address of the thread's state.
+    static void _S_destructor(void* p) {
+        _Per_thread_state* state = (_Per_thread_state*)p;
+        _S_flush(*state);
+        state->_M_registered = false;
+    }
+
+    static void _S_register(_Per_thread_state& state);
+    static void* _S_refill(size_t n);
+    static void _S_drain(_Per_thread_state& state, size_t index);
+    static void _S_flush(_Per_thread_state& state);
+
+public:
+    static void* allocate(size_t n) {
+        if (n > (size_t)_MAX_BYTES) {
+            return malloc_alloc::allocate(n);
+        }
+        _Per_thread_state& state = _S_state;
+        size_t index = _Pool::_S_freelist_index(n);
+        _Obj* result = state._M_free_list[index];
+        if (result == nullptr) {
+            return _S_refill(_Pool::_S_round_up(n));
+        }
+        state._M_free_list[index] = result->_M_free_list_link;
+        --state._M_count[index];
+        return result;
+    }
+
+    static void deallocate(void* p, size_t n) {
+        if (n > (size_t)_MAX_BYTES) {
+            malloc_alloc::deallocate(p, n);
+            return;
+        }
+        _Per_thread_state& state = _S_state;
+        size_t index = _Pool::_S_freelist_index(n);
+        _Obj* q = (_Obj*)p;
+        q->_M_free_list_link = state._M_free_list[index];
+        state._M_free_list[index] = q;
+        if (++state._M_count[index] > state._M_high_water[index]) {
+            _S_drain(state, index);
+        }
+    }
+
+    static void* reallocate(void* p, size_t old_sz, size_t new_sz);
+
+    // Returns every object cached by the calling thread to the shared pool.
+    static void flush() { _S_flush(_S_state); }
+};
+
+using pthread_alloc = _Pthread_alloc_template<0>;
+
+template <int inst, typename _SizeClasses>
+void _Pthread_alloc_template<inst, _SizeClasses>::_S_register(_Per_thread_state& state) {
+    pthread_once(&_S_key_once, _S_make_key);
+    pthread_setspecific(_S_key, &state);
+    for (size_t i = 0; i < (size_t)_NFREELISTS; ++i) {
+        state._M_high_water[i] = 2 * _S_batch_size(_SizeClasses::_S_class_size(i));
+    }
+    state._M_registered = true;
+}
+
+/* Returns an object of size n and caches a batch of further objects of */
+/* size n.  We assume that n is properly aligned.                       */
+template <int inst, typename _SizeClasses>
+void* _Pthread_alloc_template<inst, _SizeClasses>::_S_refill(size_t n) {
+    _Per_thread_state& state = _S_state;
+    if (!state._M_registered) {
+        _S_register(state);
+    }
+    size_t index = _Pool::_S_freelist_index(n);
+    int nobjs = _S_batch_size(n);
+    _Obj* result = _Pool::_S_fetch_batch(n, nobjs);
+    state._M_free_list[index] = result->_M_free_list_link;
+    state._M_count[index] = nobjs - 1;
+    return result;
+}
+
+/* Keeps the most recently freed batch and returns the rest of the list */
+/* to the shared pool.                                                  */
+template <int inst, typename _SizeClasses>
+void _Pthread_alloc_template<inst, _SizeClasses>::_S_drain(_Per_thread_state& state, size_t index) {
+    // A thread that only ever deallocates has not been registered yet,
+    // and its high water marks are still zero.
+    if (!state._M_registered) {
+        _S_register(state);
+        if (state._M_count[index] <= state._M_high_water[index]) {
+            return;
+        }
+    }
+    int keep = state._M_high_water[index] / 2;
+    _Obj* last_kept = state._M_free_list[index];
+    for (int i = 1; i < keep; ++i) {
+        last_kept = last_kept->_M_free_list_link;
+    }
+    _Obj* first = last_kept->_M_free_list_link;
+    _Obj* last = first;
+    while (last->_M_free_list_link != nullptr) {
+        last = last->_M_free_list_link;
+    }
+    last_kept->_M_free_list_link = nullptr;
+    state._M_count[index] = keep;
+    _Pool::_S_release_batch(_SizeClasses::_S_class_size(index), first, last);
+}
+
+template <int inst, typename _SizeClasses>
+void _Pthread_alloc_template<inst, _SizeClasses>::_S_flush(_Per_thread_state& state) {
+    for (size_t i = 0; i < (size_t)_NFREELISTS; ++i) {
+        _Obj* first = state._M_free_list[i];
+        if (first == nullptr) {
+            continue;
+        }
+        _Obj* last = first;
+        while (last->_M_free_list_link != nullptr) {
+            last = last->_M_free_list_link;
+        }
+        state._M_free_list[i] = nullptr;
+        state._M_count[i] = 0;
+        _Pool::_S_release_batch(_SizeClasses::_S_class_size(i), first, last);
+    }
+}
+
+template <int inst, typename _SizeClasses>
+void* _Pthread_alloc_template<inst, _SizeClasses>::reallocate(void* p, size_t old_sz, size_t new_sz) {
+    void* result;
+    size_t copy_sz;
+
+    if (old_sz > (size_t)_MAX_BYTES && new_sz > (size_t)_MAX_BYTES) {
+        return malloc_alloc::reallocate(p, old_sz, new_sz);
+    }
+    if (old_sz <= (size_t)_MAX_BYTES && new_sz <= (size_t)_MAX_BYTES &&
+        _Pool::_S_round_up(old_sz) == _Pool::_S_round_up(new_sz)) {
+        return p;
+    }
+    result = allocate(new_sz);
+    copy_sz = new_sz > old_sz ? old_sz : new_sz;
+    memcpy(result, p, copy_sz);
+    deallocate(p, old_sz);
+    return result;
+}
+
+template <int inst, typename _SizeClasses>
+thread_local typename _Pthread_alloc_template<inst, _SizeClasses>::_Per_thread_state
+_Pthread_alloc_template<inst, _SizeClasses>::_S_state;
+
+template <int inst, typename _SizeClasses>
+pthread_key_t _Pthread_alloc_template<inst, _SizeClasses>::_S_key;
+
+template <int inst, typename _SizeClasses>
+pthread_once_t _Pthread_alloc_template<inst, _SizeClasses>::_S_key_once = PTHREAD_ONCE_INIT;
+
+// _Alloc_traits specializations, so that pthread_alloc can be used
+// directly as the allocator argument of a container, or through the
+// _allocator adaptor.
+template <typename T, int inst, typename _SizeClasses>
+struct _Alloc_traits<T, _Pthread_alloc_template<inst, _SizeClasses>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T, _Pthread_alloc_template<inst, _SizeClasses>>;
+    using allocator_type = _Pthread_alloc_template<inst, _SizeClasses>;
+};
+
+template <typename T1, typename T2, int inst, typename _SizeClasses>
+struct _Alloc_traits<T1, _allocator<T2, _Pthread_alloc_template<inst, _SizeClasses>>> {
+    static const bool _S_instanceless = true;
+    using _Alloc_type = simple_alloc<T1, _Pthread_alloc_template<inst, _SizeClasses>>;
+    using allocator_type = _allocator<T2, _Pthread_alloc_template<inst, _SizeClasses>>;
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_PTHREAD_ALLOC_H
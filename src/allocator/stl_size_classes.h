@@ -0,0 +1,129 @@
+#ifndef SHADOW_STL_INTERNAL_SIZE_CLASSES_H
+#define SHADOW_STL_INTERNAL_SIZE_CLASSES_H
+
+// Size class tables for the node allocators.  A table decides how
+// requests are rounded up and which free list serves them.  Every table
+// provides, all usable in constant expressions:
+//
+//   _S_align           alignment of every object handed out
+//   _S_max_bytes       largest request served from the free lists;
+//                      larger ones go to malloc_alloc
+//   _S_nclasses        number of free lists
+//   _S_class_size(i)   object size kept on free list i
+//   _S_index(n)        free list serving requests of n bytes,
+//                      for 0 < n <= _S_max_bytes
+//   _S_round_up(n)     _S_class_size(_S_index(n))
+//   _S_index_floor(n)  largest class no bigger than n, for n >= _S_align
+
+#include <stddef.h>
+
+#include "include/stl_config.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// Classes _Align bytes apart: _Align, 2 * _Align, ..., _MaxBytes.  This is
+// the classic SGI layout; _Linear_size_classes<8, 128> gives the 16 free
+// lists of the original allocator.
+template <size_t _Align, size_t _MaxBytes>
+struct _Linear_size_classes {
+    static_assert(_Align >= sizeof(void*) && (_Align & (_Align - 1)) == 0,
+                  "alignment must be a power of two that can hold a pointer");
+    static_assert(_MaxBytes % _Align == 0,
+                  "_MaxBytes must be a multiple of the alignment");
+
+    static constexpr size_t _S_align = _Align;
+    static constexpr size_t _S_max_bytes = _MaxBytes;
+    static constexpr size_t _S_nclasses = _MaxBytes / _Align;
+
+    static constexpr size_t _S_round_up(size_t bytes) {
+        return (bytes + _Align - 1) & ~(_Align - 1);
+    }
+    static constexpr size_t _S_index(size_t bytes) {
+        return (bytes + _Align - 1) / _Align - 1;
+    }
+    static constexpr size_t _S_index_floor(size_t bytes) {
+        return bytes / _Align - 1;
+    }
+    static constexpr size_t _S_class_size(size_t i) {
+        return (i + 1) * _Align;
+    }
+};
+
+// jemalloc-style classes: _Align apart up to _Steps * _Align, then _Steps
+// classes per doubling.  With _Align = 16 and _Steps = 4 this gives
+// 16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, ...  The
+// internal fragmentation stays below 1 / _Steps while the number of free
+// lists only grows logarithmically with _MaxBytes.
+template <size_t _Align, size_t _MaxBytes, size_t _Steps = 4>
+struct _Geometric_size_classes {
+    static_assert(_Align >= sizeof(void*) && (_Align & (_Align - 1)) == 0,
+                  "alignment must be a power of two that can hold a pointer");
+    static_assert(_Steps != 0 && (_Steps & (_Steps - 1)) == 0,
+                  "_Steps must be a power of two");
+    static_assert((_MaxBytes & (_MaxBytes - 1)) == 0 && _MaxBytes >= _Steps * _Align,
+                  "_MaxBytes must be a power of two of at least _Steps * _Align");
+
+private:
+    static constexpr size_t _S_floor_pow2(size_t n) {
+        size_t result = 1;
+        while (result <= n / 2) result *= 2;
+        return result;
+    }
+    // The class following a class of the given size.
+    static constexpr size_t _S_next(size_t size) {
+        size_t spacing = size == 0 ? _Align : _S_floor_pow2(size) / _Steps;
+        return size + (spacing < _Align ? _Align : spacing);
+    }
+    static constexpr size_t _S_count() {
+        size_t n = 0;
+        for (size_t size = 0; size < _MaxBytes; size = _S_next(size)) ++n;
+        return n;
+    }
+
+public:
+    static constexpr size_t _S_align = _Align;
+    static constexpr size_t _S_max_bytes = _MaxBytes;
+    static constexpr size_t _S_nclasses = _S_count();
+
+private:
+    // Class sizes, plus a map from every _Align granule to its class, so
+    // that _S_index is a single table lookup.
+    struct _Table {
+        size_t _M_size[_S_nclasses];
+        unsigned short _M_index[_MaxBytes / _Align];
+
+        constexpr _Table() : _M_size(), _M_index() {
+            size_t size = 0;
+            size_t granule = 0;
+            for (size_t i = 0; i < _S_nclasses; ++i) {
+                size = _S_next(size);
+                _M_size[i] = size;
+                for (; granule < size / _Align; ++granule) {
+                    _M_index[granule] = (unsigned short)i;
+                }
+            }
+        }
+    };
+    static constexpr _Table _S_table = _Table();
+
+public:
+    static constexpr size_t _S_index(size_t bytes) {
+        return _S_table._M_index[(bytes + _Align - 1) / _Align - 1];
+    }
+    static constexpr size_t _S_class_size(size_t i) {
+        return _S_table._M_size[i];
+    }
+    static constexpr size_t _S_round_up(size_t bytes) {
+        return _S_class_size(_S_index(bytes));
+    }
+    static constexpr size_t _S_index_floor(size_t bytes) {
+        size_t i = _S_index(bytes > _MaxBytes ? _MaxBytes : bytes);
+        return _S_class_size(i) > bytes ? i - 1 : i;
+    }
+};
+
+using _Default_size_classes = _Linear_size_classes<8, 128>;
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_SIZE_CLASSES_H
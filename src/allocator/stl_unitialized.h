@@ -6,6 +6,7 @@
 #include "allocator/stl_construct.h"
 #include "container/stl_pair.h"
 #include <cstring>
+#include <utility>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -21,10 +22,16 @@ template <typename InputIter, typename ForwardIter>
 ForwardIter
 _uninitialized_copy_aux(InputIter first, InputIter last, ForwardIter result, _false_type) {
     ForwardIter cur = result;
-    for (; first != last; ++first, ++cur) {
-        _Construct(&*cur, *first);
+    try {
+        for (; first != last; ++first, ++cur) {
+            _Construct(&*cur, *first);
+        }
+        return cur;
+    }
+    catch (...) {
+        _Destroy(result, cur);
+        throw;
     }
-    return cur;
 }
 
 template <typename InputIter, typename ForwardIter, typename T>
@@ -81,6 +88,93 @@ uninitialized_copy_n(InputIter first, Size count, ForwardIter result) {
     return _uninitialized_copy_n(first, count, result);
 }
 
+// uninitialized_move (C++17).  Like uninitialized_copy, with move
+// construction.
+template <typename InputIter, typename ForwardIter>
+inline ForwardIter
+_uninitialized_move_aux(InputIter first, InputIter last, ForwardIter result, _true_type) {
+    return copy(first, last, result);
+}
+
+template <typename InputIter, typename ForwardIter>
+ForwardIter
+_uninitialized_move_aux(InputIter first, InputIter last, ForwardIter result, _false_type) {
+    ForwardIter cur = result;
+    try {
+        for (; first != last; ++first, ++cur) {
+            _Construct(&*cur, std::move(*first));
+        }
+        return cur;
+    }
+    catch (...) {
+        _Destroy(result, cur);
+        throw;
+    }
+}
+
+template <typename InputIter, typename ForwardIter, typename T>
+inline ForwardIter
+_uninitialized_move(InputIter first, InputIter last, ForwardIter result, T*) {
+    using _Is_POD = typename _type_traits<T>::is_POD_type;
+    return _uninitialized_move_aux(first, last, result, _Is_POD());
+}
+
+template <typename InputIter, typename ForwardIter>
+inline ForwardIter
+uninitialized_move(InputIter first, InputIter last, ForwardIter result) {
+    return _uninitialized_move(first, last, result, _value_type(result));
+}
+
+// Relocation into fresh storage, for containers that grow.  Moves the
+// elements if that cannot throw, or if they cannot be copied, and
+// copies them otherwise, so that a throwing copy leaves the source
+// intact.  This is what gives push_back and reserve the strong
+// exception guarantee.
+template <typename InputIter, typename ForwardIter>
+ForwardIter
+_uninitialized_move_if_noexcept_aux(InputIter first, InputIter last, ForwardIter result, _false_type) {
+    ForwardIter cur = result;
+    try {
+        for (; first != last; ++first, ++cur) {
+            _Construct(&*cur, std::move_if_noexcept(*first));
+        }
+        return cur;
+    }
+    catch (...) {
+        _Destroy(result, cur);
+        throw;
+    }
+}
+
+template <typename InputIter, typename ForwardIter>
+inline ForwardIter
+_uninitialized_move_if_noexcept_aux(InputIter first, InputIter last, ForwardIter result, _true_type) {
+    return copy(first, last, result);
+}
+
+template <typename InputIter, typename ForwardIter, typename T>
+inline ForwardIter
+_uninitialized_move_if_noexcept(InputIter first, InputIter last, ForwardIter result, T*) {
+    using _Is_POD = typename _type_traits<T>::is_POD_type;
+    return _uninitialized_move_if_noexcept_aux(first, last, result, _Is_POD());
+}
+
+template <typename InputIter, typename ForwardIter>
+inline ForwardIter
+_uninitialized_move_if_noexcept(InputIter first, InputIter last, ForwardIter result) {
+    return _uninitialized_move_if_noexcept(first, last, result, _value_type(result));
+}
+
+// Whether filling raw memory with x of type T can assign instead of
+// construct: for PODs, and for other types with trivial copies and
+// destructor when x is one of them.  fill then stores x's bytes with
+// vector instructions.
+template <typename T1, typename T>
+using _Fill_is_assignment = std::conditional_t<
+    std::is_same<T1, T>::value && std::is_trivially_copy_constructible<T1>::value &&
+        std::is_trivially_copy_assignable<T1>::value && std::is_trivially_destructible<T1>::value,
+    _true_type, typename _type_traits<T1>::is_POD_type>;
+
 // Valid if copy construction is equivalent to assignment, and if the
 // destructor is trivial.
 template <typename ForwardIter, typename T>
@@ -102,7 +196,7 @@ _uninitialized_fill_aux(ForwardIter first, ForwardIter last, const T& x, _false_
 template <typename ForwardIter, typename T, typename T1>
 inline void
 _uninitialized_fill(ForwardIter first, ForwardIter last, const T& x, T1*) {
-    using _Is_POD = typename _type_traits<T1>::is_POD_type;
+    using _Is_POD = _Fill_is_assignment<T1, T>;
     _uninitialized_fill_aux(first, last, x, _Is_POD());
 }
 
@@ -124,16 +218,22 @@ template <typename ForwardIter, typename Size, typename T>
 ForwardIter
 _uninitialized_fill_n_aux(ForwardIter first, Size n, const T& x, _false_type) {
     ForwardIter cur = first;
-    for (; n > 0; --n, ++cur) {
-        _Construct(&*cur, x);
+    try {
+        for (; n > 0; --n, ++cur) {
+            _Construct(&*cur, x);
+        }
+        return cur;
+    }
+    catch (...) {
+        _Destroy(first, cur);
+        throw;
     }
-    return cur;
 }
 
 template <typename ForwardIter, typename Size, typename T, typename T1>
 inline ForwardIter
 _uninitialized_fill_n(ForwardIter first, Size n, const T& x, T1*) {
-    using _Is_POD = typename _type_traits<T1>::is_POD_type;
+    using _Is_POD = _Fill_is_assignment<T1, T>;
     return _uninitialized_fill_n_aux(first, n, x, _Is_POD());
 }
 
@@ -143,6 +243,47 @@ uninitialized_fill_n(ForwardIter first, Size n, const T& x) {
     return _uninitialized_fill_n(first, n, x, _value_type(first));
 }
 
+// Extension: uninitialized_default_n default-initializes n objects at
+//  first, like new T does.  Trivially default constructible objects are
+//  left as the memory was, so nothing is written at all.
+template <typename ForwardIter, typename Size>
+inline ForwardIter
+_uninitialized_default_n_aux(ForwardIter first, Size n, _true_type) {
+    advance(first, n);
+    return first;
+}
+
+template <typename ForwardIter, typename Size>
+ForwardIter
+_uninitialized_default_n_aux(ForwardIter first, Size n, _false_type) {
+    using T = typename iterator_traits<ForwardIter>::value_type;
+    ForwardIter cur = first;
+    try {
+        for (; n > 0; --n, ++cur) {
+            new ((void*)&*cur) T;
+        }
+        return cur;
+    }
+    catch (...) {
+        _Destroy(first, cur);
+        throw;
+    }
+}
+
+template <typename ForwardIter, typename Size, typename T>
+inline ForwardIter
+_uninitialized_default_n(ForwardIter first, Size n, T*) {
+    using _Trivial = std::conditional_t<std::is_trivially_default_constructible<T>::value,
+                                        _true_type, _false_type>;
+    return _uninitialized_default_n_aux(first, n, _Trivial());
+}
+
+template <typename ForwardIter, typename Size>
+inline ForwardIter
+uninitialized_default_n(ForwardIter first, Size n) {
+    return _uninitialized_default_n(first, n, _value_type(first));
+}
+
 // Extensions: __uninitialized_copy_copy, __uninitialized_copy_fill, 
 // __uninitialized_fill_copy.
 
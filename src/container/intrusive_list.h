@@ -0,0 +1,6 @@
+#ifndef SHADOW_STL_INTRUSIVE_LIST_H
+#define SHADOW_STL_INTRUSIVE_LIST_H
+
+#include "container/list/stl_intrusive_list.h"
+
+#endif // SHADOW_STL_INTRUSIVE_LIST_H
\ No newline at end of file
@@ -0,0 +1,6 @@
+#ifndef SHADOW_STL_INTRUSIVE_SLIST_H
+#define SHADOW_STL_INTRUSIVE_SLIST_H
+
+#include "container/slist/stl_intrusive_slist.h"
+
+#endif // SHADOW_STL_INTRUSIVE_SLIST_H
\ No newline at end of file
@@ -0,0 +1,360 @@
+#ifndef SHADOW_STL_INTERNAL_INTRUSIVE_LIST_H
+#define SHADOW_STL_INTERNAL_INTRUSIVE_LIST_H
+
+#include "container/list/stl_list.h"
+#include <cstddef>
+#include <type_traits>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// An intrusive list links objects through a list_hook member of their
+// own instead of copying them into nodes, so it never allocates:
+// insert links an object in, erase unlinks it, and neither constructs,
+// copies nor destroys anything.  An object can be in as many lists at
+// once as it has hooks; the Hook argument says which hook a list uses.
+//
+// The list does not own its objects.  They must stay where they are
+// while linked, and clearing or destroying the list only unlinks them.
+
+struct list_hook : public List_node_base {
+  list_hook() noexcept { _M_next = _M_prev = nullptr; }
+  // A copy of an object is in no list.
+  list_hook(const list_hook &) noexcept : list_hook() {}
+  list_hook &operator=(const list_hook &) noexcept { return *this; }
+
+  bool is_linked() const noexcept { return _M_next != nullptr; }
+};
+
+// From a hook to the object around it, and back.
+template <typename T, typename HookType, HookType T::*Hook>
+struct _Intrusive_traits {
+  static ptrdiff_t _S_offset() {
+    // No T is built: only the address of the member is taken.
+    alignas(T) static unsigned char object[sizeof(T)];
+    T *p = (T *)object;
+    return (char *)&(p->*Hook) - (char *)p;
+  }
+  template <typename Base> static T *_S_owner(Base *h) {
+    return (T *)((char *)static_cast<HookType *>(h) - _S_offset());
+  }
+  static HookType *_S_hook(T &x) { return &(x.*Hook); }
+};
+
+template <typename T, list_hook T::*Hook, typename Ref, typename Ptr>
+struct Intrusive_list_iterator : public List_iterator_base {
+  using iterator = Intrusive_list_iterator<T, Hook, T &, T *>;
+  using const_iterator = Intrusive_list_iterator<T, Hook, const T &, const T *>;
+  using self = Intrusive_list_iterator<T, Hook, Ref, Ptr>;
+
+  using value_type = T;
+  using pointer = Ptr;
+  using reference = Ref;
+
+  using Traits = _Intrusive_traits<T, list_hook, Hook>;
+
+  Intrusive_list_iterator() {}
+  explicit Intrusive_list_iterator(List_node_base *x) : List_iterator_base(x) {}
+  Intrusive_list_iterator(const Intrusive_list_iterator &) = default;
+  Intrusive_list_iterator &operator=(const Intrusive_list_iterator &) = default;
+  // An iterator converts to a const_iterator, not the other way round.
+  template <typename R, typename = typename std::enable_if<
+                            std::is_same<R, T &>::value &&
+                            !std::is_same<Ref, T &>::value>::type>
+  Intrusive_list_iterator(const Intrusive_list_iterator<T, Hook, R, T *> &x)
+      : List_iterator_base(x._M_node) {}
+
+  reference operator*() const { return *Traits::_S_owner(_M_node); }
+  pointer operator->() const { return &(operator*()); }
+
+  self &operator++() {
+    this->_M_incr();
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    this->_M_incr();
+    return tmp;
+  }
+  self &operator--() {
+    this->_M_decr();
+    return *this;
+  }
+  self operator--(int) {
+    self tmp = *this;
+    this->_M_decr();
+    return tmp;
+  }
+};
+
+template <typename T, list_hook T::*Hook> class intrusive_list {
+public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  using iterator = Intrusive_list_iterator<T, Hook, T &, T *>;
+  using const_iterator = Intrusive_list_iterator<T, Hook, const T &, const T *>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+protected:
+  using Traits = _Intrusive_traits<T, list_hook, Hook>;
+
+  // The sentinel lives in the list object itself.
+  List_node_base _M_node;
+  size_t _M_size = 0;
+
+  void _M_init() { _M_node._M_next = _M_node._M_prev = &_M_node; }
+
+  static void _S_link_before(List_node_base *pos, List_node_base *h) {
+    h->_M_next = pos;
+    h->_M_prev = pos->_M_prev;
+    pos->_M_prev->_M_next = h;
+    pos->_M_prev = h;
+  }
+  static void _S_unlink(List_node_base *h) {
+    h->_M_prev->_M_next = h->_M_next;
+    h->_M_next->_M_prev = h->_M_prev;
+    h->_M_next = h->_M_prev = nullptr;
+  }
+
+  // Moves [first, last) before position, as list::transfer does.
+  static void _S_transfer(List_node_base *position, List_node_base *first,
+                          List_node_base *last) {
+    if (position != last) {
+      last->_M_prev->_M_next = position;
+      first->_M_prev->_M_next = last;
+      position->_M_prev->_M_next = first;
+
+      List_node_base *tmp = position->_M_prev;
+      position->_M_prev = last->_M_prev;
+      last->_M_prev = first->_M_prev;
+      first->_M_prev = tmp;
+    }
+  }
+
+  // Takes over the objects of x, whose sentinel is about to go away or
+  // be reused: their neighbours point at it.
+  void _M_take(intrusive_list &x) {
+    if (x.empty()) {
+      _M_init();
+    } else {
+      _M_node = x._M_node;
+      _M_node._M_next->_M_prev = &_M_node;
+      _M_node._M_prev->_M_next = &_M_node;
+      x._M_init();
+    }
+    _M_size = x._M_size;
+    x._M_size = 0;
+  }
+
+public:
+  intrusive_list() { _M_init(); }
+  intrusive_list(intrusive_list &&x) noexcept { _M_take(x); }
+  intrusive_list &operator=(intrusive_list &&x) noexcept {
+    if (this != &x) {
+      clear();
+      _M_take(x);
+    }
+    return *this;
+  }
+  ~intrusive_list() { clear(); }
+
+  iterator begin() { return iterator(_M_node._M_next); }
+  const_iterator begin() const {
+    return const_iterator(const_cast<List_node_base *>(_M_node._M_next));
+  }
+  iterator end() { return iterator(&_M_node); }
+  const_iterator end() const {
+    return const_iterator(const_cast<List_node_base *>(&_M_node));
+  }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  bool empty() const { return _M_size == 0; }
+  size_type size() const { return _M_size; }
+  size_type max_size() const { return size_type(-1); }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *(--end()); }
+  const_reference back() const { return *(--end()); }
+
+  // The position of x, which is in this list.
+  iterator iterator_to(T &x) { return iterator(Traits::_S_hook(x)); }
+  const_iterator iterator_to(const T &x) const {
+    return const_iterator(Traits::_S_hook(const_cast<T &>(x)));
+  }
+
+  void swap(intrusive_list &x) {
+    intrusive_list tmp(std::move(x));
+    x._M_take(*this);
+    _M_take(tmp);
+  }
+
+  // x must not be in a list through Hook already.
+  iterator insert(iterator position, T &x) {
+    List_node_base *h = Traits::_S_hook(x);
+    _S_link_before(position._M_node, h);
+    ++_M_size;
+    return iterator(h);
+  }
+  template <typename InputIterator>
+  void insert(iterator position, InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(position, *first);
+    }
+  }
+  void push_front(T &x) { insert(begin(), x); }
+  void push_back(T &x) { insert(end(), x); }
+
+  iterator erase(iterator position) {
+    List_node_base *next = position._M_node->_M_next;
+    _S_unlink(position._M_node);
+    --_M_size;
+    return iterator(next);
+  }
+  iterator erase(iterator first, iterator last) {
+    while (first != last) {
+      first = erase(first);
+    }
+    return last;
+  }
+  void pop_front() { erase(begin()); }
+  void pop_back() { erase(--end()); }
+  void clear() { erase(begin(), end()); }
+
+  void splice(iterator position, intrusive_list &x) {
+    if (!x.empty()) {
+      _S_transfer(position._M_node, x._M_node._M_next, &x._M_node);
+      _M_size += x._M_size;
+      x._M_size = 0;
+    }
+  }
+  void splice(iterator position, intrusive_list &x, iterator i) {
+    iterator j = i;
+    ++j;
+    if (position == i || position == j) {
+      return;
+    }
+    _S_transfer(position._M_node, i._M_node, j._M_node);
+    ++_M_size;
+    --x._M_size;
+  }
+  // O(1) within a list; from another list, counting the objects moved
+  // takes a walk over them.
+  void splice(iterator position, intrusive_list &x, iterator first,
+              iterator last) {
+    if (first != last) {
+      if (&x != this) {
+        size_type n = distance(first, last);
+        _M_size += n;
+        x._M_size -= n;
+      }
+      _S_transfer(position._M_node, first._M_node, last._M_node);
+    }
+  }
+
+  template <typename Predicate> void remove_if(Predicate pred) {
+    iterator first = begin();
+    while (first != end()) {
+      if (pred(*first)) {
+        first = erase(first);
+      } else {
+        ++first;
+      }
+    }
+  }
+
+  void reverse() { _List_base_reverse(&_M_node); }
+
+  template <typename StrictWeakOrdering>
+  void merge(intrusive_list &x, StrictWeakOrdering comp);
+  void merge(intrusive_list &x) {
+    merge(x, [](const T &a, const T &b) { return a < b; });
+  }
+
+  // Stable.  The merge sort of list, on intrusive lists for carry and
+  // counters: they need no allocation either.
+  template <typename StrictWeakOrdering> void sort(StrictWeakOrdering comp);
+  void sort() {
+    sort([](const T &a, const T &b) { return a < b; });
+  }
+
+private:
+  // Non-copyable: an object is in one list per hook.
+  intrusive_list(const intrusive_list &);
+  void operator=(const intrusive_list &);
+};
+
+template <typename T, list_hook T::*Hook>
+inline void swap(intrusive_list<T, Hook> &x, intrusive_list<T, Hook> &y) {
+  x.swap(y);
+}
+
+template <typename T, list_hook T::*Hook>
+template <typename StrictWeakOrdering>
+void intrusive_list<T, Hook>::merge(intrusive_list &x,
+                                    StrictWeakOrdering comp) {
+  if (&x == this) {
+    return;
+  }
+  iterator first1 = begin();
+  iterator last1 = end();
+  iterator first2 = x.begin();
+  iterator last2 = x.end();
+  while (first1 != last1 && first2 != last2) {
+    if (comp(*first2, *first1)) {
+      iterator next = first2;
+      _S_transfer(first1._M_node, first2._M_node, (++next)._M_node);
+      first2 = next;
+    } else {
+      ++first1;
+    }
+  }
+  if (first2 != last2) {
+    _S_transfer(last1._M_node, first2._M_node, last2._M_node);
+  }
+  _M_size += x._M_size;
+  x._M_size = 0;
+}
+
+template <typename T, list_hook T::*Hook>
+template <typename StrictWeakOrdering>
+void intrusive_list<T, Hook>::sort(StrictWeakOrdering comp) {
+  // Do nothing if the list has length 0 or 1.
+  if (_M_size < 2) {
+    return;
+  }
+  intrusive_list carry;
+  intrusive_list counter[64];
+  int fill = 0;
+  while (!empty()) {
+    carry.splice(carry.begin(), *this, begin());
+    int i = 0;
+    while (i < fill && !counter[i].empty()) {
+      counter[i].merge(carry, comp);
+      carry.swap(counter[i++]);
+    }
+    carry.swap(counter[i]);
+    if (i == fill) {
+      ++fill;
+    }
+  }
+
+  for (int i = 1; i < fill; ++i) {
+    counter[i].merge(counter[i - 1], comp);
+  }
+  swap(counter[fill - 1]);
+}
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_INTRUSIVE_LIST_H
@@ -1,12 +1,15 @@
 #ifndef SHADOW_STL_INTERNAL_LIST_H
 #define SHADOW_STL_INTERNAL_LIST_H
 
+#include "algorithm/stl_merge_sort.h"
+#include "algorithm/stl_parallel_sort.h"
 #include "allocator/stl_alloc.h"
 #include "allocator/stl_construct.h"
 #include "include/type_traits.h"
 #include "iterator/stl_iterator.h"
 #include "iterator/stl_iterator_base.h"
 #include <cstddef>
+#include <cstdlib>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -104,15 +107,28 @@ template <typename T, typename Allocator, bool IsStatic> class List_alloc_base {
 public:
   using allocator_type = typename _Alloc_traits<T, Allocator>::allocator_type;
 
-  allocator_type get_allocator() const { return _Node_allocator; }
+  allocator_type get_allocator() const { return allocator_type(_Node_allocator); }
 
   List_alloc_base(const allocator_type &a) : _Node_allocator(a) {}
 
 protected:
   List_node<T> *_M_get_node() { return _Node_allocator.allocate(1); }
   void _M_put_node(List_node<T> *p) { _Node_allocator.deallocate(p, 1); }
+  void _M_get_nodes(List_node<T> **out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      try {
+        out[i] = _Node_allocator.allocate(1);
+      } catch (...) {
+        _M_put_nodes(out, i);
+        throw;
+      }
+    }
+  }
+  void _M_put_nodes(List_node<T> **p, size_t n) {
+    for (size_t i = 0; i < n; ++i) _Node_allocator.deallocate(p[i], 1);
+  }
 
-  allocator_type _Node_allocator;
+  typename _Alloc_traits<List_node<T>, Allocator>::allocator_type _Node_allocator;
   List_node<T> *_M_node;
 };
 
@@ -132,10 +148,20 @@ protected:
 
   List_node<T> *_M_get_node() { return _Node_Alloc_type::allocate(1); }
   void _M_put_node(List_node<T> *p) { _Node_Alloc_type::deallocate(p, 1); }
+  // One trip to the allocator for n nodes.
+  void _M_get_nodes(List_node<T> **out, size_t n) {
+    _Node_Alloc_type::allocate_batch(out, n);
+  }
+  void _M_put_nodes(List_node<T> **p, size_t n) {
+    _Node_Alloc_type::deallocate_batch(p, n);
+  }
 
   List_node<T> *_M_node;
 };
 
+// The list header: the sentinel node of the ring, and the number of
+// elements, which every operation adding or removing nodes keeps up to
+// date so that size() is O(1).
 template <typename T, typename Alloc>
 class List_base
     : public List_alloc_base<T, Alloc,
@@ -154,15 +180,34 @@ public:
     _M_put_node(_M_node);
   }
 
-  void clear();
+  void clear() {
+    _M_clear(typename _Is_monotonic_alloc<Alloc>::_Monotonic(),
+             typename _type_traits<T>::has_trivial_destructor());
+  }
 
 protected:
   using Base::_M_get_node;
+  using Base::_M_get_nodes;
   using Base::_M_node;
   using Base::_M_put_node;
+  using Base::_M_put_nodes;
+
+  size_t _M_size = 0;
+
+  // A monotonic allocator ignores deallocate, so when there is nothing
+  // to destroy either, the nodes are simply dropped.
+  void _M_clear(_true_type, _true_type) {
+    _M_node->_M_next = _M_node;
+    _M_node->_M_prev = _M_node;
+    _M_size = 0;
+  }
+  template <typename _Monotonic, typename _Trivial>
+  void _M_clear(_Monotonic, _Trivial);
 };
 
-template <typename T, typename Alloc> void List_base<T, Alloc>::clear() {
+template <typename T, typename Alloc>
+template <typename _Monotonic, typename _Trivial>
+void List_base<T, Alloc>::_M_clear(_Monotonic, _Trivial) {
   List_node<T> *cur = static_cast<List_node<T> *>(_M_node->_M_next);
   while (cur != _M_node) {
     List_node<T> *tmp = cur;
@@ -172,6 +217,7 @@ template <typename T, typename Alloc> void List_base<T, Alloc>::clear() {
   }
   _M_node->_M_next = _M_node;
   _M_node->_M_prev = _M_node;
+  _M_size = 0;
 }
 
 template <typename T, typename Alloc = allocator<T>>
@@ -201,8 +247,20 @@ public:
 
 protected:
   using Base::_M_get_node;
+  using Base::_M_get_nodes;
   using Base::_M_node;
   using Base::_M_put_node;
+  using Base::_M_put_nodes;
+  using Base::_M_size;
+
+  // Bulk insertions fetch their nodes from the allocator this many at
+  // a time.
+  enum { _S_batch = 64 };
+
+  // Inserts n nodes before pos, constructing the value of each with
+  // init(&value).
+  template <typename _Init>
+  void _M_insert_nodes(iterator pos, size_type n, _Init init);
 
   Node *_M_create_node(const T &x) {
     Node *p = _M_get_node();
@@ -247,10 +305,7 @@ public:
 
   bool empty() const { return _M_node->_M_next == _M_node; }
 
-  size_type size() const {
-    size_type result = distance(begin(), end());
-    return result;
-  }
+  size_type size() const { return _M_size; }
 
   size_type max_size() const { return size_type(-1); }
 
@@ -260,7 +315,10 @@ public:
   reference back() { return *(--end()); }
   const_reference back() const { return *(--end()); }
 
-  void swap(list<T, Alloc> &x) { swap(_M_node, x._M_node); }
+  void swap(list<T, Alloc> &x) {
+    std::swap(_M_node, x._M_node);
+    std::swap(_M_size, x._M_size);
+  }
 
   iterator insert(iterator position, const T &x) {
     Node *tmp = _M_create_node(x);
@@ -268,6 +326,7 @@ public:
     tmp->_M_prev = position._M_node->_M_prev;
     position._M_node->_M_prev->_M_next = tmp;
     position._M_node->_M_prev = tmp;
+    ++_M_size;
     return tmp;
   }
 
@@ -275,13 +334,30 @@ public:
 
   // Check whether it's an integral type.  If so, it's not an iterator.
   template <typename Integer>
-  void _M_insert_dispatch(iterator pos, iterator n, Integer x, _true_type) {
+  void _M_insert_dispatch(iterator pos, Integer n, Integer x, _true_type) {
     _M_fill_insert(pos, static_cast<size_type>(n), static_cast<T>(x));
   }
 
   template <typename InputIterator>
   void _M_insert_dispatch(iterator pos, InputIterator first, InputIterator last,
-                          _false_type);
+                          _false_type) {
+    _M_insert_range(pos, first, last, iterator_category(first));
+  }
+
+  template <typename InputIterator>
+  void _M_insert_range(iterator pos, InputIterator first, InputIterator last,
+                       input_iterator_tag);
+  // The length of a forward range is known up front, so its nodes can
+  // be fetched in batches.
+  template <typename ForwardIterator>
+  void _M_insert_range(iterator pos, ForwardIterator first,
+                       ForwardIterator last, forward_iterator_tag) {
+    size_type n = distance(first, last);
+    _M_insert_nodes(pos, n, [&first](T *p) {
+      construct(p, *first);
+      ++first;
+    });
+  }
 
   template <typename InputIterator>
   void insert(iterator pos, InputIterator first, InputIterator last) {
@@ -309,6 +385,7 @@ public:
     Node *n = static_cast<Node *>(position._M_node);
     destroy(&n->_M_data);
     _M_put_node(n);
+    --_M_size;
     return iterator(next_node);
   }
   iterator erase(iterator first, iterator last);
@@ -361,40 +438,60 @@ public:
     _M_assign_dispatch(first, last, is_integer());
   }
 
+  template <typename Integer>
+  void _M_assign_dispatch(Integer n, Integer val, _true_type) {
+    _M_fill_assign(static_cast<size_type>(n), static_cast<T>(val));
+  }
   template <typename InputIterator>
   void _M_assign_dispatch(InputIterator first, InputIterator last, _false_type);
 
 protected:
+  // Moves [first, last) before position.  The callers adjust the sizes
+  // when the nodes come from another list.
   void transfer(iterator position, iterator first, iterator last) {
     if (position != last) {
       last._M_node->_M_prev->_M_next = position._M_node;
       first._M_node->_M_prev->_M_next = last._M_node;
       position._M_node->_M_prev->_M_next = first._M_node;
 
-      Node *tmp = position._M_node->_M_prev;
+      List_node_base *tmp = position._M_node->_M_prev;
       position._M_node->_M_prev = last._M_node->_M_prev;
       last._M_node->_M_prev = first._M_node->_M_prev;
       first._M_node->_M_prev = tmp;
     }
   }
 
+  template <typename StrictWeakOrdering>
+  bool _M_sort_buffered(StrictWeakOrdering comp, bool parallel = false);
+
 public:
   void splice(iterator position, list &x) {
     if (!x.empty()) {
-      this->transfer(position, begin(), end());
+      this->transfer(position, x.begin(), x.end());
+      _M_size += x._M_size;
+      x._M_size = 0;
     }
   }
 
-  void splice(iterator position, list &, iterator i) {
+  void splice(iterator position, list &x, iterator i) {
     iterator j = i;
     ++j;
     if (position == i || position == j)
       return;
     this->transfer(position, i, j);
+    ++_M_size;
+    --x._M_size;
   }
 
-  void splice(iterator position, list &, iterator first, iterator last) {
+  // O(1) within a list; from another list, counting the nodes moved
+  // takes a walk over them.
+  void splice(iterator position, list &x, iterator first, iterator last) {
     if (first != last) {
+      if (&x != this) {
+        size_type n = distance(first, last);
+        _M_size += n;
+        x._M_size -= n;
+      }
       this->transfer(position, first, last);
     }
   }
@@ -409,6 +506,13 @@ public:
   template <typename BinaryPredicate> void unique(BinaryPredicate);
   template <typename StrictWeakOrdering> void merge(list &, StrictWeakOrdering);
   template <typename StrictWeakOrdering> void sort(StrictWeakOrdering);
+
+  // sort on the threads of a pool (see stl_parallel_sort.h), for long
+  // lists.  The result is sort's; comp is called from several threads
+  // at once.
+  void parallel_sort();
+  template <typename StrictWeakOrdering>
+  void parallel_sort(StrictWeakOrdering comp);
 };
 
 template <typename T, typename Alloc>
@@ -420,7 +524,7 @@ inline bool operator==(const list<T, Alloc> &x, const list<T, Alloc> &y) {
   const_iterator i1 = x.begin();
   const_iterator i2 = y.begin();
 
-  while (i1 != end1 && i2 != end2 && *i1 != *i2) {
+  while (i1 != end1 && i2 != end2 && *i1 == *i2) {
     ++i1;
     ++i2;
   }
@@ -459,18 +563,48 @@ inline void swap(list<T, Alloc> &x, list<T, Alloc> &y) {
 
 template <typename T, typename Alloc>
 template <typename InputIterator>
-void list<T, Alloc>::_M_insert_dispatch(iterator pos, InputIterator first,
-                                        InputIterator last, _false_type) {
+void list<T, Alloc>::_M_insert_range(iterator pos, InputIterator first,
+                                     InputIterator last, input_iterator_tag) {
   for (; first != last; ++first) {
     insert(pos, *first);
   }
 }
 
 template <typename T, typename Alloc>
-void list<T, Alloc>::_M_fill_insert(iterator pos, size_type n, const T &x) {
-  for (; n > 0; --n) {
-    insert(pos, x);
+template <typename _Init>
+void list<T, Alloc>::_M_insert_nodes(iterator pos, size_type n, _Init init) {
+  Node *nodes[_S_batch];
+  List_node_base *next = pos._M_node;
+  List_node_base *prev = next->_M_prev;
+
+  while (n > 0) {
+    size_type count = n < (size_type)_S_batch ? n : (size_type)_S_batch;
+    _M_get_nodes(nodes, count);
+    size_type i = 0;
+    try {
+      for (; i < count; ++i) {
+        init(&nodes[i]->_M_data);
+        nodes[i]->_M_prev = prev;
+        prev->_M_next = nodes[i];
+        prev = nodes[i];
+        ++_M_size;
+      }
+    } catch (...) {
+      // Keep what was inserted so far, as a loop over insert would.
+      prev->_M_next = next;
+      next->_M_prev = prev;
+      _M_put_nodes(nodes + i, count - i);
+      throw;
+    }
+    n -= count;
   }
+  prev->_M_next = next;
+  next->_M_prev = prev;
+}
+
+template <typename T, typename Alloc>
+void list<T, Alloc>::_M_fill_insert(iterator pos, size_type n, const T &x) {
+  _M_insert_nodes(pos, n, [&x](T *p) { construct(p, x); });
 }
 
 template <typename T, typename Alloc>
@@ -484,15 +618,20 @@ typename list<T, Alloc>::iterator list<T, Alloc>::erase(iterator first,
 
 template <typename T, typename Alloc>
 void list<T, Alloc>::resize(size_type new_size, const T &x) {
-  iterator i = begin();
-  size_type len = 0;
-  for (; i != end() && len < new_size; ++i, ++len)
-    ;
-  if (len == new_size) {
-    erase(i, end());
+  if (new_size >= size()) {
+    insert(end(), new_size - size(), x);
+    return;
+  }
+  // Walk to the first node to erase from the nearer end.
+  iterator i;
+  if (new_size <= size() / 2) {
+    i = begin();
+    advance(i, new_size);
   } else {
-    insert(end(), new_size - len, x);
+    i = end();
+    advance(i, -difference_type(size() - new_size));
   }
+  erase(i, end());
 }
 
 template <typename T, typename Alloc>
@@ -574,6 +713,8 @@ template <typename T, typename Alloc> void list<T, Alloc>::unique() {
 
 template <typename T, typename Alloc>
 void list<T, Alloc>::merge(list<T, Alloc> &x) {
+  if (&x == this)
+    return;
   iterator first1 = begin();
   iterator last1 = end();
   iterator first2 = x.begin();
@@ -590,6 +731,8 @@ void list<T, Alloc>::merge(list<T, Alloc> &x) {
   if (first2 != last2) {
     transfer(last1, first2, last2);
   }
+  _M_size += x._M_size;
+  x._M_size = 0;
 }
 
 inline void _List_base_reverse(List_node_base *p) {
@@ -604,10 +747,57 @@ template <typename T, typename Alloc> void list<T, Alloc>::reverse() {
   _List_base_reverse(_M_node);
 }
 
+// Sorts pointers to the nodes in a buffer, then relinks the nodes once,
+// in order.  Merging spliced sublists, as sort does when it cannot get
+// the buffer, chases a node pointer at every comparison, and on a long
+// list each of those misses the cache.  If comp throws, the list is
+// left as it was.
+template <typename T, typename Alloc>
+template <typename StrictWeakOrdering>
+bool list<T, Alloc>::_M_sort_buffered(StrictWeakOrdering comp,
+                                      bool parallel) {
+  const size_type n = _M_size;
+  List_node_base **nodes =
+      (List_node_base **)malloc(2 * n * sizeof(List_node_base *));
+  if (nodes == nullptr) {
+    return false;
+  }
+  List_node_base *p = _M_node->_M_next;
+  for (size_type i = 0; i < n; ++i, p = p->_M_next) {
+    nodes[i] = p;
+  }
+  try {
+    auto node_comp = [&comp](List_node_base *a, List_node_base *b) {
+      return comp(static_cast<Node *>(a)->_M_data, static_cast<Node *>(b)->_M_data);
+    };
+    if (parallel) {
+      _parallel_merge_sort_buffered(nodes, nodes + n, nodes + n, node_comp);
+    } else {
+      _merge_sort_buffered(nodes, nodes + n, nodes + n, node_comp);
+    }
+  } catch (...) {
+    free(nodes);
+    throw;
+  }
+  p = _M_node;
+  for (size_type i = 0; i < n; ++i) {
+    p->_M_next = nodes[i];
+    nodes[i]->_M_prev = p;
+    p = nodes[i];
+  }
+  p->_M_next = _M_node;
+  _M_node->_M_prev = p;
+  free(nodes);
+  return true;
+}
+
 // merge sort
 template <typename T, typename Alloc> void list<T, Alloc>::sort() {
   // Do nothing if the list has length 0 or 1.
   if (_M_node->_M_next != _M_node && _M_node->_M_next->_M_next != _M_node) {
+    if (_M_sort_buffered([](const T &a, const T &b) { return a < b; })) {
+      return;
+    }
     list<T, Alloc> carry;
     list<T, Alloc> counter[64];
     int fill = 0;
@@ -654,7 +844,7 @@ void list<T, Alloc>::unique(BinaryPredicate binary_pred) {
     return;
   iterator next = first;
   while (++next != last) {
-    if (binary_pred(*first, next)) {
+    if (binary_pred(*first, *next)) {
       erase(next);
     } else {
       first = next;
@@ -666,6 +856,8 @@ void list<T, Alloc>::unique(BinaryPredicate binary_pred) {
 template <typename T, typename Alloc>
 template <typename StrictWeakOrdering>
 void list<T, Alloc>::merge(list<T, Alloc> &x, StrictWeakOrdering comp) {
+  if (&x == this)
+    return;
   iterator first1 = begin();
   iterator last1 = end();
   iterator first2 = x.begin();
@@ -682,6 +874,8 @@ void list<T, Alloc>::merge(list<T, Alloc> &x, StrictWeakOrdering comp) {
   if (first2 != last2) {
     transfer(last1, first2, last2);
   }
+  _M_size += x._M_size;
+  x._M_size = 0;
 }
 
 // merge sort
@@ -690,6 +884,9 @@ template <typename StrictWeakOrdering>
 void list<T, Alloc>::sort(StrictWeakOrdering comp) {
   // Do nothing if the list has length 0 or 1.
   if (_M_node->_M_next != _M_node && _M_node->_M_next->_M_next != _M_node) {
+    if (_M_sort_buffered(comp)) {
+      return;
+    }
     list<T, Alloc> carry;
     list<T, Alloc> counter[64];
     int fill = 0;
@@ -706,12 +903,24 @@ void list<T, Alloc>::sort(StrictWeakOrdering comp) {
     }
 
     for (int i = 1; i < fill; ++i) {
-      counter[i].merge(counter[i - 1].comp);
+      counter[i].merge(counter[i - 1], comp);
     }
     swap(counter[fill - 1]);
   }
 }
 
+template <typename T, typename Alloc> void list<T, Alloc>::parallel_sort() {
+  parallel_sort([](const T &a, const T &b) { return a < b; });
+}
+
+template <typename T, typename Alloc>
+template <typename StrictWeakOrdering>
+void list<T, Alloc>::parallel_sort(StrictWeakOrdering comp) {
+  if (_M_size > 1 && !_M_sort_buffered(comp, true)) {
+    sort(comp);
+  }
+}
+
 SHADOW_STL_END_NAMESPACE
 
 #endif // SHADOW_STL_INTERNAL_LIST_H
\ No newline at end of file
@@ -0,0 +1,760 @@
+#ifndef SHADOW_STL_INTERNAL_ULIST_H
+#define SHADOW_STL_INTERNAL_ULIST_H
+
+#include "algorithm/stl_algobase.h"
+#include "algorithm/stl_merge_sort.h"
+#include "allocator/stl_alloc.h"
+#include "allocator/stl_construct.h"
+#include "allocator/stl_unitialized.h"
+#include "container/list/stl_list.h"
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// An unrolled linked list: a list whose nodes each hold up to K
+// elements in an array, with a fill count.  Iteration follows one
+// pointer per K elements, and the allocator hands out one node per K
+// elements.
+//
+// Iterators are (node, index) pairs.  Inserting shifts the elements
+// behind it within its node, splitting a full node in two halves
+// first; erasing shifts them back, and merges a node that falls below
+// half full with its successor when they fit in one.  So, unlike
+// list's, these invalidate the iterators into the nodes involved.
+// splice moves whole nodes, splitting at most the nodes at the ends
+// of the range and at position.  No node is ever empty.
+
+template <typename T, size_t K>
+struct _Ulist_chunk {
+  size_t _M_count;
+  alignas(T) unsigned char _M_storage[K * sizeof(T)];
+
+  T *_M_elems() { return (T *)_M_storage; }
+};
+
+// Nodes of about 256 bytes of elements, 4 to 64 of them.
+template <typename T>
+struct _Ulist_default_capacity {
+  static const size_t _S_fit = 256 / sizeof(T);
+  static const size_t _S_value = _S_fit < 4 ? 4 : _S_fit > 64 ? 64 : _S_fit;
+};
+
+template <typename T, size_t K, typename Ref, typename Ptr>
+struct Ulist_iterator {
+  using iterator = Ulist_iterator<T, K, T &, T *>;
+  using const_iterator = Ulist_iterator<T, K, const T &, const T *>;
+  using self = Ulist_iterator<T, K, Ref, Ptr>;
+
+  using iterator_category = bidirectional_iterator_tag;
+  using value_type = T;
+  using pointer = Ptr;
+  using reference = Ref;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  using Node = List_node<_Ulist_chunk<T, K>>;
+
+  List_node_base *_M_node;
+  size_t _M_index;
+
+  Ulist_iterator() {}
+  Ulist_iterator(List_node_base *x, size_t i) : _M_node(x), _M_index(i) {}
+  Ulist_iterator(const Ulist_iterator &) = default;
+  Ulist_iterator &operator=(const Ulist_iterator &) = default;
+  // An iterator converts to a const_iterator, not the other way round.
+  template <typename R, typename = typename std::enable_if<
+                            std::is_same<R, T &>::value &&
+                            !std::is_same<Ref, T &>::value>::type>
+  Ulist_iterator(const Ulist_iterator<T, K, R, T *> &x)
+      : _M_node(x._M_node), _M_index(x._M_index) {}
+
+  static _Ulist_chunk<T, K> &_S_chunk(List_node_base *p) {
+    return static_cast<Node *>(p)->_M_data;
+  }
+
+  reference operator*() const { return _S_chunk(_M_node)._M_elems()[_M_index]; }
+  pointer operator->() const { return &(operator*()); }
+
+  self &operator++() {
+    if (++_M_index == _S_chunk(_M_node)._M_count) {
+      _M_node = _M_node->_M_next;
+      _M_index = 0;
+    }
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    ++*this;
+    return tmp;
+  }
+  self &operator--() {
+    if (_M_index == 0) {
+      _M_node = _M_node->_M_prev;
+      _M_index = _S_chunk(_M_node)._M_count - 1;
+    } else {
+      --_M_index;
+    }
+    return *this;
+  }
+  self operator--(int) {
+    self tmp = *this;
+    --*this;
+    return tmp;
+  }
+
+  template <typename R, typename P>
+  bool operator==(const Ulist_iterator<T, K, R, P> &x) const {
+    return _M_node == x._M_node && _M_index == x._M_index;
+  }
+  template <typename R, typename P>
+  bool operator!=(const Ulist_iterator<T, K, R, P> &x) const {
+    return !(*this == x);
+  }
+};
+
+// Nodes come from List_alloc_base, as list's do, with a chunk of
+// elements for data.  Like list, a ulist allocates its sentinel node.
+template <typename T, size_t K, typename Alloc>
+class Ulist_base
+    : public List_alloc_base<_Ulist_chunk<T, K>, Alloc,
+                             _Alloc_traits<T, Alloc>::_S_instanceless> {
+public:
+  using Base = List_alloc_base<_Ulist_chunk<T, K>, Alloc,
+                               _Alloc_traits<T, Alloc>::_S_instanceless>;
+  using allocator_type = typename Base::allocator_type;
+  using Node = List_node<_Ulist_chunk<T, K>>;
+
+  Ulist_base(const allocator_type &a) : Base(a) {
+    _M_node = _M_get_node();
+    _M_node->_M_next = _M_node;
+    _M_node->_M_prev = _M_node;
+  }
+  ~Ulist_base() {
+    clear();
+    _M_put_node(_M_node);
+  }
+
+  void clear() {
+    List_node_base *cur = _M_node->_M_next;
+    while (cur != _M_node) {
+      Node *tmp = static_cast<Node *>(cur);
+      cur = cur->_M_next;
+      destroy(tmp->_M_data._M_elems(),
+              tmp->_M_data._M_elems() + tmp->_M_data._M_count);
+      _M_put_node(tmp);
+    }
+    _M_node->_M_next = _M_node;
+    _M_node->_M_prev = _M_node;
+    _M_size = 0;
+  }
+
+protected:
+  using Base::_M_get_node;
+  using Base::_M_node;
+  using Base::_M_put_node;
+
+  size_t _M_size = 0;
+};
+
+template <typename T, size_t K = _Ulist_default_capacity<T>::_S_value,
+          typename Alloc = allocator<T>>
+class ulist : protected Ulist_base<T, K, Alloc> {
+  static_assert(K >= 2, "a ulist node holds at least two elements");
+
+  using Base = Ulist_base<T, K, Alloc>;
+
+public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  using allocator_type = typename _Alloc_traits<T, Alloc>::allocator_type;
+  allocator_type get_allocator() const {
+    return allocator_type(Base::get_allocator());
+  }
+
+  using iterator = Ulist_iterator<T, K, T &, T *>;
+  using const_iterator = Ulist_iterator<T, K, const T &, const T *>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+protected:
+  using Node = typename Base::Node;
+  using Chunk = _Ulist_chunk<T, K>;
+  using Base::_M_get_node;
+  using Base::_M_get_nodes;
+  using Base::_M_node;
+  using Base::_M_put_node;
+  using Base::_M_size;
+
+  static Chunk &_S_chunk(List_node_base *p) {
+    return static_cast<Node *>(p)->_M_data;
+  }
+
+  // A new empty node, linked after p.
+  List_node_base *_M_new_node_after(List_node_base *p) {
+    Node *n = _M_get_node();
+    n->_M_data._M_count = 0;
+    n->_M_prev = p;
+    n->_M_next = p->_M_next;
+    p->_M_next->_M_prev = n;
+    p->_M_next = n;
+    return n;
+  }
+  // Unlinks and frees p, which holds no elements.
+  void _M_free_node(List_node_base *p) {
+    p->_M_prev->_M_next = p->_M_next;
+    p->_M_next->_M_prev = p->_M_prev;
+    _M_put_node(static_cast<Node *>(p));
+  }
+
+  // Moves the elements from index k on of p to a new node after it,
+  // and answers that node.
+  List_node_base *_M_split(List_node_base *p, size_t k) {
+    List_node_base *q = _M_new_node_after(p);
+    Chunk &from = _S_chunk(p);
+    Chunk &to = _S_chunk(q);
+    try {
+      uninitialized_move(from._M_elems() + k, from._M_elems() + from._M_count,
+                         to._M_elems());
+    } catch (...) {
+      _M_free_node(q);
+      throw;
+    }
+    destroy(from._M_elems() + k, from._M_elems() + from._M_count);
+    to._M_count = from._M_count - k;
+    from._M_count = k;
+    return q;
+  }
+
+  // The node starting at it, splitting it off its node if needed.
+  // other, an iterator into the same list, is kept valid.
+  List_node_base *_M_cut(iterator it, iterator &other) {
+    if (it._M_index == 0) {
+      return it._M_node;
+    }
+    List_node_base *q = _M_split(it._M_node, it._M_index);
+    if (other._M_node == it._M_node && other._M_index >= it._M_index) {
+      other._M_node = q;
+      other._M_index -= it._M_index;
+    }
+    return q;
+  }
+
+  // Moves the elements of p's successor to the end of p if they fit
+  // there, and frees the successor.
+  void _M_merge_next(List_node_base *p) {
+    List_node_base *q = p->_M_next;
+    if (q == _M_node) {
+      return;
+    }
+    Chunk &to = _S_chunk(p);
+    Chunk &from = _S_chunk(q);
+    if (to._M_count + from._M_count > K) {
+      return;
+    }
+    uninitialized_move(from._M_elems(), from._M_elems() + from._M_count,
+                       to._M_elems() + to._M_count);
+    destroy(from._M_elems(), from._M_elems() + from._M_count);
+    to._M_count += from._M_count;
+    from._M_count = 0;
+    _M_free_node(q);
+  }
+
+public:
+  explicit ulist(const allocator_type &a = allocator_type())
+      : Base(typename Base::allocator_type(a)) {}
+  ulist(size_type n, const T &value, const allocator_type &a = allocator_type())
+      : Base(typename Base::allocator_type(a)) {
+    insert(end(), n, value);
+  }
+  explicit ulist(size_type n)
+      : Base(typename Base::allocator_type(allocator_type())) {
+    insert(end(), n, T());
+  }
+  template <typename InputIterator>
+  ulist(InputIterator first, InputIterator last,
+        const allocator_type &a = allocator_type())
+      : Base(typename Base::allocator_type(a)) {
+    insert(end(), first, last);
+  }
+  ulist(const ulist &x) : Base(x.Base::get_allocator()) {
+    insert(end(), x.begin(), x.end());
+  }
+  ~ulist() {}
+
+  ulist &operator=(const ulist &x);
+
+  iterator begin() { return iterator(_M_node->_M_next, 0); }
+  const_iterator begin() const { return const_iterator(_M_node->_M_next, 0); }
+  iterator end() { return iterator(_M_node, 0); }
+  const_iterator end() const { return const_iterator(_M_node, 0); }
+
+  reverse_iterator rbegin() { return reverse_iterator(end()); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  reverse_iterator rend() { return reverse_iterator(begin()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  bool empty() const { return _M_size == 0; }
+  size_type size() const { return _M_size; }
+  size_type max_size() const { return size_type(-1); }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+  reference back() { return *(--end()); }
+  const_reference back() const { return *(--end()); }
+
+  void swap(ulist &x) {
+    std::swap(_M_node, x._M_node);
+    std::swap(_M_size, x._M_size);
+  }
+
+  template <typename... Args>
+  reference emplace_back(Args &&...args) {
+    List_node_base *p = _M_node->_M_prev;
+    if (p == _M_node || _S_chunk(p)._M_count == K) {
+      p = _M_new_node_after(p);
+      try {
+        construct(_S_chunk(p)._M_elems(), std::forward<Args>(args)...);
+      } catch (...) {
+        _M_free_node(p);
+        throw;
+      }
+    } else {
+      construct(_S_chunk(p)._M_elems() + _S_chunk(p)._M_count,
+                std::forward<Args>(args)...);
+    }
+    Chunk &c = _S_chunk(p);
+    ++c._M_count;
+    ++_M_size;
+    return c._M_elems()[c._M_count - 1];
+  }
+
+  template <typename... Args>
+  reference emplace_front(Args &&...args) {
+    List_node_base *p = _M_node->_M_next;
+    if (p != _M_node && _S_chunk(p)._M_count != K) {
+      return *emplace(begin(), std::forward<Args>(args)...);
+    }
+    p = _M_new_node_after(_M_node);
+    try {
+      construct(_S_chunk(p)._M_elems(), std::forward<Args>(args)...);
+    } catch (...) {
+      _M_free_node(p);
+      throw;
+    }
+    _S_chunk(p)._M_count = 1;
+    ++_M_size;
+    return _S_chunk(p)._M_elems()[0];
+  }
+
+  template <typename... Args>
+  iterator emplace(iterator position, Args &&...args);
+
+  iterator insert(iterator position, const T &x) { return emplace(position, x); }
+  iterator insert(iterator position, T &&x) {
+    return emplace(position, std::move(x));
+  }
+  iterator insert(iterator position) { return emplace(position); }
+
+  void insert(iterator position, size_type n, const T &x) {
+    _M_fill_insert(position, n, x);
+  }
+
+  // Check whether it's an integral type.  If so, it's not an iterator.
+  template <typename InputIterator>
+  void insert(iterator position, InputIterator first, InputIterator last) {
+    using is_integer = typename _Is_integer<InputIterator>::_Integral;
+    _M_insert_dispatch(position, first, last, is_integer());
+  }
+
+  template <typename Integer>
+  void _M_insert_dispatch(iterator pos, Integer n, Integer x, _true_type) {
+    _M_fill_insert(pos, static_cast<size_type>(n), static_cast<T>(x));
+  }
+  template <typename InputIterator>
+  void _M_insert_dispatch(iterator pos, InputIterator first, InputIterator last,
+                          _false_type) {
+    if (pos == end()) {
+      for (; first != last; ++first) {
+        emplace_back(*first);
+      }
+      return;
+    }
+    for (; first != last; ++first) {
+      pos = emplace(pos, *first);
+      ++pos;
+    }
+  }
+
+  void _M_fill_insert(iterator pos, size_type n, const T &x) {
+    // x may be an element of this ulist, which the first insert can
+    // move or destroy.
+    T x_copy = x;
+    if (pos == end()) {
+      for (; n > 0; --n) {
+        emplace_back(x_copy);
+      }
+      return;
+    }
+    for (; n > 0; --n) {
+      pos = emplace(pos, x_copy);
+      ++pos;
+    }
+  }
+
+  void push_front(const T &x) { emplace_front(x); }
+  void push_front(T &&x) { emplace_front(std::move(x)); }
+  void push_back(const T &x) { emplace_back(x); }
+  void push_back(T &&x) { emplace_back(std::move(x)); }
+
+  iterator erase(iterator position);
+  iterator erase(iterator first, iterator last);
+  void clear() { Base::clear(); }
+
+  void pop_front() { erase(begin()); }
+  void pop_back() { erase(--end()); }
+
+  void resize(size_type new_size, const T &x);
+  void resize(size_type new_size) { resize(new_size, T()); }
+
+  // Moves all of x before position.
+  void splice(iterator position, ulist &x) {
+    if (!x.empty()) {
+      splice(position, x, x.begin(), x.end());
+    }
+  }
+  void splice(iterator position, ulist &x, iterator i) {
+    iterator j = i;
+    ++j;
+    if (&x == this && (position == i || position == j)) {
+      return;
+    }
+    splice(position, x, i, j);
+  }
+  // Moves [first, last) of x before position.  Counting the elements
+  // moved from another ulist walks the nodes, not the elements.
+  void splice(iterator position, ulist &x, iterator first, iterator last);
+
+  void remove(const T &value);
+  template <typename Predicate> void remove_if(Predicate pred);
+  void reverse();
+
+  // Stable.  Sorts pointers to the elements, then moves each element
+  // once, into new full nodes.
+  void sort() {
+    sort([](const T &a, const T &b) { return a < b; });
+  }
+  template <typename StrictWeakOrdering> void sort(StrictWeakOrdering comp);
+};
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator==(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return x.size() == y.size() && equal(x.begin(), x.end(), y.begin());
+}
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator<(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
+}
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator!=(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return !(x == y);
+}
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator>(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return y < x;
+}
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator<=(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return !(y < x);
+}
+
+template <typename T, size_t K, typename Alloc>
+inline bool operator>=(const ulist<T, K, Alloc> &x, const ulist<T, K, Alloc> &y) {
+  return !(x < y);
+}
+
+template <typename T, size_t K, typename Alloc>
+inline void swap(ulist<T, K, Alloc> &x, ulist<T, K, Alloc> &y) {
+  x.swap(y);
+}
+
+template <typename T, size_t K, typename Alloc>
+ulist<T, K, Alloc> &ulist<T, K, Alloc>::operator=(const ulist<T, K, Alloc> &x) {
+  if (this != &x) {
+    iterator first1 = begin();
+    iterator last1 = end();
+    const_iterator first2 = x.begin();
+    const_iterator last2 = x.end();
+    while (first1 != last1 && first2 != last2) {
+      *first1++ = *first2++;
+    }
+    if (first2 == last2) {
+      erase(first1, last1);
+    } else {
+      insert(last1, first2, last2);
+    }
+  }
+  return *this;
+}
+
+// The new element is built first: args may refer to an element that
+// the split or the shift moves.
+template <typename T, size_t K, typename Alloc>
+template <typename... Args>
+typename ulist<T, K, Alloc>::iterator
+ulist<T, K, Alloc>::emplace(iterator position, Args &&...args) {
+  if (position == end()) {
+    emplace_back(std::forward<Args>(args)...);
+    return --end();
+  }
+  T x(std::forward<Args>(args)...);
+  List_node_base *p = position._M_node;
+  size_t k = position._M_index;
+  if (_S_chunk(p)._M_count == K) {
+    List_node_base *q = _M_split(p, K / 2);
+    if (k > K / 2) {
+      p = q;
+      k -= K / 2;
+    }
+  }
+  Chunk &c = _S_chunk(p);
+  T *e = c._M_elems();
+  const size_t n = c._M_count;
+  if (k == n) {
+    construct(e + n, std::move(x));
+    ++c._M_count;
+  } else {
+    construct(e + n, std::move(e[n - 1]));
+    ++c._M_count;
+    ::move_backward(e + k, e + n - 1, e + n);
+    e[k] = std::move(x);
+  }
+  ++_M_size;
+  return iterator(p, k);
+}
+
+template <typename T, size_t K, typename Alloc>
+typename ulist<T, K, Alloc>::iterator
+ulist<T, K, Alloc>::erase(iterator position) {
+  List_node_base *p = position._M_node;
+  const size_t k = position._M_index;
+  Chunk &c = _S_chunk(p);
+  T *e = c._M_elems();
+  ::move(e + k + 1, e + c._M_count, e + k);
+  destroy(e + c._M_count - 1);
+  --c._M_count;
+  --_M_size;
+  if (c._M_count == 0) {
+    List_node_base *next = p->_M_next;
+    _M_free_node(p);
+    return iterator(next, 0);
+  }
+  if (c._M_count < K / 2) {
+    _M_merge_next(p);
+  }
+  return k < c._M_count ? iterator(p, k) : iterator(p->_M_next, 0);
+}
+
+// Whole nodes inside the range are destroyed and freed without moving
+// anything; only the elements behind last in its node shift.
+template <typename T, size_t K, typename Alloc>
+typename ulist<T, K, Alloc>::iterator
+ulist<T, K, Alloc>::erase(iterator first, iterator last) {
+  while (first != last) {
+    Chunk &c = _S_chunk(first._M_node);
+    T *e = c._M_elems();
+    if (first._M_node == last._M_node) {
+      const size_t n = last._M_index - first._M_index;
+      ::move(e + last._M_index, e + c._M_count, e + first._M_index);
+      destroy(e + c._M_count - n, e + c._M_count);
+      c._M_count -= n;
+      _M_size -= n;
+      if (c._M_count < K / 2) {
+        _M_merge_next(first._M_node);
+      }
+      return first;
+    }
+    destroy(e + first._M_index, e + c._M_count);
+    _M_size -= c._M_count - first._M_index;
+    c._M_count = first._M_index;
+    List_node_base *next = first._M_node->_M_next;
+    if (c._M_count == 0) {
+      _M_free_node(first._M_node);
+    }
+    first = iterator(next, 0);
+  }
+  return last;
+}
+
+template <typename T, size_t K, typename Alloc>
+void ulist<T, K, Alloc>::resize(size_type new_size, const T &x) {
+  if (new_size >= size()) {
+    insert(end(), new_size - size(), x);
+    return;
+  }
+  iterator i;
+  if (new_size <= size() / 2) {
+    i = begin();
+    advance(i, new_size);
+  } else {
+    i = end();
+    advance(i, -difference_type(size() - new_size));
+  }
+  erase(i, end());
+}
+
+// Cuts [first, last) out of x as a chain of whole nodes, splitting the
+// nodes at its ends, and links the chain in before position.  Within
+// one list the cuts may move position to a new node, so it is updated.
+template <typename T, size_t K, typename Alloc>
+void ulist<T, K, Alloc>::splice(iterator position, ulist &x, iterator first,
+                                iterator last) {
+  if (first == last) {
+    return;
+  }
+  iterator unused = position;
+  iterator &keep = &x == this ? position : unused;
+  List_node_base *stop = x._M_cut(last, keep);
+  List_node_base *start = x._M_cut(first, keep);
+  List_node_base *before = _M_cut(position, unused);
+  if (before == start || before == stop) {
+    return;
+  }
+
+  if (&x != this) {
+    size_type n = 0;
+    for (List_node_base *p = start; p != stop; p = p->_M_next) {
+      n += _S_chunk(p)._M_count;
+    }
+    _M_size += n;
+    x._M_size -= n;
+  }
+
+  List_node_base *tail = stop->_M_prev;
+  start->_M_prev->_M_next = stop;
+  stop->_M_prev = start->_M_prev;
+
+  start->_M_prev = before->_M_prev;
+  tail->_M_next = before;
+  before->_M_prev->_M_next = start;
+  before->_M_prev = tail;
+}
+
+template <typename T, size_t K, typename Alloc>
+void ulist<T, K, Alloc>::remove(const T &value) {
+  iterator i = begin();
+  while (i != end()) {
+    if (*i == value) {
+      i = erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+template <typename T, size_t K, typename Alloc>
+template <typename Predicate>
+void ulist<T, K, Alloc>::remove_if(Predicate pred) {
+  iterator i = begin();
+  while (i != end()) {
+    if (pred(*i)) {
+      i = erase(i);
+    } else {
+      ++i;
+    }
+  }
+}
+
+template <typename T, size_t K, typename Alloc>
+void ulist<T, K, Alloc>::reverse() {
+  _List_base_reverse(_M_node);
+  for (List_node_base *p = _M_node->_M_next; p != _M_node; p = p->_M_next) {
+    Chunk &c = _S_chunk(p);
+    T *lo = c._M_elems();
+    T *hi = lo + c._M_count - 1;
+    for (; lo < hi; ++lo, --hi) {
+      iter_swap(lo, hi);
+    }
+  }
+}
+
+// Every node of the new chain is allocated before the first element
+// is moved, so a failed allocation leaves the ulist as it was.  The
+// elements are then moved, which cannot throw, or copied, if moving
+// may: a throwing copy drops the new chain and leaves the originals.
+template <typename T, size_t K, typename Alloc>
+template <typename StrictWeakOrdering>
+void ulist<T, K, Alloc>::sort(StrictWeakOrdering comp) {
+  const size_type n = size();
+  if (n < 2) {
+    return;
+  }
+  T **ptrs = (T **)malloc_alloc::allocate(2 * n * sizeof(T *));
+  size_type i = 0;
+  for (iterator it = begin(); it != end(); ++it) {
+    ptrs[i++] = &*it;
+  }
+  // The second half of ptrs is the merge buffer, then holds the nodes.
+  Node **nodes = (Node **)(ptrs + n);
+  const size_type count = (n + K - 1) / K;
+  try {
+    _merge_sort_buffered(ptrs, ptrs + n, ptrs + n,
+                         [&comp](T *a, T *b) { return comp(*a, *b); });
+    _M_get_nodes(nodes, count);
+  } catch (...) {
+    malloc_alloc::deallocate(ptrs, 2 * n * sizeof(T *));
+    throw;
+  }
+
+  List_node_base chain;
+  chain._M_next = chain._M_prev = &chain;
+  for (i = 0; i < count; ++i) {
+    nodes[i]->_M_data._M_count = 0;
+    nodes[i]->_M_prev = chain._M_prev;
+    nodes[i]->_M_next = &chain;
+    chain._M_prev->_M_next = nodes[i];
+    chain._M_prev = nodes[i];
+  }
+  try {
+    List_node_base *p = chain._M_next;
+    for (i = 0; i < n; ++i) {
+      if (_S_chunk(p)._M_count == K) {
+        p = p->_M_next;
+      }
+      Chunk &c = _S_chunk(p);
+      construct(c._M_elems() + c._M_count, std::move_if_noexcept(*ptrs[i]));
+      ++c._M_count;
+    }
+  } catch (...) {
+    while (chain._M_next != &chain) {
+      Chunk &c = _S_chunk(chain._M_next);
+      destroy(c._M_elems(), c._M_elems() + c._M_count);
+      _M_free_node(chain._M_next);
+    }
+    malloc_alloc::deallocate(ptrs, 2 * n * sizeof(T *));
+    throw;
+  }
+  malloc_alloc::deallocate(ptrs, 2 * n * sizeof(T *));
+
+  Base::clear();
+  _M_node->_M_next = chain._M_next;
+  _M_node->_M_prev = chain._M_prev;
+  chain._M_next->_M_prev = _M_node;
+  chain._M_prev->_M_next = _M_node;
+  _M_size = n;
+}
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_ULIST_H
@@ -0,0 +1,207 @@
+#ifndef SHADOW_STL_INTERNAL_INTRUSIVE_SLIST_H
+#define SHADOW_STL_INTERNAL_INTRUSIVE_SLIST_H
+
+#include "container/list/stl_intrusive_list.h"
+#include "container/slist/stl_slist.h"
+#include <cstddef>
+#include <type_traits>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// The singly linked counterpart of intrusive_list (see
+// stl_intrusive_list.h): objects carry an slist_hook, and the list links
+// them through it without allocating.  Like slist, it is linked with the
+// _slist_* helpers, ends in a null link, and size() is linear.
+
+struct slist_hook : public Slist_node_base {
+  slist_hook() noexcept { _next = nullptr; }
+  // A copy of an object is in no list.
+  slist_hook(const slist_hook &) noexcept : slist_hook() {}
+  slist_hook &operator=(const slist_hook &) noexcept { return *this; }
+};
+
+template <typename T, slist_hook T::*Hook, typename Ref, typename Ptr>
+struct Intrusive_slist_iterator : public Slist_iterator_base {
+  using iterator = Intrusive_slist_iterator<T, Hook, T &, T *>;
+  using const_iterator = Intrusive_slist_iterator<T, Hook, const T &, const T *>;
+  using self = Intrusive_slist_iterator<T, Hook, Ref, Ptr>;
+
+  using value_type = T;
+  using pointer = Ptr;
+  using reference = Ref;
+
+  using Traits = _Intrusive_traits<T, slist_hook, Hook>;
+
+  Intrusive_slist_iterator() : Slist_iterator_base(nullptr) {}
+  explicit Intrusive_slist_iterator(Slist_node_base *x) : Slist_iterator_base(x) {}
+  Intrusive_slist_iterator(const Intrusive_slist_iterator &) = default;
+  Intrusive_slist_iterator &operator=(const Intrusive_slist_iterator &) = default;
+  // An iterator converts to a const_iterator, not the other way round.
+  template <typename R, typename = typename std::enable_if<
+                            std::is_same<R, T &>::value &&
+                            !std::is_same<Ref, T &>::value>::type>
+  Intrusive_slist_iterator(const Intrusive_slist_iterator<T, Hook, R, T *> &x)
+      : Slist_iterator_base(x._node) {}
+
+  reference operator*() const { return *Traits::_S_owner(_node); }
+  pointer operator->() const { return &(operator*()); }
+
+  self &operator++() {
+    _M_incr();
+    return *this;
+  }
+  self operator++(int) {
+    self tmp = *this;
+    _M_incr();
+    return tmp;
+  }
+};
+
+template <typename T, slist_hook T::*Hook> class intrusive_slist {
+public:
+  using value_type = T;
+  using pointer = T *;
+  using const_pointer = const T *;
+  using reference = T &;
+  using const_reference = const T &;
+  using size_type = size_t;
+  using difference_type = ptrdiff_t;
+
+  using iterator = Intrusive_slist_iterator<T, Hook, T &, T *>;
+  using const_iterator = Intrusive_slist_iterator<T, Hook, const T &, const T *>;
+
+private:
+  using Traits = _Intrusive_traits<T, slist_hook, Hook>;
+  using Node_base = Slist_node_base;
+
+  Node_base _head;
+
+  static Node_base *_S_unlink_after(Node_base *pos) {
+    Node_base *h = pos->_next;
+    pos->_next = h->_next;
+    h->_next = nullptr;
+    return pos->_next;
+  }
+
+public:
+  intrusive_slist() { _head._next = nullptr; }
+  // Nothing points at the head but the list itself, so moves are two
+  // pointer copies.
+  intrusive_slist(intrusive_slist &&x) noexcept {
+    _head._next = x._head._next;
+    x._head._next = nullptr;
+  }
+  intrusive_slist &operator=(intrusive_slist &&x) noexcept {
+    if (this != &x) {
+      clear();
+      _head._next = x._head._next;
+      x._head._next = nullptr;
+    }
+    return *this;
+  }
+  ~intrusive_slist() { clear(); }
+
+  iterator before_begin() { return iterator(&_head); }
+  const_iterator before_begin() const {
+    return const_iterator(const_cast<Node_base *>(&_head));
+  }
+  iterator begin() { return iterator(_head._next); }
+  const_iterator begin() const { return const_iterator(_head._next); }
+  iterator end() { return iterator(nullptr); }
+  const_iterator end() const { return const_iterator(nullptr); }
+
+  bool empty() const { return _head._next == nullptr; }
+  size_type size() const { return _slist_size(_head._next); }
+  size_type max_size() const { return size_type(-1); }
+
+  reference front() { return *begin(); }
+  const_reference front() const { return *begin(); }
+
+  // The position of x, which is in this list.
+  iterator iterator_to(T &x) { return iterator(Traits::_S_hook(x)); }
+  const_iterator iterator_to(const T &x) const {
+    return const_iterator(Traits::_S_hook(const_cast<T &>(x)));
+  }
+
+  // The position before pos.  Linear in distance(begin(), pos).
+  iterator previous(const_iterator pos) {
+    return iterator(_slist_previous(&_head, pos._node));
+  }
+  const_iterator previous(const_iterator pos) const {
+    return const_iterator(const_cast<Node_base *>(
+        _slist_previous(&_head, pos._node)));
+  }
+
+  void swap(intrusive_slist &x) { std::swap(_head._next, x._head._next); }
+
+  // x must not be in a list through Hook already.
+  iterator insert_after(iterator pos, T &x) {
+    return iterator(_slist_make_link(pos._node, Traits::_S_hook(x)));
+  }
+  template <typename InputIterator>
+  void insert_after(iterator pos, InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      pos = insert_after(pos, *first);
+    }
+  }
+  void push_front(T &x) { insert_after(before_begin(), x); }
+
+  iterator erase_after(iterator pos) {
+    return iterator(_S_unlink_after(pos._node));
+  }
+  // Unlinks (before_first, last).
+  iterator erase_after(iterator before_first, iterator last) {
+    while (before_first._node->_next != last._node) {
+      _S_unlink_after(before_first._node);
+    }
+    return last;
+  }
+  void pop_front() { erase_after(before_begin()); }
+  void clear() { erase_after(before_begin(), end()); }
+
+  // Moves (before_first, before_last] of x after pos.
+  void splice_after(iterator pos, iterator before_first, iterator before_last) {
+    if (before_first != before_last) {
+      _slist_splice_after(pos._node, before_first._node, before_last._node);
+    }
+  }
+  // Moves the object after prev after pos.
+  void splice_after(iterator pos, iterator prev) {
+    _slist_splice_after(pos._node, prev._node, prev._node->_next);
+  }
+  // Moves all of x after pos.  Linear in x.size().
+  void splice_after(iterator pos, intrusive_slist &x) {
+    _slist_splice_after(pos._node, &x._head);
+  }
+
+  template <typename Predicate> void remove_if(Predicate pred) {
+    Node_base *cur = &_head;
+    while (cur->_next) {
+      if (pred(*Traits::_S_owner(cur->_next))) {
+        _S_unlink_after(cur);
+      } else {
+        cur = cur->_next;
+      }
+    }
+  }
+
+  void reverse() {
+    if (_head._next) {
+      _head._next = _slist_reverse(_head._next);
+    }
+  }
+
+private:
+  // Non-copyable: an object is in one list per hook.
+  intrusive_slist(const intrusive_slist &);
+  void operator=(const intrusive_slist &);
+};
+
+template <typename T, slist_hook T::*Hook>
+inline void swap(intrusive_slist<T, Hook> &x, intrusive_slist<T, Hook> &y) {
+  x.swap(y);
+}
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_INTRUSIVE_SLIST_H
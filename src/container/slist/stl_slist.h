@@ -1,11 +1,14 @@
 #ifndef SHADOW_STL_INTERNAL_SLIST_H
 #define SHADOW_STL_INTERNAL_SLIST_H
 
+#include "algorithm/stl_merge_sort.h"
+#include "algorithm/stl_parallel_sort.h"
 #include "allocator/stl_alloc.h"
 #include "allocator/stl_construct.h"
 #include "include/type_traits.h"
 #include "iterator/stl_iterator_base.h"
 #include <cstddef>
+#include <cstdlib>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -157,15 +160,28 @@ template <typename T, typename Allocator, bool IsStatic>
 class Slist_alloc_base {
 public:
   using allocator_type = typename _Alloc_traits<T, Allocator>::allocator_type;
-  allocator_type get_allocator() const { return allocator_type(); }
+  allocator_type get_allocator() const { return allocator_type(_node_allocator); }
 
   Slist_alloc_base(const allocator_type &a) : _node_allocator(a) {}
 
 protected:
   Slist_node<T> *_M_get_node() { return _node_allocator.allocate(1); }
   void _M_put_node(Slist_node<T> *p) { _node_allocator.deallocate(p, 1); }
+  void _M_get_nodes(Slist_node<T> **out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      try {
+        out[i] = _node_allocator.allocate(1);
+      } catch (...) {
+        _M_put_nodes(out, i);
+        throw;
+      }
+    }
+  }
+  void _M_put_nodes(Slist_node<T> **p, size_t n) {
+    for (size_t i = 0; i < n; ++i) _node_allocator.deallocate(p[i], 1);
+  }
 
-  allocator_type _node_allocator;
+  typename _Alloc_traits<Slist_node<T>, Allocator>::allocator_type _node_allocator;
   Slist_node_base _head;
 };
 
@@ -183,6 +199,13 @@ protected:
       typename _Alloc_traits<Slist_node<T>, Allocator>::_Alloc_type;
   Slist_node<T> *_M_get_node() { return Alloc_type::allocate(1); }
   void _M_put_node(Slist_node<T> *p) { Alloc_type::deallocate(p, 1); }
+  // One trip to the allocator for n nodes.
+  void _M_get_nodes(Slist_node<T> **out, size_t n) {
+    Alloc_type::allocate_batch(out, n);
+  }
+  void _M_put_nodes(Slist_node<T> **p, size_t n) {
+    Alloc_type::deallocate_batch(p, n);
+  }
 
   Slist_node_base _head;
 };
@@ -198,9 +221,19 @@ struct Slist_base
   using Base::_head;
 
   Slist_base(const allocator_type &a) : Base(a) { _head._next = nullptr; }
-  ~Slist_base() { _M_erase_after(&_head, nullptr); }
+  ~Slist_base() { _M_clear(); }
 
 protected:
+  void _M_clear() {
+    _M_clear(typename _Is_monotonic_alloc<Alloc>::_Monotonic(),
+             typename _type_traits<T>::has_trivial_destructor());
+  }
+  // A monotonic allocator ignores deallocate, so when there is nothing
+  // to destroy either, the nodes are simply dropped.
+  void _M_clear(_true_type, _true_type) { _head._next = nullptr; }
+  template <typename _Monotonic, typename _Trivial>
+  void _M_clear(_Monotonic, _Trivial) { _M_erase_after(&_head, nullptr); }
+
   Slist_node_base *_M_erase_after(Slist_node_base *pos) {
     Slist_node<T> *next = static_cast<Slist_node<T> *>(pos->_next);
     Slist_node_base *next_next = next->_next;
@@ -251,12 +284,26 @@ private:
   using Base::_head;
   using Base::_M_erase_after;
   using Base::_M_get_node;
+  using Base::_M_get_nodes;
   using Base::_M_put_node;
+  using Base::_M_put_nodes;
 
   using Node = Slist_node<T>;
   using Node_base = Slist_node_base;
   using Iterator_base = Slist_iterator_base;
 
+  // Bulk insertions fetch their nodes from the allocator this many at
+  // a time.
+  enum { _S_batch = 64 };
+
+  // Inserts n nodes after pos, constructing the value of each with
+  // init(&value).  Returns the last node inserted.
+  template <typename _Init>
+  Node_base *_M_insert_nodes_after(Node_base *pos, size_type n, _Init init);
+
+  template <typename StrictWeakOrdering>
+  bool _M_sort_buffered(StrictWeakOrdering comp, bool parallel = false);
+
   Node *_M_create_node(const value_type &x) {
     Node *node = _M_get_node();
     try {
@@ -332,6 +379,8 @@ public:
   const_iterator begin() const {
     return const_iterator(static_cast<Node *>(_head._next));
   }
+  iterator end() { return iterator(nullptr); }
+  const_iterator end() const { return const_iterator(nullptr); }
 
   // Experimental new feature: before_begin() returns a
   // non-dereferenceable iterator that, when incremented, yields
@@ -340,9 +389,9 @@ public:
   // slist, before_begin() is not the same iterator as end().  It
   // is always necessary to increment before_begin() at least once to
   // obtain end().
-  iterator before_begin() { return iterator(static_cast<Node *>(_head)); }
+  iterator before_begin() { return iterator(static_cast<Node *>(&_head)); }
   const_iterator before_begin() const {
-    return const_iterator(static_cast<Node *>(_head));
+    return const_iterator(static_cast<Node *>(const_cast<Node_base *>(&_head)));
   }
 
   size_type size() const {
@@ -359,7 +408,7 @@ public:
   void push_front(const value_type &x) {
     _slist_make_link(&_head, _M_create_node(x));
   }
-  void push_front() { _slist_make_link(_head, _M_create_node()); }
+  void push_front() { _slist_make_link(&_head, _M_create_node()); }
   void pop_front() {
     Node *node = static_cast<Node *>(_head._next);
     _head._next = node->_next;
@@ -385,9 +434,7 @@ private:
   }
 
   void _M_insert_after_fill(Node_base *pos, size_type n, const value_type &x) {
-    for (size_type i = 0; i < n; ++i) {
-      pos = _slist_make_link(pos, _M_create_node(x));
-    }
+    _M_insert_nodes_after(pos, n, [&x](T *p) { construct(p, x); });
   }
 
   // Check whether it's an integral type.  If so, it's not an iterator.
@@ -403,10 +450,26 @@ private:
   template <typename InputIter>
   void _M_insert_after_range(Node_base *pos, InputIter first, InputIter last,
                              _false_type) {
+    _M_insert_after_range(pos, first, last, iterator_category(first));
+  }
+  template <typename InputIter>
+  void _M_insert_after_range(Node_base *pos, InputIter first, InputIter last,
+                             input_iterator_tag) {
     for (; first != last; ++first) {
       pos = _slist_make_link(pos, _M_create_node(*first));
     }
   }
+  // The length of a forward range is known up front, so its nodes can
+  // be fetched in batches.
+  template <typename ForwardIter>
+  void _M_insert_after_range(Node_base *pos, ForwardIter first,
+                             ForwardIter last, forward_iterator_tag) {
+    size_type n = distance(first, last);
+    _M_insert_nodes_after(pos, n, [&first](T *p) {
+      construct(p, *first);
+      ++first;
+    });
+  }
 
 public:
   iterator insert_after(iterator pos, const value_type &x) {
@@ -418,13 +481,19 @@ public:
   void insert_after(iterator pos, size_type n, const value_type &x) {
     _M_insert_after_fill(pos._node, n, x);
   }
+  // We don't need any dispatching tricks here, because _M_insert_after_range
+  // already does them.
+  template <typename InpuIterator>
+  void insert_after(iterator pos, InpuIterator first, InpuIterator last) {
+    _M_insert_after_range(pos._node, first, last);
+  }
 
   iterator insert(iterator pos) {
     return iterator(
         _M_insert_after(_slist_previous(&_head, pos._node), value_type()));
   }
   void insert(iterator pos, size_type n, const value_type &x) {
-    _M_insert_after_fill(_slist_previous(_head, pos._node), n, x);
+    _M_insert_after_fill(_slist_previous(&_head, pos._node), n, x);
   }
   // We don't need any dispatching tricks here, because _M_insert_after_range
   // already does them.
@@ -450,7 +519,7 @@ public:
   }
   void resize(size_type new_size, const T &x);
   void resize(size_type new_size) { resize(new_size, T()); }
-  void clear() { _M_erase_after(&_head, nullptr); }
+  void clear() { Base::_M_clear(); }
 
   // Moves the range [__before_first + 1, __before_last + 1) to *this,
   //  inserting it immediately after __pos.  This is constant time.
@@ -510,6 +579,13 @@ public:
   void merge(slist &x, StrictWeakOrdering comp);
 
   template <typename StrictWeakOrdering> void sort(StrictWeakOrdering comp);
+
+  // sort on the threads of a pool (see stl_parallel_sort.h), for long
+  // lists.  The result is sort's; comp is called from several threads
+  // at once.
+  void parallel_sort();
+  template <typename StrictWeakOrdering>
+  void parallel_sort(StrictWeakOrdering comp);
 };
 
 template <typename T, typename Alloc>
@@ -670,8 +746,47 @@ void slist<T, Alloc>::merge(slist<T, Alloc> &x) {
   }
 }
 
+// As list's: sorts pointers to the nodes, then relinks them once.
+template <typename T, typename Alloc>
+template <typename StrictWeakOrdering>
+bool slist<T, Alloc>::_M_sort_buffered(StrictWeakOrdering comp,
+                                       bool parallel) {
+  const size_type n = _slist_size(_head._next);
+  Node_base **nodes = (Node_base **)malloc(2 * n * sizeof(Node_base *));
+  if (nodes == nullptr) {
+    return false;
+  }
+  Node_base *p = _head._next;
+  for (size_type i = 0; i < n; ++i, p = p->_next) {
+    nodes[i] = p;
+  }
+  try {
+    auto node_comp = [&comp](Node_base *a, Node_base *b) {
+      return comp(static_cast<Node *>(a)->_data, static_cast<Node *>(b)->_data);
+    };
+    if (parallel) {
+      _parallel_merge_sort_buffered(nodes, nodes + n, nodes + n, node_comp);
+    } else {
+      _merge_sort_buffered(nodes, nodes + n, nodes + n, node_comp);
+    }
+  } catch (...) {
+    free(nodes);
+    throw;
+  }
+  p = &_head;
+  for (size_type i = 0; i < n; ++i) {
+    p = p->_next = nodes[i];
+  }
+  p->_next = nullptr;
+  free(nodes);
+  return true;
+}
+
 template <typename T, typename Alloc> void slist<T, Alloc>::sort() {
   if (_head._next && _head._next->_next) {
+    if (_M_sort_buffered([](const T &a, const T &b) { return a < b; })) {
+      return;
+    }
     slist<T, Alloc> carry;
     slist<T, Alloc> counter[64];
     int fill = 0;
@@ -743,6 +858,9 @@ template <typename T, typename Alloc>
 template <typename StrictWeakOrdering>
 void slist<T, Alloc>::sort(StrictWeakOrdering comp) {
   if (_head._next && _head._next->_next) {
+    if (_M_sort_buffered(comp)) {
+      return;
+    }
     slist<T, Alloc> carry;
     slist<T, Alloc> counter[64];
     int fill = 0;
@@ -760,12 +878,54 @@ void slist<T, Alloc>::sort(StrictWeakOrdering comp) {
     }
 
     for (int i = 1; i < fill; ++i) {
-      counter[i].merge(counter[i - 1]);
+      counter[i].merge(counter[i - 1], comp);
     }
     swap(counter[fill - 1]);
   }
 }
 
+template <typename T, typename Alloc> void slist<T, Alloc>::parallel_sort() {
+  parallel_sort([](const T &a, const T &b) { return a < b; });
+}
+
+template <typename T, typename Alloc>
+template <typename StrictWeakOrdering>
+void slist<T, Alloc>::parallel_sort(StrictWeakOrdering comp) {
+  if (_head._next && _head._next->_next && !_M_sort_buffered(comp, true)) {
+    sort(comp);
+  }
+}
+
+template <typename T, typename Alloc>
+template <typename _Init>
+Slist_node_base *slist<T, Alloc>::_M_insert_nodes_after(Node_base *pos,
+                                                        size_type n,
+                                                        _Init init) {
+  Node *nodes[_S_batch];
+  Node_base *next = pos->_next;
+
+  while (n > 0) {
+    size_type count = n < (size_type)_S_batch ? n : (size_type)_S_batch;
+    _M_get_nodes(nodes, count);
+    size_type i = 0;
+    try {
+      for (; i < count; ++i) {
+        init(&nodes[i]->_data);
+        pos->_next = nodes[i];
+        pos = nodes[i];
+      }
+    } catch (...) {
+      // Keep what was inserted so far, as a loop over insert would.
+      pos->_next = next;
+      _M_put_nodes(nodes + i, count - i);
+      throw;
+    }
+    n -= count;
+  }
+  pos->_next = next;
+  return pos;
+}
+
 SHADOW_STL_END_NAMESPACE
 
 #endif // SHADOW_STL_INTERNAL_SLIST_H
\ No newline at end of file
@@ -0,0 +1,6 @@
+#ifndef SHADOW_STL_SMALL_VECTOR_H
+#define SHADOW_STL_SMALL_VECTOR_H
+
+#include "container/vector/stl_small_vector.h"
+
+#endif // SHADOW_STL_SMALL_VECTOR_H
@@ -0,0 +1,6 @@
+#ifndef SHADOW_STL_ULIST_H
+#define SHADOW_STL_ULIST_H
+
+#include "container/list/stl_ulist.h"
+
+#endif // SHADOW_STL_ULIST_H
\ No newline at end of file
@@ -267,7 +267,7 @@ public:
         : _M_start(), _M_finish(), _M_end_of_storage(nullptr) {}
 
 protected:
-    using _Alloc_type = typename _Alloc_traits<unsigned int, Allocator>::allocator_type;
+    using _Alloc_type = typename _Alloc_traits<unsigned int, Allocator>::_Alloc_type;
 
     unsigned int* _M_bit_alloc(size_t n) {
         return _Alloc_type::allocate((n + WORD_BIT - 1) / WORD_BIT);
@@ -295,8 +295,8 @@ public:
     }
 };
 
-template <typename Alloc>
-class vector<bool, Alloc> : public _Bvector_base<Alloc> {
+template <typename Alloc, typename Growth>
+class vector<bool, Alloc, Growth> : public _Bvector_base<Alloc> {
 public:
     using value_type = bool;
     using size_type = size_t;
@@ -331,14 +331,21 @@ protected:
         _M_finish = _M_start + difference_type(n);
     }
 
+    // The capacity in bits to grow to when n more do not fit.  Whole
+    // words are allocated anyway.
+    size_type _M_next_capacity(size_type n) const {
+        return Growth::_S_capacity(size(), n, [](size_type k) {
+            return (k + WORD_BIT - 1) / WORD_BIT * WORD_BIT;
+        });
+    }
+
     void _M_insert_aux(iterator position, bool x) {
         if (_M_finish._M_p != _M_end_of_storage) {
             copy_backward(position, _M_finish, _M_finish + 1);
             *position = x;
             ++_M_finish;
         } else {
-            const size_type old_size = size();
-            const size_type len = old_size != 0 ? 2 * old_size : 1;
+            const size_type len = _M_next_capacity(1);
             unsigned int* q = _M_bit_alloc(len);
             iterator i = copy(begin(), position, iterator(q, 0));
             *i++ = x;
@@ -383,11 +390,11 @@ protected:
                 copy(first, last, pos);
                 _M_finish += difference_type(n);
             } else {
-                const size_type old_size = size();
-                const size_type len = old_size + max(old_size, n);
+                const size_type len = _M_next_capacity(n);
                 unsigned int* q = _M_bit_alloc(len);
                 iterator i = copy(begin(), pos, iterator(q, 0));
-                i = copy(pos, end(), i);
+                i = copy(first, last, i);
+                _M_finish = copy(pos, end(), i);
                 _M_deallocate();
                 _M_end_of_storage = q + (len + WORD_BIT - 1) / WORD_BIT;
                 _M_start = iterator(q, 0);
@@ -581,6 +588,19 @@ public:
         }
     }
 
+    // Releases the unused whole words.
+    void shrink_to_fit() {
+        const size_type words = (size() + WORD_BIT - 1) / WORD_BIT;
+        if (_M_start._M_p + words != _M_end_of_storage) {
+            const size_type n = size();
+            unsigned int* q = words != 0 ? _M_bit_alloc(n) : nullptr;
+            _M_finish = copy(begin(), end(), iterator(q, 0));
+            _M_deallocate();
+            _M_start = iterator(q, 0);
+            _M_end_of_storage = q + words;
+        }
+    }
+
     reference front() {
         return *begin();
     }
@@ -688,8 +708,7 @@ public:
             fill(position, position + n, x);
             _M_finish += difference_type(n);
         } else {
-            const size_type old_size = size();
-            const size_type len = old_size + max(old_size, n);
+            const size_type len = _M_next_capacity(n);
             unsigned int* q = _M_bit_alloc(len);
             iterator i = copy(begin(), position, iterator(q, 0));
             fill_n(i, n, x);
@@ -0,0 +1,130 @@
+#ifndef SHADOW_STL_INTERNAL_SMALL_VECTOR_H
+#define SHADOW_STL_INTERNAL_SMALL_VECTOR_H
+
+#include "container/vector/stl_vector.h"
+#include <cstring>
+#include <type_traits>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// small_vector<T, N> is a vector that keeps up to N elements in a buffer
+// inside the object, and only goes to the allocator when it outgrows
+// them.  It has the whole vector interface: it is vector itself, with
+// _Small_vector_base in place of _Vector_base.  Growth past N moves the
+// elements to the heap for good, except that shrink_to_fit brings them
+// back when they fit again.
+//
+// Unlike vector's, a small_vector's move constructor, move assignment
+// and swap move the elements one by one while they are inline.  These
+// are noexcept only if T's move constructor is.
+
+template <typename T, typename Alloc, size_t N>
+class _Small_vector_base
+    : public _Vector_alloc_base<T, Alloc,
+                                _Alloc_traits<T, Alloc>::_S_instanceless> {
+  static_assert(N > 0, "a small_vector without inline elements is a vector");
+
+public:
+  using _Base =
+      _Vector_alloc_base<T, Alloc, _Alloc_traits<T, Alloc>::_S_instanceless>;
+  using allocator_type = typename _Base::allocator_type;
+
+  _Small_vector_base(const allocator_type &a) noexcept : _Base(a) {
+    _M_reset();
+  }
+  _Small_vector_base(size_t n, const allocator_type &a) : _Base(a) {
+    _M_reset();
+    if (n > N) {
+      this->_M_start = this->_M_finish = _Base::_M_allocate(n);
+      this->_M_end_of_storage = this->_M_start + n;
+    }
+  }
+
+  ~_Small_vector_base() {
+    _M_deallocate(this->_M_start, this->_M_end_of_storage - this->_M_start);
+  }
+
+protected:
+  alignas(T) unsigned char _M_buffer[N * sizeof(T)];
+
+  T *_M_inline() const noexcept { return (T *)_M_buffer; }
+  void _M_reset() noexcept {
+    this->_M_start = this->_M_finish = _M_inline();
+    this->_M_end_of_storage = this->_M_start + N;
+  }
+
+  // The inline buffer, when no elements live there, serves requests of
+  // up to N elements.
+  T *_M_allocate(size_t n) {
+    if (n <= N && (this->_M_start != _M_inline() ||
+                   this->_M_finish == this->_M_start)) {
+      return _M_inline();
+    }
+    return _Base::_M_allocate(n);
+  }
+  void _M_deallocate(T *p, size_t n) {
+    if (p != _M_inline()) {
+      _Base::_M_deallocate(p, n);
+    }
+  }
+  T *_M_reallocate(T *p, size_t old_n, size_t new_n, size_t used) {
+    if (p != _M_inline() && new_n > N) {
+      return _Base::_M_reallocate(p, old_n, new_n, used);
+    }
+    if (p == _M_inline() && new_n <= N) {
+      return p;
+    }
+    T *result = p == _M_inline() ? _Base::_M_allocate(new_n) : _M_inline();
+    // The smaller buffer bounds the copy, and the live elements fit it.
+    const size_t n = old_n < new_n ? old_n : new_n;
+    memcpy((void *)result, (const void *)p, (used < n ? used : n) * sizeof(T));
+    _M_deallocate(p, old_n);
+    return result;
+  }
+
+  // The storage hooks of _Vector_base.
+  static constexpr bool _S_nothrow_take =
+      std::is_nothrow_move_constructible<T>::value;
+
+  // The inline buffer always holds N elements.
+  T *_M_storage_end(T *p, size_t n) const {
+    return p == _M_inline() ? p + N : p + n;
+  }
+  void _M_take_storage(_Small_vector_base &x) noexcept(_S_nothrow_take) {
+    if (x._M_start != x._M_inline()) {
+      this->_M_start = x._M_start;
+      this->_M_finish = x._M_finish;
+      this->_M_end_of_storage = x._M_end_of_storage;
+      x._M_reset();
+    } else {
+      this->_M_finish =
+          uninitialized_move(x._M_start, x._M_finish, this->_M_start);
+      destroy(x._M_start, x._M_finish);
+      x._M_finish = x._M_start;
+    }
+  }
+  void _M_release_storage() noexcept {
+    _M_deallocate(this->_M_start, this->_M_end_of_storage - this->_M_start);
+    _M_reset();
+  }
+  void _M_swap_storage(_Small_vector_base &x) noexcept(_S_nothrow_take) {
+    if (this->_M_start != _M_inline() && x._M_start != x._M_inline()) {
+      std::swap(this->_M_start, x._M_start);
+      std::swap(this->_M_finish, x._M_finish);
+      std::swap(this->_M_end_of_storage, x._M_end_of_storage);
+      return;
+    }
+    _Small_vector_base tmp(this->get_allocator());
+    tmp._M_take_storage(*this);
+    _M_take_storage(x);
+    x._M_take_storage(tmp);
+  }
+};
+
+template <typename T, size_t N, typename Alloc = allocator<T>,
+          typename Growth = grow_by_doubling>
+using small_vector = vector<T, Alloc, Growth, _Small_vector_base<T, Alloc, N>>;
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_SMALL_VECTOR_H
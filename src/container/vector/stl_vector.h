@@ -8,7 +8,9 @@
 #include "stl_construct.h"
 #include "stl_iterator_base.h"
 #include "stl_unitialized.h"
+#include "container/vector/stl_vector_growth.h"
 #include <cstddef>
+#include <cstring>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -43,6 +45,20 @@ protected:
       _M_data_allocator.deallocate(p, n);
     }
   }
+  size_t _M_good_size(size_t n) const { return n; }
+  // Moves the bytes of the first used elements of a buffer of old_n to
+  // a buffer of new_n; no more than new_n of them are kept.
+  T *_M_reallocate(T *p, size_t old_n, size_t new_n, size_t used) {
+    T *result = _M_allocate(new_n);
+    if (used > new_n) {
+      used = new_n;
+    }
+    if (used != 0) {
+      memcpy((void *)result, (const void *)p, used * sizeof(T));
+    }
+    _M_deallocate(p, old_n);
+    return result;
+  }
 };
 
 // Specialization for allocators that have the property that we don't
@@ -61,60 +77,82 @@ protected:
   T *_M_finish = nullptr;
   T *_M_end_of_storage = nullptr;
 
-  using _Alloc_traits_type = _Alloc_traits<T, Allocator>;
-  T *_M_allocate(size_t n) { return _Alloc_traits_type::allocate(_M_start, n); }
-  void _M_deallocate(T *p, size_t n) {
-    _Alloc_traits_type::deallocate(_M_start, p, n);
+  using _Alloc_type = typename _Alloc_traits<T, Allocator>::_Alloc_type;
+  T *_M_allocate(size_t n) { return _Alloc_type::allocate(n); }
+  void _M_deallocate(T *p, size_t n) { _Alloc_type::deallocate(p, n); }
+  size_t _M_good_size(size_t n) const { return _Alloc_type::good_size(n); }
+  // As above, in place if the allocator can.  The allocator's
+  // reallocate keeps min(old_n, new_n) elements, so used goes unread.
+  T *_M_reallocate(T *p, size_t old_n, size_t new_n, size_t /* used */) {
+    return _Alloc_type::reallocate(p, old_n, new_n);
   }
 };
 
-// template <typename T, typename Alloc>
-// struct _Vector_base : public _Vector_alloc_base<T, Alloc, _Alloc_traits<T,
-// Alloc>::_S_instanceless> {
-//     using _Base = _Vector_alloc_base<T, Alloc, _Alloc_traits<T,
-//     Alloc>::_S_instanceless>; using allocator_type = typename
-//     _Base::allocator_type;
-
-//     _Vector_base(const allocator_type& a) : _Base(a) {}
-//     _Vector_base(size_t n, const allocator_type& a) : _Base(a) {
-//         _M_start = _M_allocate(n);
-//         _M_finish = _M_start;
-//         _M_end_of_storage = _M_start + n;
-//     }
-
-//     ~_Vector_base() {
-//         _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-//     }
-// };
-
-template <typename T, typename Alloc> class _Vector_base {
-public:
-  using allocator_type = Alloc;
-  allocator_type get_allocator() const noexcept { return allocator_type(); }
+template <typename T, typename Alloc>
+struct _Vector_base
+    : public _Vector_alloc_base<T, Alloc,
+                                _Alloc_traits<T, Alloc>::_S_instanceless> {
+  using _Base =
+      _Vector_alloc_base<T, Alloc, _Alloc_traits<T, Alloc>::_S_instanceless>;
+  using allocator_type = typename _Base::allocator_type;
 
-  _Vector_base(const allocator_type &) noexcept
-      : _M_start(nullptr), _M_finish(nullptr), _M_end_of_storage(nullptr) {}
-  _Vector_base(size_t n, const allocator_type &) noexcept
-      : _M_start(nullptr), _M_finish(nullptr), _M_end_of_storage(nullptr) {
-    _M_start = _M_allocate(n);
-    _M_finish = _M_start;
-    _M_end_of_storage = _M_start + n;
+  _Vector_base(const allocator_type &a) noexcept : _Base(a) {}
+  _Vector_base(size_t n, const allocator_type &a) : _Base(a) {
+    this->_M_start = this->_M_allocate(n);
+    this->_M_finish = this->_M_start;
+    this->_M_end_of_storage = this->_M_start + n;
   }
 
-protected:
-  T *_M_start = nullptr;
-  T *_M_finish = nullptr;
-  T *_M_end_of_storage = nullptr;
+  ~_Vector_base() {
+    this->_M_deallocate(this->_M_start,
+                        this->_M_end_of_storage - this->_M_start);
+  }
 
-  using _M_data_allocator = simple_alloc<T, Alloc>;
-  T *_M_allocate(size_t n) { return _M_data_allocator::allocate(n); }
-  void _M_deallocate(T *p, size_t n) { _M_data_allocator::deallocate(p, n); }
+protected:
+  // How vector hands its storage around.  _Small_vector_base (see
+  // stl_small_vector.h) provides the same members for storage that may
+  // be an inline buffer.
+  static constexpr bool _S_nothrow_take = true;
+
+  // The end of a buffer of n elements at p.
+  T *_M_storage_end(T *p, size_t n) const { return p + n; }
+  // Takes the elements and the storage of x, leaving it empty without
+  // storage.  *this must have neither.
+  void _M_take_storage(_Vector_base &x) noexcept {
+    this->_M_start = x._M_start;
+    this->_M_finish = x._M_finish;
+    this->_M_end_of_storage = x._M_end_of_storage;
+    x._M_start = x._M_finish = x._M_end_of_storage = nullptr;
+  }
+  // Frees the storage, which must hold no elements.
+  void _M_release_storage() noexcept {
+    this->_M_deallocate(this->_M_start,
+                        this->_M_end_of_storage - this->_M_start);
+    this->_M_start = this->_M_finish = this->_M_end_of_storage = nullptr;
+  }
+  void _M_swap_storage(_Vector_base &x) noexcept {
+    std::swap(this->_M_start, x._M_start);
+    std::swap(this->_M_finish, x._M_finish);
+    std::swap(this->_M_end_of_storage, x._M_end_of_storage);
+  }
 };
 
-template <typename T, typename Alloc = allocator<T>>
-class vector : protected _Vector_base<T, Alloc> {
+// Tag selecting default- instead of value-initialization of the
+// elements: vector<char> buf(n, default_init) leaves the bytes as the
+// allocator returned them, for a read() to fill.
+struct default_init_t {
+  explicit default_init_t() = default;
+};
+inline constexpr default_init_t default_init{};
+
+// Growth is the growth policy, see stl_vector_growth.h.  Storage is
+// the base class owning the buffer; small_vector replaces it.
+template <typename T, typename Alloc = allocator<T>,
+          typename Growth = grow_by_doubling,
+          typename Storage = _Vector_base<T, Alloc>>
+class vector : protected Storage {
 private:
-  using _Base = _Vector_base<T, Alloc>;
+  using _Base = Storage;
 
 public:
   using value_type = T;
@@ -133,16 +171,74 @@ public:
 protected:
   using _Base::_M_allocate;
   using _Base::_M_deallocate;
+  using _Base::_M_reallocate;
+  using _Base::_M_good_size;
+  using _Base::_M_storage_end;
+  using _Relocatable = typename _Is_trivially_relocatable<T>::_Relocatable;
   using _Base::_M_end_of_storage;
   using _Base::_M_finish;
   using _Base::_M_start;
 
-  void _M_insert_aux(iterator position, const T &x);
-  void _M_insert_aux(iterator position);
+  // The capacity to grow to when n more elements do not fit.
+  size_type _M_next_capacity(size_type n) const {
+    return Growth::_S_capacity(size(), n, [this](size_type k) {
+      return _M_good_size(k);
+    });
+  }
+
+  template <typename... Args>
+  void _M_insert_aux(iterator position, Args &&...args);
+  template <typename _Fill>
+  void _M_reallocate_insert(size_type len, iterator position, size_type n,
+                            _Fill fill);
+  iterator _M_relocate(iterator new_start, iterator after, iterator position,
+                       _true_type);
+  iterator _M_relocate(iterator new_start, iterator after, iterator position,
+                       _false_type);
+
+  // Moves the elements to a buffer of len >= size() elements.
+  // Trivially relocatable elements go through the allocator's
+  // reallocate, which may resize the buffer in place (or, for large
+  // buffers, have realloc remap the pages) instead of copying them.
+  void _M_resize_storage(size_type len, _true_type) {
+    const size_type old_size = size();
+    _M_start = _M_reallocate(_M_start, capacity(), len, old_size);
+    _M_finish = _M_start + old_size;
+    _M_end_of_storage = _M_storage_end(_M_start, len);
+  }
+  void _M_resize_storage(size_type len, _false_type) {
+    _M_reallocate_insert(len, end(), 0, [](iterator) {});
+  }
+
+  // Growth to len elements, then construction of one more element at
+  // the end.  args may refer to an element, which reallocate may move,
+  // so the new element is built first and its bytes moved in after.
+  template <typename... Args>
+  void _M_grow_append(size_type len, _true_type, Args &&...args) {
+    alignas(T) unsigned char buf[sizeof(T)];
+    T *x = (T *)buf;
+    construct(x, std::forward<Args>(args)...);
+    try {
+      _M_resize_storage(len, _true_type());
+    } catch (...) {
+      destroy(x);
+      throw;
+    }
+    memcpy((void *)_M_finish, (const void *)x, sizeof(T));
+    ++_M_finish;
+  }
+  template <typename... Args>
+  void _M_grow_append(size_type len, _false_type, Args &&...args) {
+    _M_reallocate_insert(len, end(), 1, [&](iterator gap) {
+      construct(gap, std::forward<Args>(args)...);
+    });
+  }
 
 public:
-  using allocator_type = Alloc;
-  allocator_type get_allocator() const noexcept { return allocator_type(); }
+  using allocator_type = typename _Base::allocator_type;
+  allocator_type get_allocator() const noexcept {
+    return _Base::get_allocator();
+  }
 
   iterator begin() noexcept { return _M_start; }
   const_iterator begin() const noexcept { return _M_start; }
@@ -193,10 +289,21 @@ public:
     _M_finish = uninitialized_fill_n(_M_start, n, T());
   }
 
+  vector(size_type n, default_init_t,
+         const allocator_type &a = allocator_type())
+      : _Base(n, a) {
+    _M_finish = uninitialized_default_n(_M_start, n);
+  }
+
   vector(const vector &x) : _Base(x.size(), x.get_allocator()) {
     _M_finish = uninitialized_copy(x.begin(), x.end(), _M_start);
   }
 
+  vector(vector &&x) noexcept(_Base::_S_nothrow_take)
+      : _Base(x.get_allocator()) {
+    this->_M_take_storage(x);
+  }
+
   // Check whether it's an integral type.  If so, it's not an iterator.
   template <typename InputIterator>
   vector(InputIterator first, InputIterator last,
@@ -209,7 +316,7 @@ public:
   template <typename Integer>
   void _M_initialize_aux(Integer n, Integer value, _true_type) {
     _M_start = _M_allocate(static_cast<size_type>(n));
-    _M_end_of_storage = _M_start + static_cast<size_type>(n);
+    _M_end_of_storage = _M_storage_end(_M_start, static_cast<size_type>(n));
     _M_finish = uninitialized_fill_n(_M_start, n, value);
   }
   template <typename InputIterator>
@@ -220,16 +327,29 @@ public:
   ~vector() { destroy(_M_start, _M_finish); }
 
   vector &operator=(const vector &x);
+  // Like swap(), this assumes the allocators are interchangeable.
+  vector &operator=(vector &&x) noexcept(_Base::_S_nothrow_take) {
+    if (&x != this) {
+      destroy(_M_start, _M_finish);
+      _M_finish = _M_start;
+      this->_M_release_storage();
+      this->_M_take_storage(x);
+    }
+    return *this;
+  }
 
   void reserve(size_type n) {
     if (capacity() < n) {
-      const size_type old_size = size();
-      iterator tmp = _M_allocate_and_copy(n, _M_start, _M_finish);
-      destroy(_M_start, _M_finish);
-      _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-      _M_start = tmp;
-      _M_finish = tmp + old_size;
-      _M_end_of_storage = _M_start + n;
+      _M_resize_storage(n, _Relocatable());
+    }
+  }
+  // Releases the unused capacity (a small_vector keeps its inline
+  // buffer whole).
+  void shrink_to_fit() {
+    if (empty()) {
+      this->_M_release_storage();
+    } else if (_M_storage_end(_M_start, size()) != _M_end_of_storage) {
+      _M_resize_storage(size(), _Relocatable());
     }
   }
 
@@ -268,47 +388,42 @@ public:
   reference back() { return *(end() - 1); }
   const_reference back() const { return *(end() - 1); }
 
-  void push_back(const T &x) {
-    if (_M_finish != _M_end_of_storage) {
-      construct(_M_finish, x);
-      ++_M_finish;
-    } else {
-      _M_insert_aux(end(), x);
-    }
-  }
-  void push_back() {
+  void push_back(const T &x) { emplace_back(x); }
+  void push_back(T &&x) { emplace_back(std::move(x)); }
+  void push_back() { emplace_back(); }
+
+  template <typename... Args>
+  reference emplace_back(Args &&...args) {
     if (_M_finish != _M_end_of_storage) {
-      construct(_M_finish);
+      construct(_M_finish, std::forward<Args>(args)...);
       ++_M_finish;
     } else {
-      _M_insert_aux(end());
+      _M_insert_aux(end(), std::forward<Args>(args)...);
     }
+    return back();
   }
 
-  void swap(vector &x) noexcept {
-    std::swap(_M_start, x._M_start);
-    std::swap(_M_finish, x._M_finish);
-    std::swap(_M_end_of_storage, x._M_end_of_storage);
+  void swap(vector &x) noexcept(_Base::_S_nothrow_take) {
+    this->_M_swap_storage(x);
   }
 
   // insert before `position`
   iterator insert(iterator position, const T &x) {
-    size_type n = position - begin();
-    if (_M_finish != _M_end_of_storage && position == end()) {
-      construct(_M_finish, x);
-      ++_M_finish;
-    } else {
-      _M_insert_aux(position, x);
-    }
-    return begin() + n;
+    return emplace(position, x);
+  }
+  iterator insert(iterator position, T &&x) {
+    return emplace(position, std::move(x));
   }
-  iterator insert(iterator position) {
+  iterator insert(iterator position) { return emplace(position); }
+
+  template <typename... Args>
+  iterator emplace(iterator position, Args &&...args) {
     size_type n = position - begin();
     if (_M_finish != _M_end_of_storage && position == end()) {
-      construct(_M_finish);
+      construct(_M_finish, std::forward<Args>(args)...);
       ++_M_finish;
     } else {
-      _M_insert_aux(position);
+      _M_insert_aux(position, std::forward<Args>(args)...);
     }
     return begin() + n;
   }
@@ -343,14 +458,14 @@ public:
   }
 
   iterator erase(iterator first, iterator last) {
-    iterator i = copy(last, _M_finish, first);
+    iterator i = ::move(last, _M_finish, first);
     destroy(i, _M_finish);
     _M_finish = _M_finish - (last - first);
     return first;
   }
   iterator erase(iterator position) {
     if (position + 1 != end()) {
-      copy(position + 1, _M_finish, position);
+      ::move(position + 1, _M_finish, position);
     }
     --_M_finish;
     destroy(_M_finish);
@@ -365,6 +480,19 @@ public:
     }
   }
   void resize(size_type new_size) { resize(new_size, T()); }
+  // Like resize(new_size), but default-initializes the new elements, so
+  // trivial ones are not written.
+  void resize_default_init(size_type new_size) {
+    if (new_size < size()) {
+      erase(begin() + new_size, end());
+    } else if (new_size > size()) {
+      const size_type n = new_size - size();
+      if (size_type(_M_end_of_storage - _M_finish) < n) {
+        _M_resize_storage(_M_next_capacity(n), _Relocatable());
+      }
+      _M_finish = uninitialized_default_n(_M_finish, n);
+    }
+  }
   void clear() { erase(begin(), end()); }
 
 protected:
@@ -395,7 +523,7 @@ protected:
                            forward_iterator_tag) {
     size_type n = distance(first, last);
     _M_start = _M_allocate(n);
-    _M_end_of_storage = _M_start + n;
+    _M_end_of_storage = _M_storage_end(_M_start, n);
     _M_finish = uninitialized_copy(first, last, _M_start);
   }
 
@@ -407,50 +535,50 @@ protected:
                        ForwardIterator last, forward_iterator_tag);
 };
 
-template <typename T, typename Alloc>
-inline bool operator==(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator==(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return x.size() == y.size() && equal(x.begin(), x.end(), y.begin());
 }
 
-template <typename T, typename Alloc>
-inline bool operator<(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator<(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return lexicographical_compare(x.begin(), x.end(), y.begin(), y.end());
 }
 
-template <typename T, typename Alloc>
-inline void swap(vector<T, Alloc> &x, vector<T, Alloc> &y) noexcept {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline void swap(vector<T, Alloc, Growth, Storage> &x, vector<T, Alloc, Growth, Storage> &y) noexcept(noexcept(x.swap(y))) {
   x.swap(y);
 }
 
-template <typename T, typename Alloc>
-inline bool operator!=(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator!=(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return !(x == y);
 }
 
-template <typename T, typename Alloc>
-inline bool operator>(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator>(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return y < x;
 }
 
-template <typename T, typename Alloc>
-inline bool operator<=(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator<=(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return !(y < x);
 }
 
-template <typename T, typename Alloc>
-inline bool operator>=(const vector<T, Alloc> &x, const vector<T, Alloc> &y) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+inline bool operator>=(const vector<T, Alloc, Growth, Storage> &x, const vector<T, Alloc, Growth, Storage> &y) {
   return !(x < y);
 }
 
-template <typename T, typename Alloc>
-vector<T, Alloc> &vector<T, Alloc>::operator=(const vector<T, Alloc> &x) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+vector<T, Alloc, Growth, Storage> &vector<T, Alloc, Growth, Storage>::operator=(const vector<T, Alloc, Growth, Storage> &x) {
   if (&x != this) {
     if (x.size() > capacity()) {
       iterator tmp = _M_allocate_and_copy(x.size(), x.begin(), x.end());
       destroy(_M_start, _M_finish);
       _M_deallocate(_M_start, _M_end_of_storage - _M_start);
       _M_start = tmp;
-      _M_end_of_storage = _M_start + x.size();
+      _M_end_of_storage = _M_storage_end(_M_start, x.size());
     } else if (size() >= x.size()) {
       iterator i = copy(x.begin(), x.end(), begin());
       destroy(i, _M_finish);
@@ -463,11 +591,21 @@ vector<T, Alloc> &vector<T, Alloc>::operator=(const vector<T, Alloc> &x) {
   return *this;
 }
 
-template <typename T, typename Alloc>
-void vector<T, Alloc>::_M_fill_assign(size_t n, const value_type &val) {
+template <typename T, typename Alloc, typename Growth, typename Storage>
+void vector<T, Alloc, Growth, Storage>::_M_fill_assign(size_t n, const value_type &val) {
   if (n > capacity()) {
-    vector<T, Alloc> tmp(n, val, get_allocator());
-    tmp.swap(*this);
+    iterator tmp = _M_allocate(n);
+    try {
+      uninitialized_fill_n(tmp, n, val);
+    } catch (...) {
+      _M_deallocate(tmp, n);
+      throw;
+    }
+    destroy(_M_start, _M_finish);
+    _M_deallocate(_M_start, _M_end_of_storage - _M_start);
+    _M_start = tmp;
+    _M_finish = tmp + n;
+    _M_end_of_storage = _M_storage_end(tmp, n);
   } else if (n > size()) {
     fill(begin(), end(), val);
     _M_finish = uninitialized_fill_n(_M_finish, n - size(), val);
@@ -476,9 +614,9 @@ void vector<T, Alloc>::_M_fill_assign(size_t n, const value_type &val) {
   }
 }
 
-template <typename T, typename Alloc>
+template <typename T, typename Alloc, typename Growth, typename Storage>
 template <typename InputIterator>
-void vector<T, Alloc>::_M_assign_aux(InputIterator first, InputIterator last,
+void vector<T, Alloc, Growth, Storage>::_M_assign_aux(InputIterator first, InputIterator last,
                                      input_iterator_tag) {
   iterator cur = begin();
   for (; first != last && cur != end(); ++cur, ++first) {
@@ -491,9 +629,9 @@ void vector<T, Alloc>::_M_assign_aux(InputIterator first, InputIterator last,
   }
 }
 
-template <typename T, typename Alloc>
+template <typename T, typename Alloc, typename Growth, typename Storage>
 template <typename ForwardIterator>
-void vector<T, Alloc>::_M_assign_aux(ForwardIterator first,
+void vector<T, Alloc, Growth, Storage>::_M_assign_aux(ForwardIterator first,
                                      ForwardIterator last,
                                      forward_iterator_tag) {
   size_type len = distance(first, last);
@@ -502,7 +640,7 @@ void vector<T, Alloc>::_M_assign_aux(ForwardIterator first,
     destroy(_M_start, _M_finish);
     _M_deallocate(_M_start, _M_end_of_storage - _M_start);
     _M_start = tmp;
-    _M_end_of_storage = _M_start + len;
+    _M_end_of_storage = _M_storage_end(_M_start, len);
   } else if (size() >= len) {
     iterator new_finish = copy(first, last, _M_start);
     destroy(new_finish, _M_finish);
@@ -515,87 +653,136 @@ void vector<T, Alloc>::_M_assign_aux(ForwardIterator first,
   }
 }
 
-template <typename T, typename Alloc>
-void vector<T, Alloc>::_M_insert_aux(iterator position, const T &x) {
+// Moves the elements to a new buffer of len elements, leaving a gap of n
+// elements at position, which fill(gap) constructs.  fill runs first, so
+// it may still refer to the old elements.  If anything throws, the
+// vector is left as it was, unless relocating an element moved it and
+// its move constructor threw.
+template <typename T, typename Alloc, typename Growth, typename Storage>
+template <typename _Fill>
+void vector<T, Alloc, Growth, Storage>::_M_reallocate_insert(size_type len, iterator position,
+                                            size_type n, _Fill fill) {
+  iterator new_start = _M_allocate(len);
+  iterator gap = new_start + (position - begin());
+  try {
+    fill(gap);
+  } catch (...) {
+    _M_deallocate(new_start, len);
+    throw;
+  }
+  iterator new_finish;
+  try {
+    new_finish = _M_relocate(new_start, gap + n, position, _Relocatable());
+  } catch (...) {
+    destroy(gap, gap + n);
+    _M_deallocate(new_start, len);
+    throw;
+  }
+  _M_deallocate(_M_start, _M_end_of_storage - _M_start);
+  _M_start = new_start;
+  _M_finish = new_finish;
+  _M_end_of_storage = _M_storage_end(new_start, len);
+}
+
+// Relocates [begin(), position) to new_start and [position, end()) to
+// after, ending the lifetime of the old elements.  Answers the end of the
+// relocated elements.  Trivially relocatable elements are copied as
+// bytes and need no destructor call.
+template <typename T, typename Alloc, typename Growth, typename Storage>
+typename vector<T, Alloc, Growth, Storage>::iterator
+vector<T, Alloc, Growth, Storage>::_M_relocate(iterator new_start, iterator after,
+                              iterator position, _true_type) {
+  const size_type before = position - _M_start;
+  const size_type behind = _M_finish - position;
+  if (before != 0) {
+    memcpy((void *)new_start, (const void *)_M_start, before * sizeof(T));
+  }
+  if (behind != 0) {
+    memcpy((void *)after, (const void *)position, behind * sizeof(T));
+  }
+  return after + behind;
+}
+
+// The elements are moved if that cannot throw and copied otherwise, so
+// that a throwing copy leaves them intact.
+template <typename T, typename Alloc, typename Growth, typename Storage>
+typename vector<T, Alloc, Growth, Storage>::iterator
+vector<T, Alloc, Growth, Storage>::_M_relocate(iterator new_start, iterator after,
+                              iterator position, _false_type) {
+  iterator new_finish =
+      _uninitialized_move_if_noexcept(_M_start, position, new_start);
+  try {
+    new_finish = _uninitialized_move_if_noexcept(position, _M_finish, after);
+  } catch (...) {
+    destroy(new_start, new_finish);
+    throw;
+  }
+  destroy(_M_start, _M_finish);
+  return new_finish;
+}
+
+template <typename T, typename Alloc, typename Growth, typename Storage>
+template <typename... Args>
+void vector<T, Alloc, Growth, Storage>::_M_insert_aux(iterator position, Args &&...args) {
   if (_M_finish != _M_end_of_storage) {
-    construct(_M_finish, *(_M_finish - 1));
+    // args may refer to an element we are about to move.
+    T x_copy(std::forward<Args>(args)...);
+    construct(_M_finish, std::move(*(_M_finish - 1)));
     ++_M_finish;
-    T x_copy = x;
-    copy_backward(position, _M_finish - 2, _M_finish - 1);
-    *position = x_copy;
+    ::move_backward(position, _M_finish - 2, _M_finish - 1);
+    *position = std::move(x_copy);
   } else {
-    const size_type old_size = size();
-    const size_type len = old_size != 0 ? 2 * old_size : 1;
-    iterator new_start = _M_allocate(len);
-    iterator new_finish = new_start;
-    try {
-      new_finish = uninitialized_copy(_M_start, position, new_start);
-      construct(new_finish, x);
-      ++new_finish;
-      new_finish = uninitialized_copy(position, _M_finish, new_finish);
-    } catch (...) {
-      destroy(new_start, new_finish);
-      _M_deallocate(new_start, len);
+    const size_type len = _M_next_capacity(1);
+    if (position == end()) {
+      _M_grow_append(len, _Relocatable(), std::forward<Args>(args)...);
+    } else {
+      _M_reallocate_insert(len, position, 1, [&](iterator gap) {
+        construct(gap, std::forward<Args>(args)...);
+      });
     }
-    destroy(begin(), end());
-    _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-    _M_start = new_start;
-    _M_finish = new_finish;
-    _M_end_of_storage = new_start + len;
   }
 }
 
-template <typename T, typename Alloc>
-void vector<T, Alloc>::_M_insert_aux(iterator position) {
-  // delegate
-  _M_insert_aux(position, T());
-}
-
-template <typename T, typename Alloc>
-void vector<T, Alloc>::_M_fill_insert(iterator position, size_type n,
+template <typename T, typename Alloc, typename Growth, typename Storage>
+void vector<T, Alloc, Growth, Storage>::_M_fill_insert(iterator position, size_type n,
                                       const T &x) {
-  if (n != 0) {
-    if (size_type(_M_end_of_storage - _M_finish) >= n) {
-      T x_copy = x;
-      const size_type elems_after = _M_finish - position;
-      iterator old_finish = _M_finish;
-      if (elems_after > n) {
-        uninitialized_copy(_M_finish - n, _M_finish, _M_finish);
-        _M_finish += n;
-        copy_backward(position, old_finish - n, old_finish);
-        fill(position, position + n, x_copy);
-      } else {
-        uninitialized_fill_n(_M_finish, n - elems_after, x_copy);
-        _M_finish += n - elems_after;
-        uninitialized_copy(position, old_finish, _M_finish);
-        _M_finish += elems_after;
-        fill(position, old_finish, x_copy);
-      }
+  if (n == 0) {
+    return;
+  }
+  if (size_type(_M_end_of_storage - _M_finish) >= n) {
+    T x_copy = x;
+    const size_type elems_after = _M_finish - position;
+    iterator old_finish = _M_finish;
+    if (elems_after > n) {
+      uninitialized_move(_M_finish - n, _M_finish, _M_finish);
+      _M_finish += n;
+      ::move_backward(position, old_finish - n, old_finish);
+      fill(position, position + n, x_copy);
+    } else {
+      uninitialized_fill_n(_M_finish, n - elems_after, x_copy);
+      _M_finish += n - elems_after;
+      uninitialized_move(position, old_finish, _M_finish);
+      _M_finish += elems_after;
+      fill(position, old_finish, x_copy);
     }
   } else {
-    const size_type old_size = size();
-    const size_type len = old_size + max(old_size, n);
-    iterator new_start = _M_allocate(len);
-    iterator new_finish = new_start;
-    try {
-      new_finish = uninitialized_copy(_M_start, position, new_start);
-      new_finish = uninitialized_fill_n(new_finish, n, x);
-      new_finish = uninitialized_copy(position, _M_finish, new_finish);
-    } catch (...) {
-      destroy(new_start, new_finish);
-      _M_deallocate(new_start, len);
+    const size_type len = _M_next_capacity(n);
+    if (position == end()) {
+      // x may be an element.
+      T x_copy = x;
+      _M_resize_storage(len, _Relocatable());
+      _M_finish = uninitialized_fill_n(_M_finish, n, x_copy);
+    } else {
+      _M_reallocate_insert(len, position, n, [&](iterator gap) {
+        uninitialized_fill_n(gap, n, x);
+      });
     }
-    destroy(begin(), end());
-    _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-    _M_start = new_start;
-    _M_finish = new_finish;
-    _M_end_of_storage = new_start + len;
   }
 }
 
-template <typename T, typename Alloc>
+template <typename T, typename Alloc, typename Growth, typename Storage>
 template <typename InputIterator>
-void vector<T, Alloc>::_M_range_insert(iterator position, InputIterator first,
+void vector<T, Alloc, Growth, Storage>::_M_range_insert(iterator position, InputIterator first,
                                        InputIterator last, input_iterator_tag) {
   for (; first != last; ++first) {
     position = insert(position, *first);
@@ -603,9 +790,9 @@ void vector<T, Alloc>::_M_range_insert(iterator position, InputIterator first,
   }
 }
 
-template <typename T, typename Alloc>
+template <typename T, typename Alloc, typename Growth, typename Storage>
 template <typename ForwardIterator>
-void vector<T, Alloc>::_M_range_insert(iterator position, ForwardIterator first,
+void vector<T, Alloc, Growth, Storage>::_M_range_insert(iterator position, ForwardIterator first,
                                        ForwardIterator last,
                                        forward_iterator_tag) {
   if (first != last) {
@@ -615,43 +802,30 @@ void vector<T, Alloc>::_M_range_insert(iterator position, ForwardIterator first,
       const size_type elems_after = _M_finish - position;
       iterator old_finish = _M_finish;
       if (elems_after > n) {
-        uninitialized_copy(_M_finish - n, _M_finish, _M_finish);
+        uninitialized_move(_M_finish - n, _M_finish, _M_finish);
         _M_finish += n;
-        copy_backward(position, old_finish - n, old_finish);
+        ::move_backward(position, old_finish - n, old_finish);
         copy(first, last, position);
       } else {
         ForwardIterator mid = first;
         advance(mid, elems_after);
         uninitialized_copy(mid, last, _M_finish);
         _M_finish += n - elems_after;
-        uninitialized_copy(position, old_finish, _M_finish);
+        uninitialized_move(position, old_finish, _M_finish);
         _M_finish += elems_after;
         copy(first, mid, position);
       }
     } else {
-      const size_type old_size = size();
-      const size_type len = old_size + max(old_size, n);
-      iterator new_start = _M_allocate(len);
-      iterator new_finish = new_start;
-      try {
-        new_finish = uninitialized_copy(_M_start, position, new_start);
-        new_finish = uninitialized_copy(first, last, new_finish);
-        new_finish = uninitialized_copy(position, _M_finish, new_finish);
-      } catch (...) {
-        destroy(new_start, new_finish);
-        _M_deallocate(new_start, len);
-      }
-      destroy(begin(), end());
-      _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-      _M_start = new_start;
-      _M_finish = new_finish;
-      _M_end_of_storage = new_start + len;
+      const size_type len = _M_next_capacity(n);
+      _M_reallocate_insert(len, position, n, [&](iterator gap) {
+        uninitialized_copy(first, last, gap);
+      });
     }
   }
 }
 
-template <typename T, typename Alloc>
-void vector<T, Alloc>::insert(iterator position, const_iterator first,
+template <typename T, typename Alloc, typename Growth, typename Storage>
+void vector<T, Alloc, Growth, Storage>::insert(iterator position, const_iterator first,
                               const_iterator last) {
   if (first != last) {
     size_type n = 0;
@@ -660,35 +834,22 @@ void vector<T, Alloc>::insert(iterator position, const_iterator first,
       const size_type elems_after = _M_finish - position;
       iterator old_finish = _M_finish;
       if (elems_after > n) {
-        uninitialized_copy(_M_finish - n, _M_finish, _M_finish);
+        uninitialized_move(_M_finish - n, _M_finish, _M_finish);
         _M_finish += n;
-        copy_backward(position, old_finish - n, old_finish);
+        ::move_backward(position, old_finish - n, old_finish);
         copy(first, last, position);
       } else {
         uninitialized_copy(first + elems_after, last, _M_finish);
         _M_finish += n - elems_after;
-        uninitialized_copy(position, old_finish, _M_finish);
+        uninitialized_move(position, old_finish, _M_finish);
         _M_finish += elems_after;
         copy(first, first + elems_after, position);
       }
     } else {
-      const size_type old_size = size();
-      const size_type len = old_size + max(old_size, n);
-      iterator new_start = _M_allocate(len);
-      iterator new_finish = new_start;
-      try {
-        new_finish = uninitialized_copy(_M_start, position, new_start);
-        new_finish = uninitialized_copy(first, last, new_finish);
-        new_finish = uninitialized_copy(position, _M_finish, new_finish);
-      } catch (...) {
-        destroy(new_start, new_finish);
-        _M_deallocate(new_start, len);
-      }
-      destroy(begin(), end());
-      _M_deallocate(_M_start, _M_end_of_storage - _M_start);
-      _M_start = new_start;
-      _M_finish = new_finish;
-      _M_end_of_storage = new_start + len;
+      const size_type len = _M_next_capacity(n);
+      _M_reallocate_insert(len, position, n, [&](iterator gap) {
+        uninitialized_copy(first, last, gap);
+      });
     }
   }
 }
@@ -0,0 +1,50 @@
+#ifndef SHADOW_STL_INTERNAL_VECTOR_GROWTH_H
+#define SHADOW_STL_INTERNAL_VECTOR_GROWTH_H
+
+// Growth policies for vector, its third template parameter.  When a
+// vector of size elements needs room for n more than its capacity, it
+// allocates Growth::_S_capacity(size, n, good_size) elements, which must
+// be at least size + n.  good_size(k) is the number of elements the
+// allocator hands out at no extra cost when asked for k: k rounded up to
+// the size class or, for large blocks, to whole pages.  It is k itself
+// for allocators that do not say (see good_size in stl_alloc.h).
+//
+//   grow_by_doubling        the default; amortized O(1) push_back with
+//                           up to 50% of the buffer unused
+//   grow_by_half            1.5x: more reallocations, at most a third
+//                           unused, and freed buffers can be reused by
+//                           later growth
+//   grow_to_fit_allocator   doubling, then everything up to good_size,
+//                           so no slack the allocator gives is wasted
+
+#include <stddef.h>
+
+#include "include/stl_config.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+struct grow_by_doubling {
+    template <typename _GoodSize>
+    static size_t _S_capacity(size_t size, size_t n, _GoodSize) {
+        return size + (size < n ? n : size);
+    }
+};
+
+struct grow_by_half {
+    template <typename _GoodSize>
+    static size_t _S_capacity(size_t size, size_t n, _GoodSize) {
+        const size_t half = size / 2 != 0 ? size / 2 : 1;
+        return size + (half < n ? n : half);
+    }
+};
+
+struct grow_to_fit_allocator {
+    template <typename _GoodSize>
+    static size_t _S_capacity(size_t size, size_t n, _GoodSize good_size) {
+        return good_size(grow_by_doubling::_S_capacity(size, n, good_size));
+    }
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_INTERNAL_VECTOR_GROWTH_H
@@ -0,0 +1,211 @@
+#ifndef SHADOW_STL_LOCK_PROFILE_H
+#define SHADOW_STL_LOCK_PROFILE_H
+
+// Optional contention profiling of the library's internal locks.
+// Compile with SHADOW_STL_LOCK_PROFILING defined to enable it.  Then
+// every internal lock (those declared through _Shadow_STL_profiled_t,
+// such as the node allocator locks) records
+//
+//   acquisitions   successful acquires, try-acquires included
+//   contentions    acquires that found the lock taken and waited
+//   wait_ns        total time spent waiting in those
+//   max_hold_ns    longest time the lock was held
+//
+// and lock_profile reports them.  Otherwise _Shadow_STL_profiled_t<L>
+// is L itself, and lock_profile reports nothing.
+//
+// The counters are updated by the lock holder only, so they need no
+// atomic read-modify-write operations.
+
+#include <atomic>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "include/stl_config.h"
+#include "include/stl_threads.h"
+
+#ifdef SHADOW_STL_LOCK_PROFILING
+// Initializer naming a profiled lock in reports: use as
+//   _Shadow_STL_profiled_t<L> lock SHADOW_STL_LOCK_NAME("name");
+#define SHADOW_STL_LOCK_NAME(__name) { __name }
+#else
+#define SHADOW_STL_LOCK_NAME(__name)
+#endif
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+struct lock_profile_entry {
+    const char* name;
+    const void* lock;
+    uint64_t acquisitions;
+    uint64_t contentions;
+    uint64_t wait_ns;
+    uint64_t max_hold_ns;
+};
+
+// Common part of all profiled locks: the counters, and the link in the
+// list of locks taken at least once.
+struct _Lock_profile_base {
+    const char* _M_name;
+    std::atomic<uint64_t> _M_acquisitions;
+    std::atomic<uint64_t> _M_contentions;
+    std::atomic<uint64_t> _M_wait_ns;
+    std::atomic<uint64_t> _M_max_hold_ns;
+    uint64_t _M_acquired_at;
+    std::atomic<bool> _M_registered;
+    _Lock_profile_base* _M_next_profiled;
+
+    constexpr _Lock_profile_base(const char* name)
+        : _M_name(name), _M_acquisitions(0), _M_contentions(0), _M_wait_ns(0),
+          _M_max_hold_ns(0), _M_acquired_at(0), _M_registered(false),
+          _M_next_profiled(nullptr) {}
+
+    static uint64_t _S_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+    }
+    static void _S_bump(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    static pthread_mutex_t* _S_registry_mutex() {
+        static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+        return &mutex;
+    }
+    static _Lock_profile_base*& _S_registry() {
+        static _Lock_profile_base* head = nullptr;
+        return head;
+    }
+
+    // Called by the holder right after acquiring.  waited_ns is 0
+    // unless the acquire was contended.
+    void _M_acquired(bool contended, uint64_t waited_ns, uint64_t now) {
+        if (!_M_registered.load(std::memory_order_relaxed)) {
+            pthread_mutex_lock(_S_registry_mutex());
+            _M_next_profiled = _S_registry();
+            _S_registry() = this;
+            pthread_mutex_unlock(_S_registry_mutex());
+            _M_registered.store(true, std::memory_order_relaxed);
+        }
+        _S_bump(_M_acquisitions, 1);
+        if (contended) {
+            _S_bump(_M_contentions, 1);
+            _S_bump(_M_wait_ns, waited_ns);
+        }
+        _M_acquired_at = now;
+    }
+    // Called by the holder right before releasing.
+    void _M_releasing() {
+        uint64_t held = _S_now() - _M_acquired_at;
+        if (held > _M_max_hold_ns.load(std::memory_order_relaxed)) {
+            _M_max_hold_ns.store(held, std::memory_order_relaxed);
+        }
+    }
+};
+
+// _Lock with profiling.  Waiting is only timed when an initial
+// try-acquire fails.
+template <typename _Lock>
+struct _Shadow_STL_profiled_lock : public _Lock, public _Lock_profile_base {
+    constexpr _Shadow_STL_profiled_lock(const char* name = "lock") : _Lock(), _Lock_profile_base(name) {}
+
+    bool _M_try_acquire_lock() {
+        if (!_Lock::_M_try_acquire_lock()) return false;
+        _M_acquired(false, 0, _S_now());
+        return true;
+    }
+    void _M_acquire_lock() {
+        if (_Lock::_M_try_acquire_lock()) {
+            _M_acquired(false, 0, _S_now());
+            return;
+        }
+        uint64_t start = _S_now();
+        _Lock::_M_acquire_lock();
+        uint64_t now = _S_now();
+        _M_acquired(true, now - start, now);
+    }
+    void _M_release_lock() {
+        _M_releasing();
+        _Lock::_M_release_lock();
+    }
+};
+
+#ifdef SHADOW_STL_LOCK_PROFILING
+template <typename _Lock>
+using _Shadow_STL_profiled_t = _Shadow_STL_profiled_lock<_Lock>;
+#else
+template <typename _Lock>
+using _Shadow_STL_profiled_t = _Lock;
+#endif
+
+// Report over every profiled lock taken so far.
+struct lock_profile {
+    static bool enabled() {
+#ifdef SHADOW_STL_LOCK_PROFILING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Stores up to max entries in out and answers the number of
+    // profiled locks, which may be larger.
+    static size_t collect(lock_profile_entry* out, size_t max) {
+        size_t count = 0;
+        pthread_mutex_lock(_Lock_profile_base::_S_registry_mutex());
+        for (_Lock_profile_base* p = _Lock_profile_base::_S_registry(); p != nullptr;
+             p = p->_M_next_profiled, ++count) {
+            if (count < max) {
+                lock_profile_entry& e = out[count];
+                e.name = p->_M_name;
+                e.lock = p;
+                e.acquisitions = p->_M_acquisitions.load(std::memory_order_relaxed);
+                e.contentions = p->_M_contentions.load(std::memory_order_relaxed);
+                e.wait_ns = p->_M_wait_ns.load(std::memory_order_relaxed);
+                e.max_hold_ns = p->_M_max_hold_ns.load(std::memory_order_relaxed);
+            }
+        }
+        pthread_mutex_unlock(_Lock_profile_base::_S_registry_mutex());
+        return count;
+    }
+
+    // Writes the report as a JSON object.
+    static void dump(FILE* out) {
+        fprintf(out, "{\"profiling_enabled\": %s, \"locks\": [", enabled() ? "true" : "false");
+        pthread_mutex_lock(_Lock_profile_base::_S_registry_mutex());
+        for (_Lock_profile_base* p = _Lock_profile_base::_S_registry(); p != nullptr;
+             p = p->_M_next_profiled) {
+            fprintf(out, "{\"name\": \"%s\", \"lock\": \"%p\", \"acquisitions\": %llu, "
+                         "\"contentions\": %llu, \"wait_ns\": %llu, \"max_hold_ns\": %llu}%s",
+                    p->_M_name, (void*)p,
+                    (unsigned long long)p->_M_acquisitions.load(std::memory_order_relaxed),
+                    (unsigned long long)p->_M_contentions.load(std::memory_order_relaxed),
+                    (unsigned long long)p->_M_wait_ns.load(std::memory_order_relaxed),
+                    (unsigned long long)p->_M_max_hold_ns.load(std::memory_order_relaxed),
+                    p->_M_next_profiled != nullptr ? ", " : "");
+        }
+        pthread_mutex_unlock(_Lock_profile_base::_S_registry_mutex());
+        fprintf(out, "]}");
+    }
+
+    // Zeroes the counters.  Meant for quiescent moments: counts of
+    // locks held meanwhile may be lost.
+    static void reset() {
+        pthread_mutex_lock(_Lock_profile_base::_S_registry_mutex());
+        for (_Lock_profile_base* p = _Lock_profile_base::_S_registry(); p != nullptr;
+             p = p->_M_next_profiled) {
+            p->_M_acquisitions.store(0, std::memory_order_relaxed);
+            p->_M_contentions.store(0, std::memory_order_relaxed);
+            p->_M_wait_ns.store(0, std::memory_order_relaxed);
+            p->_M_max_hold_ns.store(0, std::memory_order_relaxed);
+        }
+        pthread_mutex_unlock(_Lock_profile_base::_S_registry_mutex());
+    }
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_LOCK_PROFILE_H
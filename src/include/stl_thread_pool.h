@@ -0,0 +1,188 @@
+#ifndef SHADOW_STL_THREAD_POOL_H
+#define SHADOW_STL_THREAD_POOL_H
+
+// A small pool of worker threads for the parallel algorithms (see
+// stl_parallel_sort.h).  It runs one job at a time: a count of calls to
+// a function, which the workers and the calling thread claim one index
+// at a time.  A job submitted while another is running, including one
+// submitted from inside a job, runs on the calling thread alone, so the
+// pool never deadlocks on itself.
+//
+// The default pool has SHADOW_STL_POOL_THREADS workers, or one per CPU
+// but the caller's when that is 0.  It starts with the first parallel
+// job, and its workers sleep on a condition variable between jobs.
+
+#include <atomic>
+#include <exception>
+#include <pthread.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "include/stl_config.h"
+
+#ifndef SHADOW_STL_POOL_THREADS
+#define SHADOW_STL_POOL_THREADS 0
+#endif
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+class _Shadow_STL_thread_pool {
+public:
+    using _Task = void (*)(void* ctx, size_t i);
+
+    explicit _Shadow_STL_thread_pool(size_t workers) {
+        pthread_mutex_init(&_M_mutex, nullptr);
+        pthread_cond_init(&_M_wake, nullptr);
+        pthread_cond_init(&_M_idle, nullptr);
+        _M_threads = workers ? new pthread_t[workers] : nullptr;
+        // A pool that could not start all its workers runs with fewer.
+        while (_M_workers < workers &&
+               pthread_create(&_M_threads[_M_workers], nullptr, _S_loop, this) == 0) {
+            ++_M_workers;
+        }
+    }
+
+    ~_Shadow_STL_thread_pool() {
+        pthread_mutex_lock(&_M_mutex);
+        _M_stop = true;
+        pthread_cond_broadcast(&_M_wake);
+        pthread_mutex_unlock(&_M_mutex);
+        for (size_t i = 0; i < _M_workers; ++i) {
+            pthread_join(_M_threads[i], nullptr);
+        }
+        delete[] _M_threads;
+        pthread_cond_destroy(&_M_idle);
+        pthread_cond_destroy(&_M_wake);
+        pthread_mutex_destroy(&_M_mutex);
+    }
+
+    static _Shadow_STL_thread_pool& _S_default() {
+        static _Shadow_STL_thread_pool pool(_S_default_workers());
+        return pool;
+    }
+
+    // The threads a job runs on: the workers and the caller.
+    size_t _M_concurrency() const { return _M_workers + 1; }
+
+    // Calls task(ctx, i) for every i in [0, n), and returns when all the
+    // calls have.  If calls throw, the first exception is rethrown here,
+    // once every call has returned.
+    void _M_run(size_t n, _Task task, void* ctx) {
+        if (n == 0) {
+            return;
+        }
+        if (_M_workers == 0 || n == 1 || _M_busy.exchange(true, std::memory_order_acquire)) {
+            for (size_t i = 0; i < n; ++i) {
+                task(ctx, i);
+            }
+            return;
+        }
+        pthread_mutex_lock(&_M_mutex);
+        _M_task = task;
+        _M_ctx = ctx;
+        _M_count = n;
+        _M_next.store(0, std::memory_order_relaxed);
+        _M_active = _M_workers;
+        ++_M_generation;
+        pthread_cond_broadcast(&_M_wake);
+        pthread_mutex_unlock(&_M_mutex);
+
+        _M_work();
+
+        pthread_mutex_lock(&_M_mutex);
+        while (_M_active != 0) {
+            pthread_cond_wait(&_M_idle, &_M_mutex);
+        }
+        std::exception_ptr error = _M_error;
+        _M_error = nullptr;
+        pthread_mutex_unlock(&_M_mutex);
+        _M_busy.store(false, std::memory_order_release);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // _M_run with a callable f(i).
+    template <typename F>
+    void _M_for_each(size_t n, F& f) {
+        _M_run(n, [](void* ctx, size_t i) { (*(F*)ctx)(i); }, &f);
+    }
+
+private:
+    static size_t _S_default_workers() {
+        if (SHADOW_STL_POOL_THREADS > 0) {
+            return SHADOW_STL_POOL_THREADS;
+        }
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        return cpus > 1 ? cpus - 1 : 0;
+    }
+
+    // Claims and runs indices of the current job until none are left.
+    void _M_work() {
+        for (;;) {
+            size_t i = _M_next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= _M_count) {
+                return;
+            }
+            try {
+                _M_task(_M_ctx, i);
+            } catch (...) {
+                pthread_mutex_lock(&_M_mutex);
+                if (!_M_error) {
+                    _M_error = std::current_exception();
+                }
+                pthread_mutex_unlock(&_M_mutex);
+            }
+        }
+    }
+
+    static void* _S_loop(void* arg) {
+        _Shadow_STL_thread_pool* pool = (_Shadow_STL_thread_pool*)arg;
+        unsigned long seen = 0;
+        pthread_mutex_lock(&pool->_M_mutex);
+        for (;;) {
+            while (!pool->_M_stop && pool->_M_generation == seen) {
+                pthread_cond_wait(&pool->_M_wake, &pool->_M_mutex);
+            }
+            if (pool->_M_stop) {
+                break;
+            }
+            seen = pool->_M_generation;
+            pthread_mutex_unlock(&pool->_M_mutex);
+            pool->_M_work();
+            pthread_mutex_lock(&pool->_M_mutex);
+            if (--pool->_M_active == 0) {
+                pthread_cond_signal(&pool->_M_idle);
+            }
+        }
+        pthread_mutex_unlock(&pool->_M_mutex);
+        return nullptr;
+    }
+
+    pthread_mutex_t _M_mutex;
+    pthread_cond_t _M_wake;  // a job was posted, or the pool stops
+    pthread_cond_t _M_idle;  // the last worker left the job
+    pthread_t* _M_threads;
+    size_t _M_workers = 0;
+    bool _M_stop = false;
+
+    // A caller owns the pool.
+    std::atomic<bool> _M_busy{false};
+
+    // The current job; written under _M_mutex before the workers wake.
+    _Task _M_task = nullptr;
+    void* _M_ctx = nullptr;
+    size_t _M_count = 0;
+    std::atomic<size_t> _M_next{0};
+    size_t _M_active = 0;  // workers not done with it yet
+    unsigned long _M_generation = 0;
+    std::exception_ptr _M_error;
+
+    // Non-copyable
+    void operator=(const _Shadow_STL_thread_pool&);
+    _Shadow_STL_thread_pool(const _Shadow_STL_thread_pool&);
+};
+
+SHADOW_STL_END_NAMESPACE
+
+#endif // SHADOW_STL_THREAD_POOL_H
@@ -1,8 +1,15 @@
-#ifndef SHADOW_STL_THREADS
-#define SHADOW_STL_THREADS
+#ifndef SHADOW_STL_THREADS_H
+#define SHADOW_STL_THREADS_H
 
 // Only support Linux
+#include <assert.h>
+#include <limits.h>
+#include <atomic>
+#include <linux/futex.h>
 #include <pthread.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 #include "include/stl_config.h"
 
@@ -12,53 +19,37 @@ SHADOW_STL_BEGIN_NAMESPACE
 // _M_ref_count, and member functions _M_incr and _M_decr, which perform
 // atomic preincrement/predecrement.  The constructor initializes 
 // _M_ref_count.
+//
+// The count is a lone 4-byte atomic, so the increments of different
+// objects never contend on anything but their own cache line.
+// Incrementing needs no ordering: whoever increments already holds a
+// reference.  Decrementing is acq_rel, so that when _M_decr returns 0
+// every access made through the other references happens before
+// whatever the caller does next, typically destroying the object.
 
 class _Refcount_Base {
 public:
-    typedef size_t RC_t;
-    volatile RC_t _M_ref_count;
-    pthread_mutex_t _M_ref_count_lock;
+    typedef uint32_t RC_t;
+    std::atomic<RC_t> _M_ref_count;
     // Constructor
-    _Refcount_Base(RC_t n) : _M_ref_count(n) {
-        pthread_mutex_init(&_M_ref_count_lock, nullptr);
-    }
+    _Refcount_Base(RC_t n) : _M_ref_count(n) {}
 
     // Atomic increment/decrement
     void _M_incr() { 
-        pthread_mutex_lock(&_M_ref_count_lock);
-        ++_M_ref_count;
-        pthread_mutex_unlock(&_M_ref_count_lock);
+        _M_ref_count.fetch_add(1, std::memory_order_relaxed);
     }
     RC_t _M_decr() { 
-        pthread_mutex_lock(&_M_ref_count_lock);
-        volatile RC_t tmp = --_M_ref_count;
-        pthread_mutex_unlock(&_M_ref_count_lock);
-        return tmp;
+        return _M_ref_count.fetch_sub(1, std::memory_order_acq_rel) - 1;
     }
 };
 
 // Atomic swap on unsigned long
 // This is guaranteed to behave as though it were atomic only if all
-// possibly concurrent updates use _Atomic_swap.
-// In some cases the operation is emulated with a lock.
-template<int dummy>
-struct _Swap_lock_struct {
-    static pthread_mutex_t _S_swap_lock;
-};
-
-// TODO: why dummy
-template<int dummy>
-pthread_mutex_t _Swap_lock_struct<dummy>::_S_swap_lock = PTHREAD_MUTEX_INITIALIZER;
-
-// This should be portable, but performance is expected
-// to be quite awful.  This really needs platform specific
-// code.
+// possibly concurrent updates use _Atomic_swap, or are atomic
+// themselves.  Stores made before the swap by the thread that wrote the
+// old value are visible after it (acq_rel).
 inline unsigned long _Atomic_swap(unsigned long *p, unsigned long q) {
-    pthread_mutex_lock(&_Swap_lock_struct<0>::_S_swap_lock);
-    unsigned long tmp = *p;
-    *p = q;
-    pthread_mutex_unlock(&_Swap_lock_struct<0>::_S_swap_lock);
-    return tmp;
+    return __atomic_exchange_n(p, q, __ATOMIC_ACQ_REL);
 }
 
 // Locking class.  Note that this class *does not have a constructor*.
@@ -85,6 +76,9 @@ struct _Shadow_STL_mutex_lock {
     void _M_acquire_lock() { 
         pthread_mutex_lock(&_M_lock);
     }
+    bool _M_try_acquire_lock() {
+        return pthread_mutex_trylock(&_M_lock) == 0;
+    }
     void _M_release_lock() { 
         pthread_mutex_unlock(&_M_lock);
     }
@@ -92,15 +86,238 @@ struct _Shadow_STL_mutex_lock {
 
 #define SHADOW_STL_MUTEX_INITIALIZER = { PTHREAD_MUTEX_INITIALIZER }
 
-// A locking class that uses _STL_mutex_lock.  The constructor takes a
-// reference to an _STL_mutex_lock, and acquires a lock.  The
+// Locks for short critical sections, like the few pointer swaps of the
+// node allocators, where sleeping in the kernel right away costs more
+// than the critical section itself.  They have the interface of
+// _Shadow_STL_mutex_lock and can replace it wherever a lock type is a
+// policy (_Shadow_STL_auto_lock, _default_alloc_template).  All of them
+// are constant-initialized, so they are safe to use in static objects.
+//
+//   _Shadow_STL_adaptive_lock  spins, then parks on a futex
+//   _Shadow_STL_ticket_lock    first come, first served
+//   _Shadow_STL_mcs_lock       first come, first served; every waiter
+//                              spins on its own cache line
+//
+// Waiters poll the lock SHADOW_STL_LOCK_SPINS times, or as many as the
+// template argument says, before they sleep on a futex.
+
+#ifndef SHADOW_STL_LOCK_SPINS
+#define SHADOW_STL_LOCK_SPINS 100
+#endif
+
+// Tells the CPU we are spinning.
+inline void _Shadow_STL_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+struct _Shadow_STL_futex {
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex word must be a plain int");
+
+    // Sleeps while *addr == val.
+    static void _S_wait(std::atomic<int>* addr, int val) {
+        syscall(SYS_futex, (int*)addr, FUTEX_WAIT_PRIVATE, val, nullptr, nullptr, 0);
+    }
+    static void _S_wake(std::atomic<int>* addr, int count) {
+        syscall(SYS_futex, (int*)addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+};
+
+// Spins up to _Spins polls for the lock to become free, then sleeps on
+// a futex until the holder wakes it (Drepper, "Futexes Are Tricky",
+// mutex 2).  Uncontended acquire and release are one atomic operation
+// each, and release only enters the kernel when somebody sleeps.
+template <unsigned _Spins = SHADOW_STL_LOCK_SPINS>
+struct _Shadow_STL_adaptive_lock {
+    // 0: free, 1: held, 2: held and there may be sleepers
+    std::atomic<int> _M_state;
+
+    constexpr _Shadow_STL_adaptive_lock() : _M_state(0) {}
+
+    bool _M_try_acquire_lock() {
+        int expected = 0;
+        return _M_state.compare_exchange_strong(expected, 1, std::memory_order_acquire,
+                                                std::memory_order_relaxed);
+    }
+    void _M_acquire_lock() {
+        if (_M_try_acquire_lock()) return;
+        for (unsigned i = 0; i < _Spins; ++i) {
+            _Shadow_STL_cpu_relax();
+            if (_M_state.load(std::memory_order_relaxed) == 0 && _M_try_acquire_lock()) return;
+        }
+        // Whoever takes the lock from here on takes it as 2, so that its
+        // release wakes the next sleeper.
+        while (_M_state.exchange(2, std::memory_order_acquire) != 0) {
+            _Shadow_STL_futex::_S_wait(&_M_state, 2);
+        }
+    }
+    void _M_release_lock() {
+        if (_M_state.exchange(0, std::memory_order_release) == 2) {
+            _Shadow_STL_futex::_S_wake(&_M_state, 1);
+        }
+    }
+};
+
+// Ticket lock: waiters are served in arrival order, so none starves
+// under heavy contention.  Waiters that run out of polls sleep on
+// _M_serving, and a release wakes them all to check their tickets.
+template <unsigned _Spins = SHADOW_STL_LOCK_SPINS>
+struct _Shadow_STL_ticket_lock {
+    std::atomic<int> _M_next;           // next ticket to hand out
+    std::atomic<int> _M_serving;        // ticket allowed in
+    std::atomic<int> _M_sleepers;
+
+    constexpr _Shadow_STL_ticket_lock() : _M_next(0), _M_serving(0), _M_sleepers(0) {}
+
+    // Tickets wrap around; only their equality matters.
+    bool _M_try_acquire_lock() {
+        int serving = _M_serving.load(std::memory_order_relaxed);
+        int expected = serving;
+        return _M_next.compare_exchange_strong(expected, (int)((unsigned)serving + 1),
+                                               std::memory_order_acquire, std::memory_order_relaxed);
+    }
+    void _M_acquire_lock() {
+        int ticket = _M_next.fetch_add(1, std::memory_order_relaxed);
+        for (unsigned i = 0; i < _Spins; ++i) {
+            if (_M_serving.load(std::memory_order_acquire) == ticket) return;
+            _Shadow_STL_cpu_relax();
+        }
+        // seq_cst against the release: either it sees us sleeping, or we
+        // see its new _M_serving.
+        _M_sleepers.fetch_add(1);
+        for (int serving; (serving = _M_serving.load()) != ticket;) {
+            _Shadow_STL_futex::_S_wait(&_M_serving, serving);
+        }
+        _M_sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+    void _M_release_lock() {
+        // Only the holder writes _M_serving.
+        _M_serving.store((int)((unsigned)_M_serving.load(std::memory_order_relaxed) + 1));
+        if (_M_sleepers.load() != 0) {
+            _Shadow_STL_futex::_S_wake(&_M_serving, INT_MAX);
+        }
+    }
+};
+
+// MCS queue lock (Mellor-Crummey and Scott).  Waiters queue up in
+// arrival order and each one spins, then sleeps, on a word in its own
+// queue node, so a release touches only the cache line of the next
+// waiter and wakes nobody else.  The queue nodes come from a small
+// per-thread array: a thread may hold up to _MAX_HELD MCS locks at a
+// time, released in any order.
+template <unsigned _Spins = SHADOW_STL_LOCK_SPINS>
+struct _Shadow_STL_mcs_lock {
+    // _M_wait: 0 once the lock is handed over, 1 while the owner
+    // spins, 2 while it sleeps.
+    struct alignas(64) _Node {
+        std::atomic<_Node*> _M_next;
+        std::atomic<int> _M_wait;
+    };
+    enum { _MAX_HELD = 8 };
+
+    std::atomic<_Node*> _M_tail;        // last in the queue, null if free
+    _Node* _M_owner;                    // node of the holder, used by it only
+
+    constexpr _Shadow_STL_mcs_lock() : _M_tail(nullptr), _M_owner(nullptr) {}
+
+    bool _M_try_acquire_lock() {
+        _Node* node = _S_get_node();
+        node->_M_next.store(nullptr, std::memory_order_relaxed);
+        _Node* expected = nullptr;
+        if (!_M_tail.compare_exchange_strong(expected, node, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+            _S_put_node(node);
+            return false;
+        }
+        _M_owner = node;
+        return true;
+    }
+    void _M_acquire_lock() {
+        _Node* node = _S_get_node();
+        node->_M_next.store(nullptr, std::memory_order_relaxed);
+        node->_M_wait.store(1, std::memory_order_relaxed);
+        _Node* prev = _M_tail.exchange(node, std::memory_order_acq_rel);
+        if (prev != nullptr) {
+            prev->_M_next.store(node, std::memory_order_release);
+            _S_wait_turn(node);
+        }
+        _M_owner = node;
+    }
+    void _M_release_lock() {
+        _Node* node = _M_owner;
+        _Node* next = node->_M_next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            _Node* expected = node;
+            if (_M_tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                                std::memory_order_relaxed)) {
+                _S_put_node(node);
+                return;
+            }
+            // A waiter swapped itself in but has not linked up yet.
+            while ((next = node->_M_next.load(std::memory_order_acquire)) == nullptr) {
+                _Shadow_STL_cpu_relax();
+            }
+        }
+        if (next->_M_wait.exchange(0, std::memory_order_release) == 2) {
+            _Shadow_STL_futex::_S_wake(&next->_M_wait, 1);
+        }
+        _S_put_node(node);
+    }
+
+private:
+    static void _S_wait_turn(_Node* node) {
+        for (unsigned i = 0; i < _Spins; ++i) {
+            if (node->_M_wait.load(std::memory_order_acquire) == 0) return;
+            _Shadow_STL_cpu_relax();
+        }
+        int expected = 1;
+        if (!node->_M_wait.compare_exchange_strong(expected, 2, std::memory_order_acquire)) {
+            return;     // handed over meanwhile
+        }
+        while (node->_M_wait.load(std::memory_order_acquire) != 0) {
+            _Shadow_STL_futex::_S_wait(&node->_M_wait, 2);
+        }
+    }
+
+    struct _Node_set {
+        _Node _M_nodes[_MAX_HELD];
+        unsigned _M_used;               // bit i: _M_nodes[i] is queued
+    };
+    static _Node_set& _S_nodes() {
+        static thread_local _Node_set nodes;
+        return nodes;
+    }
+    static _Node* _S_get_node() {
+        _Node_set& set = _S_nodes();
+        int i = __builtin_ctz(~set._M_used);
+        assert(i < _MAX_HELD && "too many MCS locks held by one thread");
+        set._M_used |= 1U << i;
+        return &set._M_nodes[i];
+    }
+    static void _S_put_node(_Node* node) {
+        _Node_set& set = _S_nodes();
+        set._M_used &= ~(1U << (node - set._M_nodes));
+    }
+};
+
+// Lock type of the node allocators (see _default_alloc_template).
+#ifndef SHADOW_NODE_ALLOCATOR_MUTEX
+#define SHADOW_NODE_ALLOCATOR_MUTEX _Shadow_STL_adaptive_lock<>
+#endif
+
+// A locking class that uses _STL_mutex_lock, or any of the locks above.
+// The constructor takes a reference to the lock, and acquires it.  The
 // destructor releases the lock.  It's not clear that this is exactly
 // the right functionality.  It will probably change in the future.
+template <typename _Lock = _Shadow_STL_mutex_lock>
 struct _Shadow_STL_auto_lock {
-    _Shadow_STL_mutex_lock& _M_lock;
+    _Lock& _M_lock;
 
     // RAII
-    _Shadow_STL_auto_lock(_Shadow_STL_mutex_lock& _lock) : _M_lock(_lock) { 
+    _Shadow_STL_auto_lock(_Lock& _lock) : _M_lock(_lock) { 
         _M_lock._M_acquire_lock();
     }
     ~_Shadow_STL_auto_lock() { 
@@ -114,4 +331,4 @@ private:
 
 SHADOW_STL_END_NAMESPACE
 
-#endif // SHADOW_STL_THREADS
\ No newline at end of file
+#endif // SHADOW_STL_THREADS_H
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "include/stl_config.h"
 #endif  // SHADOW_STL_CONFIG_H
 
+#include <type_traits>
+
 /*
 This header file provides a framework for allowing compile time dispatch
 based on type attributes. This is useful when writing template code.
@@ -345,4 +347,26 @@ struct _Is_integer<unsigned long long> {
     using _Integral = _true_type;
 };
 
+// _Is_trivially_relocatable<T>::_Relocatable is _true_type if moving a T
+// to new storage and destroying the original amounts to copying its
+// bytes, so that containers may relocate elements with memcpy and skip
+// both the move and the destructor.  That holds for PODs and for
+// trivially copyable types, which are the default, and for many
+// classes that own a resource through a pointer (unique_ptr-like
+// handles, most strings and containers) but are not trivially
+// copyable.  Specialize it for those:
+//
+//   template <>
+//   struct _Is_trivially_relocatable<handle> {
+//       using _Relocatable = _true_type;
+//   };
+//
+// It does not hold for classes holding pointers into themselves.
+template <typename T>
+struct _Is_trivially_relocatable {
+    using _Relocatable = std::conditional_t<std::is_trivially_copyable<T>::value,
+                                            _true_type,
+                                            typename _type_traits<T>::is_POD_type>;
+};
+
 #endif // SHADOW_TYPE_TRAITS_H
\ No newline at end of file
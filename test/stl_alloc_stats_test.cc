@@ -0,0 +1,142 @@
+// Built into its own executable with SHADOW_STL_ALLOC_STATS defined.
+
+#include <new>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_alloc.h"
+#include "container/list.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("pool statistics", "[stl_alloc_stats]") {
+    using Alloc = _default_alloc_template<true, 1>;
+    using Stats = Alloc::stats_type;
+
+    Stats before = Alloc::stats();
+    REQUIRE(before.counters_enabled);
+    REQUIRE(before.heap_size == 0);
+
+    void* ps[100];
+    for (int i = 0; i < 100; ++i) ps[i] = Alloc::allocate(24);
+    void* big = Alloc::allocate(1000);
+    Stats during = Alloc::stats();
+    REQUIRE(during.classes[2].size == 24);
+    REQUIRE(during.classes[2].allocations == 100);
+    REQUIRE(during.classes[2].refills >= 5);
+    REQUIRE(during.large_allocations == 1);
+    REQUIRE(during.chunks == 1);
+    REQUIRE(during.chunk_maps == 1);
+    REQUIRE(during.heap_size > 0);
+    REQUIRE(during.lock_acquisitions >= 100);
+
+    for (int i = 0; i < 100; ++i) Alloc::deallocate(ps[i], 24);
+    Alloc::deallocate(big, 1000);
+    Stats after = Alloc::stats();
+    REQUIRE(after.classes[2].deallocations == 100);
+    REQUIRE(after.classes[2].free_objects >= 100);
+    REQUIRE(after.large_deallocations == 1);
+
+    Alloc::trim();
+    Stats trimmed = Alloc::stats();
+    REQUIRE(trimmed.trims == 1);
+    REQUIRE(trimmed.trimmed_bytes == after.heap_size);
+    REQUIRE(trimmed.classes[2].free_objects == 0);
+}
+
+TEST_CASE("statistics are merged over threads", "[stl_alloc_stats]") {
+    using Alloc = _default_alloc_template<true, 2>;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; ++i) {
+                Alloc::deallocate(Alloc::allocate(8), 8);
+            }
+        });
+    }
+    // Counts of running threads are visible while they run.
+    Alloc::stats();
+    for (auto& th : threads) th.join();
+    // ... and survive their exit.
+    Alloc::stats_type st = Alloc::stats();
+    REQUIRE(st.classes[0].allocations == 8000);
+    REQUIRE(st.classes[0].deallocations == 8000);
+    REQUIRE(st.lock_acquisitions >= 16000);
+    REQUIRE(st.lock_contentions <= st.lock_acquisitions);
+}
+
+static int oom_calls = 0;
+// Gives up right away, without going through SHADOW_THROW_BAD_ALLOC.
+static void fake_oom_handler() {
+    ++oom_calls;
+    throw std::bad_alloc();
+}
+
+TEST_CASE("malloc_alloc statistics", "[stl_alloc_stats]") {
+    using Alloc = _malloc_alloc_template<1>;
+    void* p = Alloc::allocate(100);
+    p = Alloc::reallocate(p, 100, 200);
+    Alloc::deallocate(p, 200);
+    Alloc::stats_type st = Alloc::stats();
+    REQUIRE(st.allocations == 1);
+    REQUIRE(st.reallocations == 1);
+    REQUIRE(st.deallocations == 1);
+    REQUIRE(st.bytes_allocated == 100);
+
+    // A request malloc cannot satisfy goes through the handler.
+    Alloc::__set_malloc_handler(fake_oom_handler);
+    REQUIRE_THROWS_AS(Alloc::allocate(size_t(-1) / 2), std::bad_alloc);
+    Alloc::__set_malloc_handler(nullptr);
+    REQUIRE(oom_calls == 1);
+    REQUIRE(Alloc::stats().oom_handler_calls == 1);
+}
+
+TEST_CASE("statistics as JSON", "[stl_alloc_stats]") {
+    using Alloc = _default_alloc_template<true, 3>;
+    list<int, Alloc> l;
+    for (int i = 0; i < 10; ++i) l.push_back(i);
+
+    char* buf = nullptr;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    Alloc::dump_stats(out);
+    fclose(out);
+    std::string json(buf, len);
+    free(buf);
+    REQUIRE(json.front() == '{');
+    REQUIRE(json.back() == '}');
+    REQUIRE(json.find("\"counters_enabled\": true") != std::string::npos);
+    REQUIRE(json.find("\"classes\": [{\"size\": 8,") != std::string::npos);
+    REQUIRE(json.find("\"lock_wait_ns\": ") != std::string::npos);
+
+    buf = nullptr;
+    out = open_memstream(&buf, &len);
+    malloc_alloc::dump_stats(out);
+    fclose(out);
+    json.assign(buf, len);
+    free(buf);
+    REQUIRE(json.find("\"oom_handler_calls\": ") != std::string::npos);
+}
+
+TEST_CASE("vector grows trivial elements with reallocate", "[stl_alloc_stats]") {
+    using Alloc = _malloc_alloc_template<2>;
+    {
+        vector<int, Alloc> v;
+        for (int i = 0; i < 1000; ++i) v.push_back(i);
+        v.reserve(5000);
+        v.resize(6000, v[999]);
+        REQUIRE(v[999] == 999);
+        REQUIRE(v[5999] == 999);
+    }
+    Alloc::stats_type st = Alloc::stats();
+    // One allocation for the first element, then only reallocations.
+    REQUIRE(st.allocations == 1);
+    REQUIRE(st.reallocations == 12);
+    REQUIRE(st.deallocations == 1);
+}
+
+SHADOW_STL_END_NAMESPACE
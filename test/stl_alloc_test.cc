@@ -1,8 +1,13 @@
+#include <stdio.h>
+#include <string.h>
 #include <thread>
+#include <vector>
+#include <unistd.h>
 
 #include <catch2/catch_test_macros.hpp>
 #include "allocator/stl_alloc.h"
 #include "allocator/stl_unitialized.h"
+#include "container/list.h"
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -13,4 +18,236 @@ TEST_CASE("Allocator", "[stl_alloc]") {
     alloc.deallocate(p, 100);
 }
 
+TEST_CASE("Linear size classes", "[stl_alloc]") {
+    using Classes = _Default_size_classes;
+    static_assert(Classes::_S_nclasses == 16, "classic SGI layout");
+    static_assert(Classes::_S_round_up(1) == 8, "");
+    static_assert(Classes::_S_round_up(128) == 128, "");
+    static_assert(Classes::_S_index(9) == 1, "");
+    static_assert(Classes::_S_index_floor(20) == 1, "");
+    REQUIRE(Classes::_S_class_size(15) == 128);
+}
+
+TEST_CASE("Geometric size classes", "[stl_alloc]") {
+    using Classes = _Geometric_size_classes<16, 4096, 4>;
+    static_assert(Classes::_S_class_size(0) == 16, "");
+    static_assert(Classes::_S_class_size(3) == 64, "");
+    static_assert(Classes::_S_class_size(8) == 160, "");
+    static_assert(Classes::_S_round_up(150) == 160, "");
+    static_assert(Classes::_S_round_up(513) == 640, "");
+    static_assert(Classes::_S_class_size(Classes::_S_nclasses - 1) == 4096, "");
+    // Every request fits its class, and the class below would not.
+    for (size_t n = 1; n <= Classes::_S_max_bytes; ++n) {
+        size_t i = Classes::_S_index(n);
+        REQUIRE(Classes::_S_class_size(i) >= n);
+        REQUIRE((i == 0 || Classes::_S_class_size(i - 1) < n));
+        REQUIRE(Classes::_S_class_size(i) % 16 == 0);
+    }
+    REQUIRE(Classes::_S_index_floor(200) == Classes::_S_index(192));
+}
+
+TEST_CASE("Pool with custom size classes", "[stl_alloc]") {
+    using Alloc = _default_alloc_template<true, 1, _Geometric_size_classes<64, 1024, 4>>;
+    void* ps[100];
+    for (int i = 0; i < 100; ++i) {
+        size_t n = 1 + (i * 37) % 1024;
+        ps[i] = Alloc::allocate(n);
+        REQUIRE((size_t)ps[i] % 64 == 0);
+        memset(ps[i], i, n);
+    }
+    for (int i = 0; i < 100; ++i) {
+        Alloc::deallocate(ps[i], 1 + (i * 37) % 1024);
+    }
+
+    struct Payload { char bytes[300]; };
+    list<Payload, Alloc> l;
+    for (int i = 0; i < 50; ++i) {
+        l.push_back(Payload());
+    }
+    REQUIRE(l.size() == 50);
+}
+
+// Resident set size of the process, in bytes.
+static size_t resident_bytes() {
+    size_t pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f != nullptr) {
+        if (fscanf(f, "%zu %zu", &pages, &resident) != 2) resident = 0;
+        fclose(f);
+    }
+    return resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+TEST_CASE("Pool returns memory to the system", "[stl_alloc]") {
+    using Alloc = _default_alloc_template<true, 2>;
+    const size_t count = 1 << 20;   // 64 MB of 64 byte objects
+    void** ps = (void**)malloc(count * sizeof(void*));
+    for (size_t i = 0; i < count; ++i) {
+        ps[i] = Alloc::allocate(64);
+        memset(ps[i], 1, 64);
+    }
+    // Keep one object alive: its chunk must survive the trim.
+    void* survivor = ps[count / 2];
+    memset(survivor, 0x5a, 64);
+    size_t peak_heap = Alloc::heap_size();
+    size_t peak_rss = resident_bytes();
+    REQUIRE(peak_heap >= count * 64);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (ps[i] != survivor) Alloc::deallocate(ps[i], 64);
+    }
+    free(ps);
+    size_t released = Alloc::trim();
+    REQUIRE(released > peak_heap - peak_heap / 8);
+    REQUIRE(Alloc::heap_size() == peak_heap - released);
+    REQUIRE(resident_bytes() < peak_rss - (32 << 20));
+    for (int i = 0; i < 64; ++i) {
+        REQUIRE(((unsigned char*)survivor)[i] == 0x5a);
+    }
+    // Nothing left to release.
+    REQUIRE(Alloc::trim() == 0);
+
+    // The pool keeps working after a trim.
+    void* p = Alloc::allocate(64);
+    memset(p, 2, 64);
+    Alloc::deallocate(p, 64);
+    Alloc::deallocate(survivor, 64);
+    Alloc::trim();
+    REQUIRE(Alloc::heap_size() == 0);
+}
+
+TEST_CASE("Trim keeps spare chunks", "[stl_alloc]") {
+    using Alloc = _default_alloc_template<true, 3>;
+    list<int, Alloc> l;
+    for (int i = 0; i < 200000; ++i) {
+        l.push_back(i);
+    }
+    l.clear();
+    size_t heap = Alloc::heap_size();
+    // Retaining everything still releases the pages, not the mappings.
+    // The chunk holding the list's header node stays.
+    size_t released = Alloc::trim(heap);
+    REQUIRE(released > 0);
+    REQUIRE(Alloc::heap_size() + released == heap);
+    for (int i = 0; i < 200000; ++i) {
+        l.push_back(i);
+    }
+    REQUIRE(l.size() == 200000);
+    REQUIRE(l.back() == 199999);
+    REQUIRE(Alloc::heap_size() == heap);
+}
+
+TEST_CASE("Periodic trim", "[stl_alloc]") {
+    using Alloc = _default_alloc_template<true, 4>;
+    void* ps[1000];
+    for (int i = 0; i < 1000; ++i) ps[i] = Alloc::allocate(128);
+    for (int i = 0; i < 1000; ++i) Alloc::deallocate(ps[i], 128);
+    REQUIRE(Alloc::heap_size() > 0);
+    REQUIRE(Alloc::start_periodic_trim(1));
+    REQUIRE(!Alloc::start_periodic_trim(1));
+    for (int i = 0; i < 1000 && Alloc::heap_size() != 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Alloc::stop_periodic_trim();
+    REQUIRE(Alloc::heap_size() == 0);
+    REQUIRE(!_default_alloc_template<false, 4>::start_periodic_trim(1));
+}
+
+TEST_CASE("Batch allocation", "[stl_alloc]") {
+    using Alloc = _default_alloc_template<true, 5>;
+    void* ps[1000];
+    void* q = Alloc::allocate(32);
+    Alloc::deallocate(q, 32);
+
+    // Takes the free object first, then carves the rest from the pool.
+    Alloc::allocate_batch(32, ps, 1000);
+    REQUIRE(ps[0] == q);
+    for (int i = 0; i < 1000; ++i) memset(ps[i], i, 32);
+    for (int i = 0; i < 1000; ++i) {
+        for (int j = i + 1; j < 1000 && j < i + 20; ++j) REQUIRE(ps[i] != ps[j]);
+    }
+    Alloc::deallocate_batch(32, ps, 1000);
+    REQUIRE(Alloc::allocate(32) == ps[0]);
+    Alloc::deallocate(ps[0], 32);
+    // The live counts of the chunks are back to zero.
+    Alloc::trim();
+    REQUIRE(Alloc::heap_size() == 0);
+
+    // Large objects go to malloc_alloc one by one.
+    Alloc::allocate_batch(1000, ps, 10);
+    for (int i = 0; i < 10; ++i) memset(ps[i], 0, 1000);
+    Alloc::deallocate_batch(1000, ps, 10);
+
+    // Allocators without batch entry points are looped over.
+    int* ints[10];
+    simple_alloc<int, malloc_alloc>::allocate_batch(ints, 10);
+    for (int i = 0; i < 10; ++i) *ints[i] = i;
+    simple_alloc<int, malloc_alloc>::deallocate_batch(ints, 10);
+    simple_alloc<int, Alloc>::allocate_batch(ints, 10);
+    simple_alloc<int, Alloc>::deallocate_batch(ints, 10);
+}
+
+TEST_CASE("Over-aligned allocation", "[stl_alloc]") {
+    void* p = malloc_alloc::allocate(100, 64);
+    REQUIRE((size_t)p % 64 == 0);
+    malloc_alloc::deallocate(p, 100, 64);
+    p = malloc_alloc::allocate(100, 4096);
+    REQUIRE((size_t)p % 4096 == 0);
+    malloc_alloc::deallocate(p, 100, 4096);
+
+    // Small requests within the pool alignment stay on the free lists;
+    // stricter ones and large ones are aligned by malloc_alloc.
+    using Alloc = _default_alloc_template<true, 6>;
+    p = Alloc::allocate(24, 8);
+    REQUIRE(Alloc::heap_size() > 0);
+    Alloc::deallocate(p, 24, 8);
+    for (size_t align = 16; align <= 256; align *= 2) {
+        p = Alloc::allocate(24, align);
+        REQUIRE((size_t)p % align == 0);
+        Alloc::deallocate(p, 24, align);
+        p = Alloc::allocate(1000, align);
+        REQUIRE((size_t)p % align == 0);
+        Alloc::deallocate(p, 1000, align);
+    }
+
+    struct alignas(64) line { char c[64]; };
+    allocator<line> a;
+    line* lines = a.allocate(3);
+    REQUIRE((size_t)lines % 64 == 0);
+    a.deallocate(lines, 3);
+    line* ls[10];
+    simple_alloc<line, Alloc>::allocate_batch(ls, 10);
+    for (int i = 0; i < 10; ++i) REQUIRE((size_t)ls[i] % 64 == 0);
+    simple_alloc<line, Alloc>::deallocate_batch(ls, 10);
+}
+
+TEST_CASE("Pool with other lock types", "[stl_alloc]") {
+    using Ticket = _default_alloc_template<true, 7, _Default_size_classes, _Shadow_STL_ticket_lock<>>;
+    using Mcs = _default_alloc_template<true, 7, _Default_size_classes, _Shadow_STL_mcs_lock<>>;
+    using Mutex = _default_alloc_template<true, 7, _Default_size_classes, _Shadow_STL_mutex_lock>;
+    list<int, Ticket> l1;
+    list<int, Mcs> l2;
+    list<int, Mutex> l3;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            list<int, Ticket> a;
+            list<int, Mcs> b;
+            for (int i = 0; i < 10000; ++i) {
+                a.push_back(i);
+                b.push_back(i);
+            }
+        });
+    }
+    for (int i = 0; i < 10000; ++i) {
+        l1.push_back(i);
+        l2.push_back(i);
+        l3.push_back(i);
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE(l1.size() == 10000);
+    REQUIRE(l2.back() == 9999);
+    REQUIRE(l3.back() == 9999);
+}
+
 SHADOW_STL_END_NAMESPACE
\ No newline at end of file
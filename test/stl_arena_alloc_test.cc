@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_arena_alloc.h"
+#include "container/list.h"
+#include "container/slist.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("monotonic_arena", "[stl_arena_alloc]") {
+    monotonic_arena arena;
+    REQUIRE(arena.capacity() == 0);
+
+    char* a = (char*)arena.allocate(10, 1);
+    char* b = (char*)arena.allocate(10, 1);
+    REQUIRE(b == a + 10);
+    void* c = arena.allocate(8, 64);
+    REQUIRE((size_t)c % 64 == 0);
+
+    // Larger than a block.
+    void* big = arena.allocate(100000);
+    REQUIRE(big != nullptr);
+    memset(big, 1, 100000);
+    size_t capacity = arena.capacity();
+
+    // reset reuses the blocks in the same order.
+    arena.reset();
+    REQUIRE(arena.allocate(10, 1) == a);
+    REQUIRE(arena.allocate(100000) == big);
+    REQUIRE(arena.capacity() == capacity);
+
+    arena.release();
+    REQUIRE(arena.capacity() == 0);
+    REQUIRE(arena.allocate(10, 1) != nullptr);
+}
+
+TEST_CASE("containers on arena_allocator", "[stl_arena_alloc]") {
+    monotonic_arena arena;
+    {
+        arena_allocator<int> a(arena);
+        list<int, arena_allocator<int>> l(a);
+        slist<int, arena_allocator<int>> sl(a);
+        vector<int, arena_allocator<int>> v(a);
+        for (int i = 0; i < 10000; ++i) {
+            l.push_back(i);
+            sl.push_front(i);
+            v.push_back(i);
+        }
+        REQUIRE(l.size() == 10000);
+        REQUIRE(l.back() == 9999);
+        REQUIRE(sl.front() == 9999);
+        REQUIRE(v[9999] == 9999);
+        REQUIRE(l.get_allocator() == a);
+        REQUIRE(&sl.get_allocator().arena() == &arena);
+
+        // Copies share the arena.
+        list<int, arena_allocator<int>> l2(l);
+        REQUIRE(l2.size() == 10000);
+        REQUIRE(l2.get_allocator() == a);
+
+        l.clear();
+        REQUIRE(l.empty());
+        l.push_back(1);
+        REQUIRE(l.size() == 1);
+    }
+    size_t capacity = arena.capacity();
+    arena.reset();
+    {
+        list<int, arena_allocator<int>> l(arena);
+        for (int i = 0; i < 10000; ++i) l.push_back(i);
+    }
+    REQUIRE(arena.capacity() == capacity);
+}
+
+namespace {
+struct counted {
+    static int live;
+    int value;
+    counted(int v) : value(v) { ++live; }
+    counted(const counted& x) : value(x.value) { ++live; }
+    ~counted() { --live; }
+};
+int counted::live = 0;
+}
+
+TEST_CASE("arena containers destroy their elements", "[stl_arena_alloc]") {
+    monotonic_arena arena;
+    {
+        list<counted, arena_allocator<counted>> l(arena);
+        slist<counted, arena_allocator<counted>> sl(arena);
+        for (int i = 0; i < 100; ++i) {
+            l.push_back(counted(i));
+            sl.push_front(counted(i));
+        }
+        REQUIRE(counted::live == 200);
+        l.clear();
+        REQUIRE(counted::live == 100);
+    }
+    REQUIRE(counted::live == 0);
+}
+
+SHADOW_STL_END_NAMESPACE
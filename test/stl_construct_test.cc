@@ -1,7 +1,11 @@
 #include <thread>
 #include <iostream>
 
+#include <string.h>
+#include <vector>
+
 #include <catch2/catch_test_macros.hpp>
+#include "algorithm/stl_algobase.h"
 #include "allocator/stl_alloc.h"
 #include "allocator/stl_construct.h"
 #include "allocator/stl_unitialized.h"
@@ -69,4 +73,80 @@ TEST_CASE("Unitialized fill", "[stl_unitialized]") {
     alloc.deallocate(p, 1);
 }
 
+namespace {
+struct quad {
+    int a, b, c, d;
+    bool operator==(const quad& x) const { return a == x.a && b == x.b && c == x.c && d == x.d; }
+};
+
+// Fills every range of up to 300 elements at the first 8 offsets of a
+// buffer, which starts at every alignment of the vector stores, and
+// checks the range and the guards around it.
+template <typename E>
+void check_fills(const E& value, const E& guard) {
+    std::vector<E> buf(320);
+    for (size_t offset = 0; offset < 8; ++offset) {
+        for (size_t n = 0; n <= 300; n += (n < 70 ? 1 : 23)) {
+            for (auto& e : buf) e = guard;
+            E* first = &buf[offset];
+            if (n % 2 == 0) {
+                fill(first, first + n, value);
+            } else {
+                REQUIRE(fill_n(first, n, value) == first + n);
+            }
+            for (size_t i = 0; i < buf.size(); ++i) {
+                const bool inside = i >= offset && i < offset + n;
+                REQUIRE(buf[i] == (inside ? value : guard));
+            }
+        }
+    }
+}
+}
+
+TEST_CASE("Vectorized fill", "[stl_algobase]") {
+    check_fills<short>(0x1234, -1);
+    check_fills<int>(0x12345678, -1);
+    check_fills<float>(1.5f, -1.0f);
+    check_fills<double>(2.25, -1.0);
+    check_fills<quad>(quad{1, 2, 3, 4}, quad{-1, -1, -1, -1});
+
+    // Converted values are stored as assignment would.
+    std::vector<long> l(100);
+    fill(&l[0], &l[0] + 100, 7);
+    REQUIRE(l[99] == 7);
+    fill_n(&l[0], 50, 'a');
+    REQUIRE(l[49] == 'a');
+    REQUIRE(l[50] == 7);
+
+    // Large enough for non-temporal stores.
+    std::vector<int> big(SHADOW_STL_FILL_STREAM_BYTES / sizeof(int) + 37);
+    fill(&big[1], &big[0] + big.size(), 9);
+    REQUIRE(big[0] == 0);
+    REQUIRE(big[1] == 9);
+    REQUIRE(big[big.size() / 2] == 9);
+    REQUIRE(big.back() == 9);
+
+#if defined(__x86_64__) || defined(__i386__)
+    // The SSE2 kernel, which CPUs with AVX2 never pick.
+    unsigned char lane[64], out[256];
+    for (int i = 0; i < 64; ++i) lane[i] = (unsigned char)(i % 8);
+    for (size_t offset = 0; offset < 16; offset += 8) {
+        for (size_t bytes = 64; bytes <= 200; bytes += 8) {
+            memset(out, 0xff, sizeof out);
+            _Simd_fill::_S_fill_sse2(out + offset, bytes, lane, 8);
+            for (size_t i = 0; i < sizeof out; ++i) {
+                const bool inside = i >= offset && i < offset + bytes;
+                REQUIRE(out[i] == (inside ? (i - offset) % 8 : 0xff));
+            }
+        }
+    }
+#endif
+
+    quad* p = (quad*)malloc(sizeof(quad) * 100);
+    uninitialized_fill_n(p, 100, quad{5, 6, 7, 8});
+    REQUIRE(p[0] == (quad{5, 6, 7, 8}));
+    REQUIRE(p[99] == (quad{5, 6, 7, 8}));
+    free(p);
+}
+
 SHADOW_STL_END_NAMESPACE
\ No newline at end of file
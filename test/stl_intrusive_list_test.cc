@@ -0,0 +1,108 @@
+#include "container/intrusive_list.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+// A pooled object, queued on a run queue and a timer queue at once.
+struct task {
+  int id;
+  int priority;
+  list_hook run_hook;
+  list_hook timer_hook;
+
+  task(int i = 0, int p = 0) : id(i), priority(p) {}
+};
+
+using run_queue = intrusive_list<task, &task::run_hook>;
+using timer_queue = intrusive_list<task, &task::timer_hook>;
+
+template <typename List> std::vector<int> ids(const List &l) {
+  std::vector<int> v;
+  for (typename List::const_iterator i = l.begin(); i != l.end(); ++i) {
+    v.push_back(i->id);
+  }
+  return v;
+}
+}
+
+TEST_CASE("intrusive_list", "[stl_intrusive_list]") {
+  std::vector<task> pool;
+  for (int i = 0; i < 10; ++i) pool.push_back(task(i, i % 3));
+
+  run_queue run;
+  timer_queue timers;
+  REQUIRE(run.empty());
+  for (task &t : pool) run.push_back(t);
+  for (task &t : pool) {
+    if (t.id % 2 == 0) timers.push_front(t);
+  }
+  REQUIRE(run.size() == 10);
+  REQUIRE(timers.size() == 5);
+  // The list holds the objects themselves.
+  REQUIRE(&run.front() == &pool[0]);
+  REQUIRE(&run.back() == &pool[9]);
+  REQUIRE(&timers.front() == &pool[8]);
+  REQUIRE(ids(timers) == std::vector<int>({8, 6, 4, 2, 0}));
+
+  // Leaving one queue keeps the other.
+  run.erase(run.iterator_to(pool[4]));
+  REQUIRE(!pool[4].run_hook.is_linked());
+  REQUIRE(pool[4].timer_hook.is_linked());
+  REQUIRE(run.size() == 9);
+  REQUIRE(ids(timers) == std::vector<int>({8, 6, 4, 2, 0}));
+
+  run.pop_front();
+  run.pop_back();
+  REQUIRE(ids(run) == std::vector<int>({1, 2, 3, 5, 6, 7, 8}));
+  std::vector<int> backwards;
+  for (run_queue::reverse_iterator i = run.rbegin(); i != run.rend(); ++i) {
+    backwards.push_back(i->id);
+  }
+  REQUIRE(backwards == std::vector<int>({8, 7, 6, 5, 3, 2, 1}));
+
+  run_queue other;
+  other.splice(other.end(), run, run.iterator_to(pool[5]), run.end());
+  REQUIRE(ids(run) == std::vector<int>({1, 2, 3}));
+  REQUIRE(ids(other) == std::vector<int>({5, 6, 7, 8}));
+  REQUIRE(other.size() == 4);
+  run.splice(run.begin(), other, other.iterator_to(pool[7]));
+  run.splice(run.end(), other);
+  REQUIRE(ids(run) == std::vector<int>({7, 1, 2, 3, 5, 6, 8}));
+  REQUIRE(other.empty());
+
+  run.reverse();
+  REQUIRE(ids(run) == std::vector<int>({8, 6, 5, 3, 2, 1, 7}));
+
+  // Stable, by priority.
+  run.sort([](const task &a, const task &b) { return a.priority < b.priority; });
+  REQUIRE(ids(run) == std::vector<int>({6, 3, 1, 7, 8, 5, 2}));
+  REQUIRE(run.size() == 7);
+
+  run.remove_if([](const task &t) { return t.priority == 1; });
+  REQUIRE(ids(run) == std::vector<int>({6, 3, 8, 5, 2}));
+  REQUIRE(!pool[1].run_hook.is_linked());
+
+  // Moving a list moves the links to its new sentinel.
+  run_queue moved(std::move(run));
+  REQUIRE(run.empty());
+  REQUIRE(ids(moved) == std::vector<int>({6, 3, 8, 5, 2}));
+  moved.push_back(pool[0]);
+  swap(moved, other);
+  REQUIRE(moved.empty());
+  REQUIRE(ids(other) == std::vector<int>({6, 3, 8, 5, 2, 0}));
+
+  // A copy of an object is in no list.
+  task copy = pool[6];
+  REQUIRE(!copy.run_hook.is_linked());
+
+  other.clear();
+  timers.clear();
+  for (task &t : pool) {
+    REQUIRE(!t.run_hook.is_linked());
+    REQUIRE(!t.timer_hook.is_linked());
+  }
+}
+
+SHADOW_STL_END_NAMESPACE
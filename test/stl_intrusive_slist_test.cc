@@ -0,0 +1,78 @@
+#include "container/intrusive_slist.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+// A pooled buffer, on a free list and a dirty list at once.
+struct buffer {
+  int id;
+  slist_hook free_hook;
+  slist_hook dirty_hook;
+
+  buffer(int i = 0) : id(i) {}
+};
+
+using free_list = intrusive_slist<buffer, &buffer::free_hook>;
+using dirty_list = intrusive_slist<buffer, &buffer::dirty_hook>;
+
+template <typename List> std::vector<int> ids(const List &l) {
+  std::vector<int> v;
+  for (typename List::const_iterator i = l.begin(); i != l.end(); ++i) {
+    v.push_back(i->id);
+  }
+  return v;
+}
+}
+
+TEST_CASE("intrusive_slist", "[stl_intrusive_slist]") {
+  std::vector<buffer> pool;
+  for (int i = 0; i < 8; ++i) pool.push_back(buffer(i));
+
+  free_list free;
+  dirty_list dirty;
+  REQUIRE(free.empty());
+  for (buffer &b : pool) free.push_front(b);
+  dirty.push_front(pool[3]);
+  dirty.insert_after(dirty.begin(), pool[5]);
+  REQUIRE(free.size() == 8);
+  REQUIRE(&free.front() == &pool[7]);
+  REQUIRE(ids(free) == std::vector<int>({7, 6, 5, 4, 3, 2, 1, 0}));
+  REQUIRE(ids(dirty) == std::vector<int>({3, 5}));
+
+  free.pop_front();
+  free.erase_after(free.previous(free.iterator_to(pool[3])));
+  REQUIRE(ids(free) == std::vector<int>({6, 5, 4, 2, 1, 0}));
+  REQUIRE(ids(dirty) == std::vector<int>({3, 5}));
+
+  free.reverse();
+  REQUIRE(ids(free) == std::vector<int>({0, 1, 2, 4, 5, 6}));
+
+  // (0, 4] to the front of another list, then one object back.
+  free_list other;
+  other.splice_after(other.before_begin(), free.iterator_to(pool[0]),
+                     free.iterator_to(pool[4]));
+  REQUIRE(ids(free) == std::vector<int>({0, 5, 6}));
+  REQUIRE(ids(other) == std::vector<int>({1, 2, 4}));
+  free.splice_after(free.before_begin(), other.iterator_to(pool[1]));
+  REQUIRE(ids(free) == std::vector<int>({2, 0, 5, 6}));
+  free.splice_after(free.iterator_to(pool[6]), other);
+  REQUIRE(ids(free) == std::vector<int>({2, 0, 5, 6, 1, 4}));
+  REQUIRE(other.empty());
+
+  free.remove_if([](const buffer &b) { return b.id % 2 == 1; });
+  REQUIRE(ids(free) == std::vector<int>({2, 0, 6, 4}));
+
+  free.erase_after(free.iterator_to(pool[0]), free.end());
+  REQUIRE(ids(free) == std::vector<int>({2, 0}));
+
+  free_list moved(std::move(free));
+  REQUIRE(free.empty());
+  swap(moved, free);
+  REQUIRE(moved.empty());
+  REQUIRE(ids(free) == std::vector<int>({2, 0}));
+  REQUIRE(ids(dirty) == std::vector<int>({3, 5}));
+}
+
+SHADOW_STL_END_NAMESPACE
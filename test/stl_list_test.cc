@@ -1,5 +1,7 @@
 #include "container/list.h"
+#include "iterator/iterator.h"
 #include <catch2/catch_test_macros.hpp>
+#include <sstream>
 
 SHADOW_STL_BEGIN_NAMESPACE
 
@@ -23,4 +25,236 @@ TEST_CASE("list", "[stl_list]") {
   REQUIRE(l.back() == 2);
 }
 
+TEST_CASE("list bulk insert", "[stl_list]") {
+  list<int> l(1000, 7);
+  REQUIRE(l.size() == 1000);
+  REQUIRE(l.front() == 7);
+  REQUIRE(l.back() == 7);
+
+  int a[200];
+  for (int i = 0; i < 200; ++i) a[i] = i;
+  list<int>::iterator pos = l.begin();
+  ++pos;
+  l.insert(pos, a, a + 200);
+  REQUIRE(l.size() == 1200);
+  list<int>::iterator it = l.begin();
+  REQUIRE(*it++ == 7);
+  for (int i = 0; i < 200; ++i) REQUIRE(*it++ == i);
+  REQUIRE(*it == 7);
+
+  list<int> copy(l);
+  REQUIRE(copy.size() == 1200);
+  REQUIRE(copy == l);
+  // Integers are a count and a value.
+  list<int> filled(3, 5);
+  REQUIRE(filled.size() == 3);
+  REQUIRE(filled.back() == 5);
+}
+
+namespace {
+struct throwing {
+  static int live;
+  static int countdown;
+  int value;
+  throwing(int v) : value(v) { ++live; }
+  throwing(const throwing &x) : value(x.value) {
+    if (--countdown == 0) throw 1;
+    ++live;
+  }
+  ~throwing() { --live; }
+};
+int throwing::live = 0;
+int throwing::countdown = 0;
+} // namespace
+
+TEST_CASE("list bulk insert keeps the inserted prefix", "[stl_list]") {
+  {
+    list<throwing> l;
+    throwing::countdown = 100;
+    REQUIRE_THROWS(l.insert(l.end(), 200, throwing(1)));
+    REQUIRE(l.size() == 99);
+    REQUIRE(throwing::live == 99);
+  }
+  REQUIRE(throwing::live == 0);
+}
+
+TEST_CASE("list of over-aligned elements", "[stl_list]") {
+  struct alignas(64) padded {
+    int value;
+  };
+  list<padded> l;
+  for (int i = 0; i < 100; ++i) l.push_back(padded{i});
+  for (list<padded>::iterator it = l.begin(); it != l.end(); ++it) {
+    REQUIRE((size_t)&*it % 64 == 0);
+  }
+  list<padded> copy(l);
+  REQUIRE((size_t)&copy.back() % 64 == 0);
+  REQUIRE(copy.back().value == 99);
+}
+
+namespace {
+// size() against a walk over the nodes.
+template <typename L> size_t counted(const L &l) {
+  size_t n = 0;
+  for (typename L::const_iterator it = l.begin(); it != l.end(); ++it) ++n;
+  REQUIRE(l.size() == n);
+  REQUIRE(l.empty() == (n == 0));
+  return n;
+}
+} // namespace
+
+TEST_CASE("list size is kept by every mutating operation", "[stl_list]") {
+  int a[] = {5, 3, 9, 1, 7};
+  list<int> l(a, a + 5);
+  REQUIRE(counted(l) == 5);
+  REQUIRE(counted(list<int>(4, 2)) == 4);
+  REQUIRE(counted(list<int>(3)) == 3);
+  std::istringstream in("1 2 3");
+  list<int> parsed((istream_iterator<int>(in)), istream_iterator<int>());
+  REQUIRE(counted(parsed) == 3);
+
+  l.push_back(4);
+  l.push_front(6);
+  l.push_back();
+  l.push_front();
+  REQUIRE(counted(l) == 9);
+  l.pop_back();
+  l.pop_front();
+  REQUIRE(counted(l) == 7);
+
+  l.insert(l.begin(), 8);
+  l.insert(l.begin());
+  l.insert(l.end(), 3, 0);
+  l.insert(l.end(), a, a + 5);
+  std::istringstream more("4 5");
+  l.insert(l.begin(), istream_iterator<int>(more), istream_iterator<int>());
+  REQUIRE(counted(l) == 19);
+  l.erase(l.begin());
+  list<int>::iterator mid = l.begin();
+  advance(mid, 5);
+  l.erase(l.begin(), mid);
+  REQUIRE(counted(l) == 13);
+
+  l.resize(20);
+  REQUIRE(counted(l) == 20);
+  l.resize(15, 1);
+  REQUIRE(counted(l) == 15);
+  l.resize(3);
+  REQUIRE(counted(l) == 3);
+  l.resize(0);
+  REQUIRE(counted(l) == 0);
+
+  l.assign(6, 1);
+  REQUIRE(counted(l) == 6);
+  l.assign(a, a + 2);
+  REQUIRE(counted(l) == 2);
+  l.assign(a, a + 5);
+  REQUIRE(counted(l) == 5);
+  list<int> m(10, 1);
+  l = m;
+  REQUIRE(counted(l) == 10);
+  m = list<int>(a, a + 3);
+  REQUIRE(counted(m) == 3);
+  l.swap(m);
+  REQUIRE(counted(l) == 3);
+  REQUIRE(counted(m) == 10);
+  swap(l, m);
+  REQUIRE(counted(l) == 10);
+  REQUIRE(counted(m) == 3);
+
+  // Whole-list, single-node and range splices, from another list and
+  // within the same one.
+  l.splice(l.begin(), m);
+  REQUIRE(counted(l) == 13);
+  REQUIRE(counted(m) == 0);
+  m.splice(m.end(), l, l.begin());
+  REQUIRE(counted(l) == 12);
+  REQUIRE(counted(m) == 1);
+  l.splice(l.begin(), l, --l.end());
+  REQUIRE(counted(l) == 12);
+  mid = l.begin();
+  advance(mid, 4);
+  m.splice(m.begin(), l, l.begin(), mid);
+  REQUIRE(counted(l) == 8);
+  REQUIRE(counted(m) == 5);
+  l.splice(l.end(), l, l.begin(), ++l.begin());
+  l.splice(l.end(), m, m.begin(), m.begin());
+  REQUIRE(counted(l) == 8);
+  REQUIRE(counted(m) == 5);
+
+  l.remove(1);
+  REQUIRE(counted(l) == 0);
+  l.assign(a, a + 5);
+  l.remove_if([](int x) { return x > 6; });
+  REQUIRE(counted(l) == 3);
+  l.insert(l.end(), 3, 3);
+  l.unique();
+  REQUIRE(counted(l) == 4);
+  l.insert(l.begin(), 2, 5);
+  l.unique([](int x, int y) { return x == y; });
+  REQUIRE(counted(l) == 4);
+
+  l.sort();
+  m.assign(a, a + 5);
+  m.sort();
+  l.merge(m);
+  REQUIRE(counted(l) == 9);
+  REQUIRE(counted(m) == 0);
+  l.merge(l);
+  REQUIRE(counted(l) == 9);
+  l.reverse();
+  REQUIRE(counted(l) == 9);
+  m.assign(a, a + 5);
+  m.sort([](int x, int y) { return x > y; });
+  l.merge(m, [](int x, int y) { return x > y; });
+  REQUIRE(counted(l) == 14);
+  REQUIRE(counted(m) == 0);
+  REQUIRE(l.front() == 9);
+  REQUIRE(l.back() == 1);
+
+  l.clear();
+  REQUIRE(counted(l) == 0);
+}
+
+namespace {
+struct keyed {
+  int key;
+  int order;
+};
+}
+
+TEST_CASE("list sort is stable", "[stl_list]") {
+  list<keyed> l;
+  for (int i = 0; i < 5000; ++i) l.push_front(keyed{(i * 7919) % 97, -i});
+  l.sort([](const keyed &a, const keyed &b) { return a.key < b.key; });
+  REQUIRE(l.size() == 5000);
+  list<keyed>::iterator prev = l.begin(), i = prev;
+  for (++i; i != l.end(); prev = i, ++i) {
+    REQUIRE(prev->key <= i->key);
+    if (prev->key == i->key) REQUIRE(prev->order < i->order);
+  }
+
+  // A comparison that throws leaves the list as it was.
+  list<int> m;
+  for (int k = 0; k < 100; ++k) m.push_front(k);
+  int calls = 0;
+  bool thrown = false;
+  try {
+    m.sort([&calls](int x, int y) {
+      if (++calls == 50) throw 1;
+      return x < y;
+    });
+  } catch (int) {
+    thrown = true;
+  }
+  REQUIRE(thrown);
+  int expect = 99;
+  for (list<int>::iterator j = m.begin(); j != m.end(); ++j) REQUIRE(*j == expect--);
+  REQUIRE(expect == -1);
+
+  m.sort();
+  expect = 0;
+  for (list<int>::iterator j = m.begin(); j != m.end(); ++j) REQUIRE(*j == expect++);
+}
+
 SHADOW_STL_END_NAMESPACE
\ No newline at end of file
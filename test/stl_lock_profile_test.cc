@@ -0,0 +1,106 @@
+// Built into its own executable with SHADOW_STL_LOCK_PROFILING defined.
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_alloc.h"
+#include "allocator/stl_lockfree_alloc.h"
+#include "include/stl_lock_profile.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// The entry of the given lock, or one with a null name.
+static lock_profile_entry profile_of(const void* lock) {
+    lock_profile_entry entries[64];
+    size_t n = lock_profile::collect(entries, 64);
+    for (size_t i = 0; i < n && i < 64; ++i) {
+        if (entries[i].lock == lock) return entries[i];
+    }
+    return lock_profile_entry{nullptr, nullptr, 0, 0, 0, 0};
+}
+
+TEST_CASE("profiled lock", "[stl_lock_profile]") {
+    REQUIRE(lock_profile::enabled());
+    static _Shadow_STL_profiled_t<_Shadow_STL_adaptive_lock<>> lock SHADOW_STL_LOCK_NAME("test lock");
+    const void* id = static_cast<_Lock_profile_base*>(&lock);
+
+    // Not taken yet, so not reported yet.
+    REQUIRE(profile_of(id).name == nullptr);
+
+    lock._M_acquire_lock();
+    lock._M_release_lock();
+    REQUIRE(lock._M_try_acquire_lock());
+    lock._M_release_lock();
+    lock_profile_entry e = profile_of(id);
+    REQUIRE(std::string(e.name) == "test lock");
+    REQUIRE(e.acquisitions == 2);
+    REQUIRE(e.contentions == 0);
+    REQUIRE(e.wait_ns == 0);
+
+    // The waiter's try-acquire fails for sure while we hold the lock.
+    lock._M_acquire_lock();
+    std::thread waiter([]() {
+        lock._M_acquire_lock();
+        lock._M_release_lock();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    lock._M_release_lock();
+    waiter.join();
+    e = profile_of(id);
+    REQUIRE(e.acquisitions == 4);
+    REQUIRE(e.contentions == 1);
+    REQUIRE(e.wait_ns > 0);
+    REQUIRE(e.max_hold_ns >= 20000000u);
+
+    lock_profile::reset();
+    e = profile_of(id);
+    REQUIRE(e.acquisitions == 0);
+    REQUIRE(e.max_hold_ns == 0);
+}
+
+TEST_CASE("allocator locks are profiled", "[stl_lock_profile]") {
+    using Alloc = _default_alloc_template<true, 1>;
+    using Lockfree = _Lockfree_alloc_template<1>;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; ++i) {
+                Alloc::deallocate(Alloc::allocate(8), 8);
+            }
+            Lockfree::deallocate(Lockfree::allocate(8), 8);
+        });
+    }
+    for (auto& th : threads) th.join();
+
+    lock_profile_entry entries[64];
+    size_t n = lock_profile::collect(entries, 64);
+    uint64_t node_allocator = 0;
+    bool lockfree_pool = false;
+    for (size_t i = 0; i < n && i < 64; ++i) {
+        std::string name = entries[i].name;
+        if (name == "node allocator") node_allocator += entries[i].acquisitions;
+        if (name == "lockfree pool") lockfree_pool = true;
+        REQUIRE(entries[i].contentions <= entries[i].acquisitions);
+    }
+    REQUIRE(node_allocator >= 8000);
+    REQUIRE(lockfree_pool);
+
+    char* buf = nullptr;
+    size_t len = 0;
+    FILE* out = open_memstream(&buf, &len);
+    lock_profile::dump(out);
+    fclose(out);
+    std::string json(buf, len);
+    free(buf);
+    REQUIRE(json.front() == '{');
+    REQUIRE(json.back() == '}');
+    REQUIRE(json.find("\"profiling_enabled\": true") != std::string::npos);
+    REQUIRE(json.find("{\"name\": \"node allocator\",") != std::string::npos);
+    REQUIRE(json.find("\"max_hold_ns\": ") != std::string::npos);
+}
+
+SHADOW_STL_END_NAMESPACE
@@ -0,0 +1,73 @@
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_lockfree_alloc.h"
+#include "container/slist.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("lockfree_alloc", "[stl_lockfree_alloc]") {
+    using Alloc = _Lockfree_alloc_template<1>;
+    void* p = Alloc::allocate(16);
+    REQUIRE(p != nullptr);
+    Alloc::deallocate(p, 16);
+    // LIFO: the object just freed is handed out again.
+    REQUIRE(Alloc::allocate(16) == p);
+    p = Alloc::reallocate(p, 16, 64);
+    REQUIRE(p != nullptr);
+    Alloc::deallocate(p, 64);
+
+    void* big = Alloc::allocate(4096);
+    REQUIRE(big != nullptr);
+    Alloc::deallocate(big, 4096);
+}
+
+// Many threads allocate and free objects of all 16 size classes.  Each
+// object is stamped with its owner while it is live; if the free lists
+// ever handed the same object to two threads, a stamp would be
+// overwritten.
+TEST_CASE("lockfree_alloc stress", "[stl_lockfree_alloc]") {
+    using Alloc = _Lockfree_alloc_template<2>;
+    const int kThreads = 16;
+    const int kRounds = 200;
+    const int kLive = 64;
+    std::atomic<int> corrupted(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&corrupted, t]() {
+            void* live[kLive];
+            for (int r = 0; r < kRounds; ++r) {
+                for (int i = 0; i < kLive; ++i) {
+                    size_t n = 8 * (1 + (i + r + t) % 16);
+                    live[i] = Alloc::allocate(n);
+                    memset(live[i], t + 1, n);
+                }
+                for (int i = 0; i < kLive; ++i) {
+                    size_t n = 8 * (1 + (i + r + t) % 16);
+                    const unsigned char* c = (const unsigned char*)live[i];
+                    for (size_t k = 0; k < n; ++k) {
+                        if (c[k] != (unsigned char)(t + 1)) {
+                            ++corrupted;
+                            break;
+                        }
+                    }
+                    Alloc::deallocate(live[i], n);
+                }
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE(corrupted == 0);
+}
+
+TEST_CASE("slist on lockfree_alloc", "[stl_lockfree_alloc]") {
+    slist<int, lockfree_alloc> l;
+    for (int i = 0; i < 100; ++i) {
+        l.push_front(i);
+    }
+    REQUIRE(l.size() == 100);
+    REQUIRE(l.front() == 99);
+}
+
+SHADOW_STL_END_NAMESPACE
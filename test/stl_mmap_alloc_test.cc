@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_mmap_alloc.h"
+#include "container/list.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+static void fill_pattern(char* p, size_t n) {
+    for (size_t i = 0; i < n; i += 4096) p[i] = (char)(i >> 12);
+    p[n - 1] = 0x7f;
+}
+
+static bool check_pattern(const char* p, size_t n) {
+    for (size_t i = 0; i < n - 1; i += 4096) {
+        if (p[i] != (char)(i >> 12)) return false;
+    }
+    return p[n - 1] == 0x7f;
+}
+
+TEST_CASE("mmap_alloc", "[stl_mmap_alloc]") {
+    using Alloc = _mmap_alloc_template<false, 1>;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    // Small requests are passed through to malloc_alloc.
+    void* small = Alloc::allocate(100);
+    REQUIRE(small != nullptr);
+    small = Alloc::reallocate(small, 100, 1000);
+    Alloc::deallocate(small, 1000);
+
+    const size_t n = 1 << 20;
+    char* p = (char*)Alloc::allocate(n);
+    REQUIRE((size_t)p % page == 0);
+    fill_pattern(p, n);
+
+    // Growing within the reservation keeps the address.
+    char* q = (char*)Alloc::reallocate(p, n, 2 * n);
+    REQUIRE(q == p);
+    REQUIRE(check_pattern(q, n));
+    q[2 * n - 1] = 1;
+
+    // Growing past it moves the block, contents included.
+    char* r = (char*)Alloc::reallocate(q, 2 * n, 16 * n);
+    REQUIRE(check_pattern(r, n));
+    REQUIRE(r[2 * n - 1] == 1);
+    r[16 * n - 1] = 2;
+
+    // Shrinking stays in place.
+    char* s = (char*)Alloc::reallocate(r, 16 * n, n);
+    REQUIRE(s == r);
+    REQUIRE(check_pattern(s, n));
+    // ... and the released tail can be committed again.
+    s = (char*)Alloc::reallocate(s, n, 8 * n);
+    REQUIRE(s == r);
+    REQUIRE(s[8 * n - 1] == 0);
+
+    // Between a malloc_alloc block and a mapped one.
+    char* t = (char*)Alloc::reallocate(s, 8 * n, 1000);
+    REQUIRE(t[0] == 0);
+    t = (char*)Alloc::reallocate(t, 1000, n);
+    REQUIRE(t[0] == 0);
+    Alloc::deallocate(t, n);
+}
+
+TEST_CASE("huge_page_alloc", "[stl_mmap_alloc]") {
+    using Alloc = _mmap_alloc_template<true, 1>;
+    const size_t huge = 2 * 1024 * 1024;
+    const size_t n = 3 * huge + 100;
+    char* p = (char*)Alloc::allocate(n);
+    REQUIRE((size_t)p % huge == 0);
+    fill_pattern(p, n);
+    char* q = (char*)Alloc::reallocate(p, n, 20 * huge);
+    REQUIRE((size_t)q % huge == 0);
+    REQUIRE(check_pattern(q, n));
+    Alloc::deallocate(q, 20 * huge);
+}
+
+TEST_CASE("containers on mmap_alloc", "[stl_mmap_alloc]") {
+    vector<int, huge_page_alloc> v;
+    for (int i = 0; i < 1000000; ++i) {
+        v.push_back(i);
+    }
+    REQUIRE(v.size() == 1000000);
+    REQUIRE(v[999999] == 999999);
+
+    list<int, mmap_alloc> l;
+    for (int i = 0; i < 1000; ++i) {
+        l.push_back(i);
+    }
+    REQUIRE(l.size() == 1000);
+    REQUIRE(l.back() == 999);
+}
+
+SHADOW_STL_END_NAMESPACE
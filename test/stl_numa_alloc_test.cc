@@ -0,0 +1,75 @@
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_numa_alloc.h"
+#include "container/list.h"
+#include "container/vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+// Runs on any machine, single-node ones included.
+TEST_CASE("numa_alloc", "[stl_numa_alloc]") {
+    using Alloc = _numa_alloc_template<true, 1>;
+    REQUIRE(Alloc::node_count() >= 1);
+    int node = _Numa::_S_current_node();
+    REQUIRE(node >= 0);
+    REQUIRE(node < Alloc::node_count());
+
+    void* ps[1000];
+    for (int i = 0; i < 1000; ++i) ps[i] = Alloc::allocate(48);
+    REQUIRE(Alloc::heap_size() > 0);
+    if (Alloc::node_count() == 1) {
+        REQUIRE(Alloc::heap_size(0) == Alloc::heap_size());
+    }
+    // Nodes past the per-node pools share an unbound pool of their own
+    // instead of another node's.
+    REQUIRE(Alloc::heap_size(node + 8) == 0);
+    REQUIRE(Alloc::heap_size(100) == 0);
+    // Objects go back to their own pool from any thread.
+    std::thread t([&ps]() {
+        for (int i = 0; i < 1000; ++i) Alloc::deallocate(ps[i], 48);
+    });
+    t.join();
+    Alloc::trim();
+    REQUIRE(Alloc::heap_size() == 0);
+
+    void* big = Alloc::allocate(1000);
+    big = Alloc::reallocate(big, 1000, 10);
+    big = Alloc::reallocate(big, 10, 12);
+    Alloc::deallocate(big, 12);
+    void* aligned = Alloc::allocate(16, 64);
+    REQUIRE((size_t)aligned % 64 == 0);
+    Alloc::deallocate(aligned, 16, 64);
+}
+
+TEST_CASE("numa_alloc binds chunks to the local node", "[stl_numa_alloc]") {
+    using Alloc = _numa_alloc_template<true, 2>;
+    void* p = Alloc::allocate(64);
+    int mode = -1;
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {};
+    // MPOL_F_ADDR: the policy of the page holding p.
+    long r = syscall(SYS_get_mempolicy, &mode, mask, 1025UL, p, 2UL);
+    if (r == 0 && Alloc::node_count() > 1) {
+        REQUIRE(mode == _Numa::_MPOL_PREFERRED);
+    } else if (r == 0) {
+        // Nothing to choose between on a single node.
+        REQUIRE(mode == 0);
+    }
+    Alloc::deallocate(p, 64);
+}
+
+TEST_CASE("containers on numa_alloc", "[stl_numa_alloc]") {
+    list<int, numa_alloc> l;
+    vector<int, numa_alloc> v;
+    for (int i = 0; i < 10000; ++i) {
+        l.push_back(i);
+        v.push_back(i);
+    }
+    REQUIRE(l.size() == 10000);
+    REQUIRE(l.back() == 9999);
+    REQUIRE(v[9999] == 9999);
+}
+
+SHADOW_STL_END_NAMESPACE
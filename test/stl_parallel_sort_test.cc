@@ -0,0 +1,98 @@
+#include "algorithm/stl_parallel_sort.h"
+#include "container/list.h"
+#include "container/slist.h"
+#include <catch2/catch_test_macros.hpp>
+#include <stdlib.h>
+#include <vector>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+struct record {
+    int key;
+    int order;
+};
+
+bool by_key(const record* a, const record* b) { return a->key < b->key; }
+}
+
+TEST_CASE("parallel merge sort", "[stl_parallel_sort]") {
+    _Shadow_STL_thread_pool pool(3);
+    srand(11);
+    // Lengths around the run and piece boundaries, and keys with many
+    // ties, so that any instability shows.
+    for (size_t n : {0, 1, 7, 64, 100, 1000, 4099, 50000}) {
+        std::vector<record> records(n);
+        for (size_t i = 0; i < n; ++i) records[i] = record{rand() % 37, (int)i};
+        std::vector<const record*> serial(2 * n + 1), parallel(2 * n + 1);
+        for (size_t i = 0; i < n; ++i) serial[i] = parallel[i] = &records[i];
+
+        _merge_sort_buffered(&serial[0], &serial[0] + n, &serial[0] + n, by_key);
+        for (size_t min_run : {1, 16, 1000}) {
+            std::vector<const record*> p(parallel);
+            _parallel_merge_sort_buffered(&p[0], &p[0] + n, &p[0] + n, by_key, pool, min_run);
+            bool same = true;
+            for (size_t i = 0; i < n; ++i) same = same && p[i] == serial[i];
+            REQUIRE(same);
+        }
+        for (size_t i = 1; i < n; ++i) {
+            REQUIRE(serial[i - 1]->key <= serial[i]->key);
+            if (serial[i - 1]->key == serial[i]->key) REQUIRE(serial[i - 1]->order < serial[i]->order);
+        }
+    }
+}
+
+TEST_CASE("parallel merge sort with a throwing comparison", "[stl_parallel_sort]") {
+    _Shadow_STL_thread_pool pool(3);
+    std::vector<int> v(10000), buf(10000);
+    for (int i = 0; i < 10000; ++i) v[i] = 10000 - i;
+    std::atomic<int> calls{0};
+    bool thrown = false;
+    try {
+        _parallel_merge_sort_buffered(&v[0], &v[0] + v.size(), &buf[0],
+                                      [&calls](int a, int b) {
+                                          if (++calls == 20000) throw 1;
+                                          return a < b;
+                                      },
+                                      pool, 100);
+    } catch (int) {
+        thrown = true;
+    }
+    REQUIRE(thrown);
+}
+
+TEST_CASE("list and slist parallel_sort", "[stl_parallel_sort]") {
+    list<record> l;
+    slist<record> s;
+    for (int i = 0; i < 100000; ++i) {
+        l.push_back(record{rand() % 101, i});
+        s.push_front(record{rand() % 101, i});
+    }
+    auto less = [](const record& a, const record& b) { return a.key < b.key; };
+
+    list<record> lc(l);
+    l.sort(less);
+    lc.parallel_sort(less);
+    REQUIRE(lc.size() == l.size());
+    list<record>::iterator i = l.begin(), j = lc.begin();
+    bool same = true;
+    for (; i != l.end(); ++i, ++j) same = same && i->key == j->key && i->order == j->order;
+    REQUIRE(same);
+
+    slist<record> sc(s);
+    s.sort(less);
+    sc.parallel_sort(less);
+    slist<record>::iterator si = s.begin(), sj = sc.begin();
+    same = true;
+    for (; si != s.end(); ++si, ++sj) same = same && si->key == sj->key && si->order == sj->order;
+    REQUIRE(same);
+    REQUIRE(sj == sc.end());
+
+    list<int> ints;
+    for (int k = 0; k < 1000; ++k) ints.push_back(999 - k);
+    ints.parallel_sort();
+    int expect = 0;
+    for (int x : ints) REQUIRE(x == expect++);
+}
+
+SHADOW_STL_END_NAMESPACE
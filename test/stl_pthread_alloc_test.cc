@@ -0,0 +1,75 @@
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+#include "allocator/stl_pthread_alloc.h"
+#include "container/list.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+TEST_CASE("pthread_alloc", "[stl_pthread_alloc]") {
+    using Alloc = _Pthread_alloc_template<1>;
+    std::vector<void*> ps;
+    // Enough objects to go through several refills and drains.
+    for (int i = 0; i < 1000; ++i) {
+        void* p = Alloc::allocate(24);
+        REQUIRE(p != nullptr);
+        memset(p, 0xab, 24);
+        ps.push_back(p);
+    }
+    for (void* p : ps) {
+        Alloc::deallocate(p, 24);
+    }
+    Alloc::flush();
+
+    // Requests above _MAX_BYTES are passed through to malloc_alloc.
+    void* big = Alloc::allocate(1000);
+    REQUIRE(big != nullptr);
+    big = Alloc::reallocate(big, 1000, 2000);
+    Alloc::deallocate(big, 2000);
+}
+
+TEST_CASE("pthread_alloc cross-thread", "[stl_pthread_alloc]") {
+    using Alloc = _Pthread_alloc_template<2>;
+    const int kThreads = 8;
+    const int kObjs = 2000;
+    std::vector<std::vector<void*>> produced(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&produced, t]() {
+            for (int i = 0; i < kObjs; ++i) {
+                size_t n = 8 * (1 + (i % 16));
+                void* p = Alloc::allocate(n);
+                *(int*)p = t;
+                produced[t].push_back(p);
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    threads.clear();
+
+    // Free every object from a different thread than the one that
+    // allocated it.
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&produced, t]() {
+            auto& ps = produced[(t + 1) % kThreads];
+            for (int i = 0; i < kObjs; ++i) {
+                REQUIRE(*(int*)ps[i] == (t + 1) % kThreads);
+                Alloc::deallocate(ps[i], 8 * (1 + (i % 16)));
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+}
+
+TEST_CASE("list on pthread_alloc", "[stl_pthread_alloc]") {
+    list<int, pthread_alloc> l;
+    for (int i = 0; i < 100; ++i) {
+        l.push_back(i);
+    }
+    REQUIRE(l.size() == 100);
+    REQUIRE(l.front() == 0);
+    REQUIRE(l.back() == 99);
+}
+
+SHADOW_STL_END_NAMESPACE
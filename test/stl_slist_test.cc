@@ -21,4 +21,64 @@ TEST_CASE("slist", "[stl_slist]") {
   REQUIRE(l.front() == 1);
 }
 
+TEST_CASE("slist bulk insert", "[stl_slist]") {
+  slist<int> l(1000, 7);
+  REQUIRE(l.size() == 1000);
+  REQUIRE(l.front() == 7);
+
+  int a[200];
+  for (int i = 0; i < 200; ++i) a[i] = i;
+  l.insert_after(l.begin(), a, a + 200);
+  REQUIRE(l.size() == 1200);
+  slist<int>::iterator it = l.begin();
+  REQUIRE(*it++ == 7);
+  for (int i = 0; i < 200; ++i) REQUIRE(*it++ == i);
+  REQUIRE(*it == 7);
+
+  slist<int> copy(l);
+  REQUIRE(copy.size() == 1200);
+  REQUIRE(copy == l);
+}
+
+namespace {
+struct keyed {
+  int key;
+  int order;
+};
+}
+
+TEST_CASE("slist sort is stable", "[stl_slist]") {
+  slist<keyed> l;
+  for (int i = 0; i < 5000; ++i) l.push_front(keyed{(i * 7919) % 97, -i});
+  l.sort([](const keyed &a, const keyed &b) { return a.key < b.key; });
+  REQUIRE(l.size() == 5000);
+  slist<keyed>::iterator prev = l.begin(), i = prev;
+  for (++i; i != l.end(); prev = i, ++i) {
+    REQUIRE(prev->key <= i->key);
+    if (prev->key == i->key) REQUIRE(prev->order < i->order);
+  }
+
+  // A comparison that throws leaves the slist as it was.
+  slist<int> m;
+  for (int k = 0; k < 100; ++k) m.push_front(k);
+  int calls = 0;
+  bool thrown = false;
+  try {
+    m.sort([&calls](int x, int y) {
+      if (++calls == 50) throw 1;
+      return x < y;
+    });
+  } catch (int) {
+    thrown = true;
+  }
+  REQUIRE(thrown);
+  int expect = 99;
+  for (slist<int>::iterator j = m.begin(); j != m.end(); ++j) REQUIRE(*j == expect--);
+  REQUIRE(expect == -1);
+
+  m.sort();
+  expect = 0;
+  for (slist<int>::iterator j = m.begin(); j != m.end(); ++j) REQUIRE(*j == expect++);
+}
+
 SHADOW_STL_END_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <catch2/catch_test_macros.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+#include "container/small_vector.h"
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+// Whether v's elements live inside v.
+template <typename V>
+bool is_inline(const V& v) {
+    const char* p = (const char*)&*v.begin();
+    return p >= (const char*)&v && p < (const char*)(&v + 1);
+}
+
+// Owns a heap string, and counts the live ones.
+struct label {
+    static int live;
+    char* text;
+
+    label(const char* t) : text(strdup(t)) { ++live; }
+    label(const label& x) : text(strdup(x.text)) { ++live; }
+    label(label&& x) noexcept : text(x.text) {
+        x.text = nullptr;
+        ++live;
+    }
+    label& operator=(const label& x) {
+        if (this != &x) {
+            free(text);
+            text = strdup(x.text);
+        }
+        return *this;
+    }
+    label& operator=(label&& x) noexcept {
+        std::swap(text, x.text);
+        return *this;
+    }
+    ~label() {
+        free(text);
+        --live;
+    }
+    bool operator==(const label& x) const { return strcmp(text, x.text) == 0; }
+    bool operator!=(const label& x) const { return !(*this == x); }
+    bool operator<(const label& x) const { return strcmp(text, x.text) < 0; }
+};
+int label::live = 0;
+
+template <typename V>
+V labels(int first, int n) {
+    V v;
+    char buf[16];
+    for (int i = first; i < first + n; ++i) {
+        snprintf(buf, sizeof buf, "label %d", i);
+        v.emplace_back(buf);
+    }
+    return v;
+}
+}
+
+TEST_CASE("small_vector", "[stl_small_vector]") {
+    small_vector<int, 8> v;
+    REQUIRE(v.empty());
+    REQUIRE(v.capacity() == 8);
+    for (int i = 0; i < 8; ++i) v.push_back(i);
+    REQUIRE(is_inline(v));
+    REQUIRE(v.capacity() == 8);
+
+    v.push_back(8);
+    REQUIRE(!is_inline(v));
+    REQUIRE(v.capacity() == 16);
+    for (int i = 0; i < 9; ++i) REQUIRE(v[i] == i);
+
+    v.erase(v.begin() + 2, v.end());
+    v.shrink_to_fit();
+    REQUIRE(is_inline(v));
+    REQUIRE(v.capacity() == 8);
+    REQUIRE(v.size() == 2);
+    REQUIRE(v[1] == 1);
+
+    small_vector<int, 4> w(3, 7);
+    REQUIRE(is_inline(w));
+    REQUIRE(w.capacity() == 4);
+    int a[] = {1, 2, 3, 4, 5, 6};
+    small_vector<int, 4> x(a, a + 6);
+    REQUIRE(!is_inline(x));
+    REQUIRE(x.size() == 6);
+    w.assign(a, a + 4);
+    REQUIRE(is_inline(w));
+    w.insert(w.begin() + 1, 2, 0);
+    REQUIRE(w.size() == 6);
+    REQUIRE(w[2] == 0);
+    REQUIRE(w[3] == 2);
+    w.assign(10u, 9);
+    REQUIRE(w.size() == 10);
+    REQUIRE(w.back() == 9);
+}
+
+TEST_CASE("small_vector copies, moves and swaps", "[stl_small_vector]") {
+    using V = small_vector<label, 4>;
+    {
+        V small = labels<V>(0, 3);
+        V big = labels<V>(10, 6);
+        REQUIRE(label::live == 9);
+
+        V c = small;
+        REQUIRE(is_inline(c));
+        REQUIRE(c == small);
+        c = big;
+        REQUIRE(!is_inline(c));
+        REQUIRE(c == big);
+        c = small;
+        REQUIRE(c == small);
+        REQUIRE(!is_inline(c));
+        c.shrink_to_fit();
+        REQUIRE(is_inline(c));
+        REQUIRE(label::live == 12);
+
+        // Inline elements are moved one by one, heap ones handed over.
+        V m = std::move(c);
+        REQUIRE(is_inline(m));
+        REQUIRE(c.empty());
+        REQUIRE(m == small);
+        const label* heap = &*big.begin();
+        V n = std::move(big);
+        REQUIRE(&*n.begin() == heap);
+        REQUIRE(big.empty());
+        REQUIRE(is_inline(big));
+        big = std::move(n);
+        REQUIRE(big.size() == 6);
+        REQUIRE(label::live == 12);
+
+        swap(m, big);
+        REQUIRE(m.size() == 6);
+        REQUIRE(is_inline(big));
+        REQUIRE(big == small);
+        swap(m, big);
+        REQUIRE(m == small);
+        REQUIRE(big == labels<V>(10, 6));
+        V other = labels<V>(20, 2);
+        m.swap(other);
+        REQUIRE(m == labels<V>(20, 2));
+        REQUIRE(other == small);
+        REQUIRE(label::live == 14);
+
+        REQUIRE(small < big);
+        m.insert(m.begin() + 1, big.begin(), big.end());
+        REQUIRE(m.size() == 8);
+        REQUIRE(m[1] == big[0]);
+        m.resize(3, "x");
+        m.shrink_to_fit();
+        REQUIRE(is_inline(m));
+        REQUIRE(m[2] == big[1]);
+    }
+    REQUIRE(label::live == 0);
+}
+
+namespace {
+// A malloc-backed allocator with state, which small_vector keeps an
+// instance of.
+template <typename T>
+struct malloc_allocator {
+    template <typename U>
+    struct rebind {
+        using other = malloc_allocator<U>;
+    };
+    int id;
+
+    explicit malloc_allocator(int i) : id(i) {}
+    template <typename U>
+    malloc_allocator(const malloc_allocator<U>& x) : id(x.id) {}
+
+    T* allocate(size_t n) { return (T*)malloc(n * sizeof(T)); }
+    void deallocate(T* p, size_t) { free(p); }
+};
+}
+
+TEST_CASE("small_vector shrink_to_fit on the heap", "[stl_small_vector]") {
+    small_vector<int, 4, malloc_allocator<int>> v{malloc_allocator<int>(1)};
+    for (int i = 0; i < 1000; ++i) v.push_back(i);
+    v.resize(10);
+    v.shrink_to_fit();
+    REQUIRE(!is_inline(v));
+    REQUIRE(v.capacity() == 10);
+    for (int i = 0; i < 10; ++i) REQUIRE(v[i] == i);
+    v.resize(3);
+    v.shrink_to_fit();
+    REQUIRE(is_inline(v));
+    REQUIRE(v[2] == 2);
+}
+
+SHADOW_STL_END_NAMESPACE
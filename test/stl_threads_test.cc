@@ -1,6 +1,9 @@
+#include <atomic>
 #include <thread>
+#include <vector>
 
 #include <catch2/catch_test_macros.hpp>
+#include "include/stl_thread_pool.h"
 #include "include/stl_threads.h"
 
 SHADOW_STL_BEGIN_NAMESPACE
@@ -22,6 +25,24 @@ TEST_CASE("Refcount_Base", "[stl_threads]") {
     REQUIRE(rb._M_ref_count == 1);
 }
 
+TEST_CASE("Refcount_Base under contention", "[stl_threads]") {
+    REQUIRE(sizeof(_Refcount_Base) == 4);
+    _Refcount_Base rb(1);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&rb]() {
+            for (int i = 0; i < 100000; ++i) {
+                rb._M_incr();
+                rb._M_incr();
+                rb._M_decr();
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE(rb._M_ref_count == 800001);
+    REQUIRE(rb._M_decr() == 800000);
+}
+
 TEST_CASE("Atomic_swap", "[stl_threads]") {
     unsigned long p = 3;
     unsigned long q = 4;
@@ -32,6 +53,22 @@ TEST_CASE("Atomic_swap", "[stl_threads]") {
     });
     t1.join();
     REQUIRE(p == 4);
+
+    // Every value swapped in is swapped out exactly once.
+    unsigned long slot = 0;
+    std::atomic<unsigned long> sum(0);
+    std::vector<std::thread> threads;
+    for (unsigned long t = 0; t < 8; ++t) {
+        threads.emplace_back([&slot, &sum, t]() {
+            unsigned long local = 0;
+            for (unsigned long i = 1; i <= 10000; ++i) {
+                local += _Atomic_swap(&slot, t * 10000 + i);
+            }
+            sum += local;
+        });
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE(sum + slot == 80000UL * 80001UL / 2);
 }
 
 TEST_CASE("Mutex_lock", "[stl_threads]") {
@@ -69,5 +106,105 @@ TEST_CASE("Auto_lock", "[stl_threads]") {
     REQUIRE(count == 1);
 }
 
+// nthreads threads bump a plain counter under the lock.
+template <typename Lock>
+static void check_mutual_exclusion() {
+    static Lock lock;
+    long count = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&count]() {
+            for (int i = 0; i < 20000; ++i) {
+                _Shadow_STL_auto_lock<Lock> guard(lock);
+                ++count;
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    REQUIRE(count == 80000);
+
+    REQUIRE(lock._M_try_acquire_lock());
+    bool taken = true;
+    std::thread t1([&taken]() { taken = lock._M_try_acquire_lock(); });
+    t1.join();
+    REQUIRE(!taken);
+    lock._M_release_lock();
+    REQUIRE(lock._M_try_acquire_lock());
+    lock._M_release_lock();
+}
+
+TEST_CASE("Adaptive_lock", "[stl_threads]") {
+    check_mutual_exclusion<_Shadow_STL_adaptive_lock<>>();
+    // Parks right away.
+    check_mutual_exclusion<_Shadow_STL_adaptive_lock<0>>();
+}
+
+TEST_CASE("Ticket_lock", "[stl_threads]") {
+    check_mutual_exclusion<_Shadow_STL_ticket_lock<>>();
+}
+
+TEST_CASE("MCS_lock", "[stl_threads]") {
+    check_mutual_exclusion<_Shadow_STL_mcs_lock<>>();
+
+    // Several held at once, released out of order.
+    _Shadow_STL_mcs_lock<> a, b, c;
+    a._M_acquire_lock();
+    b._M_acquire_lock();
+    REQUIRE(c._M_try_acquire_lock());
+    a._M_release_lock();
+    c._M_release_lock();
+    a._M_acquire_lock();
+    a._M_release_lock();
+    b._M_release_lock();
+}
+
+TEST_CASE("Thread_pool", "[stl_threads]") {
+    _Shadow_STL_thread_pool pool(3);
+    REQUIRE(pool._M_concurrency() == 4);
+
+    // Every index runs once, on all jobs in turn.
+    std::vector<std::atomic<int>> hits(1000);
+    for (int job = 0; job < 100; ++job) {
+        auto mark = [&hits](size_t i) { hits[i].fetch_add(1, std::memory_order_relaxed); };
+        pool._M_for_each(hits.size(), mark);
+    }
+    for (auto& h : hits) REQUIRE(h.load() == 100);
+
+    // A job started inside a job runs on the thread that started it.
+    std::atomic<int> inner{0};
+    std::atomic<bool> same_thread{true};
+    auto outer = [&pool, &inner, &same_thread](size_t) {
+        const pthread_t self = pthread_self();
+        auto count = [&inner, &same_thread, self](size_t) {
+            if (!pthread_equal(self, pthread_self())) same_thread = false;
+            inner.fetch_add(1);
+        };
+        pool._M_for_each(10, count);
+    };
+    pool._M_for_each(8, outer);
+    REQUIRE(inner.load() == 80);
+    REQUIRE(same_thread.load());
+
+    // The first exception reaches the caller, after every call is done.
+    std::atomic<int> done{0};
+    auto fail = [&done](size_t i) {
+        done.fetch_add(1);
+        if (i % 10 == 3) throw (int)i;
+    };
+    bool thrown = false;
+    try {
+        pool._M_for_each(100, fail);
+    } catch (int i) {
+        thrown = i % 10 == 3;
+    }
+    REQUIRE(thrown);
+    REQUIRE(done.load() == 100);
+
+    // The pool is usable after that.
+    std::atomic<int> after{0};
+    auto count = [&after](size_t) { after.fetch_add(1); };
+    pool._M_for_each(50, count);
+    REQUIRE(after.load() == 50);
+}
 
 SHADOW_STL_END_NAMESPACE
\ No newline at end of file
@@ -0,0 +1,321 @@
+#include "container/list.h"
+#include "container/ulist.h"
+#include "container/vector.h"
+#include <catch2/catch_test_macros.hpp>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
+
+SHADOW_STL_BEGIN_NAMESPACE
+
+namespace {
+// Counts live instances, so that every element built is destroyed.
+struct tracked {
+  static int live;
+  int value;
+  int order;
+  tracked(int v = 0, int o = 0) : value(v), order(o) { ++live; }
+  tracked(const tracked &x) : value(x.value), order(x.order) { ++live; }
+  tracked &operator=(const tracked &x) {
+    value = x.value;
+    order = x.order;
+    return *this;
+  }
+  ~tracked() { --live; }
+  bool operator==(const tracked &x) const { return value == x.value; }
+  bool operator<(const tracked &x) const { return value < x.value; }
+};
+int tracked::live = 0;
+
+template <typename Ulist>
+vector<int> values(const Ulist &u) {
+  vector<int> v;
+  for (typename Ulist::const_iterator i = u.begin(); i != u.end(); ++i) {
+    v.push_back(i->value);
+  }
+  return v;
+}
+
+// Mirrors every operation on a list of the same values.
+template <typename Ulist>
+bool same(const Ulist &u, const list<int> &l) {
+  if (u.size() != l.size()) return false;
+  list<int>::const_iterator j = l.begin();
+  for (typename Ulist::const_iterator i = u.begin(); i != u.end(); ++i, ++j) {
+    if (i->value != *j) return false;
+  }
+  return true;
+}
+}
+
+TEST_CASE("ulist", "[stl_ulist]") {
+  ulist<int, 4> u;
+  REQUIRE(u.empty());
+  for (int i = 0; i < 10; ++i) u.push_back(i);
+  u.push_front(-1);
+  REQUIRE(u.size() == 11);
+  REQUIRE(u.front() == -1);
+  REQUIRE(u.back() == 9);
+
+  int expect = -1;
+  for (ulist<int, 4>::iterator i = u.begin(); i != u.end(); ++i) {
+    REQUIRE(*i == expect++);
+  }
+  expect = 9;
+  for (ulist<int, 4>::reverse_iterator i = u.rbegin(); i != u.rend(); ++i) {
+    REQUIRE(*i == expect--);
+  }
+
+  u.pop_front();
+  u.pop_back();
+  REQUIRE(u.size() == 9);
+  REQUIRE(u.front() == 0);
+  REQUIRE(u.back() == 8);
+
+  ulist<int, 4> copy(u);
+  REQUIRE(copy == u);
+  copy.push_back(9);
+  REQUIRE(copy != u);
+  REQUIRE(u < copy);
+  copy = u;
+  REQUIRE(copy == u);
+
+  ulist<int, 4> filled(3, 5);
+  REQUIRE(filled.size() == 3);
+  REQUIRE(filled.back() == 5);
+}
+
+TEST_CASE("ulist insert and erase against list", "[stl_ulist]") {
+  srand(7);
+  {
+    ulist<tracked, 8> u;
+    list<int> l;
+    for (int step = 0; step < 20000; ++step) {
+      const size_t at = l.empty() ? 0 : rand() % (l.size() + 1);
+      ulist<tracked, 8>::iterator i = u.begin();
+      list<int>::iterator j = l.begin();
+      for (size_t k = 0; k < at; ++k, ++i, ++j) {
+      }
+      const int op = rand() % 8;
+      if (op < 4 || l.empty()) {
+        ulist<tracked, 8>::iterator r = u.insert(i, tracked(step));
+        l.insert(j, step);
+        REQUIRE(r->value == step);
+      } else if (op < 6 && j != l.end()) {
+        ulist<tracked, 8>::iterator r = u.erase(i);
+        j = l.erase(j);
+        REQUIRE((j == l.end() ? r == u.end() : r->value == *j));
+      } else if (op == 6) {
+        const size_t n = rand() % 20;
+        list<int>::iterator last = j;
+        ulist<tracked, 8>::iterator ulast = i;
+        for (size_t k = 0; k < n && last != l.end(); ++k, ++last, ++ulast) {
+        }
+        ulist<tracked, 8>::iterator r = u.erase(i, ulast);
+        j = l.erase(j, last);
+        REQUIRE((j == l.end() ? r == u.end() : r->value == *j));
+      } else {
+        u.insert(i, 3, tracked(-step));
+        l.insert(j, 3, -step);
+      }
+      REQUIRE(same(u, l));
+      REQUIRE(tracked::live == (int)u.size());
+    }
+    u.resize(10);
+    REQUIRE(u.size() == 10);
+    u.resize(30, tracked(1));
+    REQUIRE(u.size() == 30);
+    REQUIRE(u.back().value == 1);
+  }
+  REQUIRE(tracked::live == 0);
+}
+
+TEST_CASE("ulist splice", "[stl_ulist]") {
+  {
+    ulist<tracked, 4> a, b;
+    list<int> la, lb;
+    for (int i = 0; i < 30; ++i) {
+      a.push_back(i);
+      la.push_back(i);
+      b.push_back(100 + i);
+      lb.push_back(100 + i);
+    }
+
+    // The range and the position fall inside nodes.
+    ulist<tracked, 4>::iterator pos = a.begin(), first = b.begin(), last;
+    list<int>::iterator lpos = la.begin(), lfirst = lb.begin(), llast;
+    for (int k = 0; k < 5; ++k, ++pos, ++lpos) {
+    }
+    for (int k = 0; k < 3; ++k, ++first, ++lfirst) {
+    }
+    last = first;
+    llast = lfirst;
+    for (int k = 0; k < 10; ++k, ++last, ++llast) {
+    }
+    a.splice(pos, b, first, last);
+    la.splice(lpos, lb, lfirst, llast);
+    REQUIRE(same(a, la));
+    REQUIRE(same(b, lb));
+
+    // One element, then everything.
+    a.splice(a.end(), b, b.begin());
+    la.splice(la.end(), lb, lb.begin());
+    REQUIRE(same(a, la));
+    REQUIRE(same(b, lb));
+    b.splice(b.begin(), a);
+    lb.splice(lb.begin(), la);
+    REQUIRE(a.empty());
+    REQUIRE(same(b, lb));
+
+    // Within one ulist, in both directions, from and to mid-node.
+    for (int round = 0; round < 200; ++round) {
+      const int n = (int)lb.size();
+      int f = rand() % n, t = f + rand() % (n - f + 1), p = rand() % (n + 1);
+      if (p >= f && p < t) continue;
+      ulist<tracked, 4>::iterator uf = b.begin(), ut, up = b.begin();
+      list<int>::iterator lf = lb.begin(), lt, lp = lb.begin();
+      for (int k = 0; k < f; ++k, ++uf, ++lf) {
+      }
+      ut = uf;
+      lt = lf;
+      for (int k = f; k < t; ++k, ++ut, ++lt) {
+      }
+      for (int k = 0; k < p; ++k, ++up, ++lp) {
+      }
+      b.splice(up, b, uf, ut);
+      lb.splice(lp, lb, lf, lt);
+      REQUIRE(same(b, lb));
+    }
+    REQUIRE(tracked::live == (int)(a.size() + b.size()));
+  }
+  REQUIRE(tracked::live == 0);
+}
+
+TEST_CASE("ulist sort, reverse and remove", "[stl_ulist]") {
+  {
+    ulist<tracked, 8> u;
+    for (int i = 0; i < 1000; ++i) u.push_back(tracked(rand() % 50, i));
+    u.sort();
+    REQUIRE(u.size() == 1000);
+    REQUIRE(tracked::live == 1000);
+    // Stable: equal values keep their insertion order.
+    ulist<tracked, 8>::iterator prev = u.begin(), i = prev;
+    for (++i; i != u.end(); prev = i, ++i) {
+      REQUIRE(prev->value <= i->value);
+      if (prev->value == i->value) REQUIRE(prev->order < i->order);
+    }
+
+    u.sort([](const tracked &a, const tracked &b) { return b.value < a.value; });
+    REQUIRE(u.front().value == 49);
+    REQUIRE(u.back().value == 0);
+
+    u.reverse();
+    vector<int> v = values(u);
+    for (size_t k = 1; k < v.size(); ++k) REQUIRE(v[k - 1] <= v[k]);
+
+    u.remove(tracked(0));
+    REQUIRE(u.front().value == 1);
+    u.remove_if([](const tracked &x) { return x.value % 2 == 1; });
+    for (ulist<tracked, 8>::iterator j = u.begin(); j != u.end(); ++j) {
+      REQUIRE(j->value % 2 == 0);
+    }
+    REQUIRE(tracked::live == (int)u.size());
+
+    ulist<tracked, 8> other;
+    other.push_back(tracked(1));
+    swap(u, other);
+    REQUIRE(u.size() == 1);
+    REQUIRE(other.front().value == 2);
+  }
+  REQUIRE(tracked::live == 0);
+}
+
+namespace {
+// Hands out a fixed number of blocks, then throws bad_alloc.
+template <typename T>
+struct budget_allocator {
+  template <typename U> struct rebind {
+    using other = budget_allocator<U>;
+  };
+  int *left;
+
+  explicit budget_allocator(int *l) : left(l) {}
+  template <typename U>
+  budget_allocator(const budget_allocator<U> &x) : left(x.left) {}
+
+  T *allocate(size_t n) {
+    if (*left == 0) throw std::bad_alloc();
+    --*left;
+    return (T *)malloc(n * sizeof(T));
+  }
+  void deallocate(T *p, size_t) {
+    ++*left;
+    free(p);
+  }
+};
+
+// Owns a heap string; moves are nothrow, so sort and insert move it.
+struct text {
+  char *s;
+  explicit text(int v) {
+    char buf[64];
+    snprintf(buf, sizeof buf, "a string on the heap %d", v);
+    s = strdup(buf);
+  }
+  text(const text &x) : s(strdup(x.s)) {}
+  text(text &&x) noexcept : s(x.s) { x.s = nullptr; }
+  text &operator=(text &&x) noexcept {
+    std::swap(s, x.s);
+    return *this;
+  }
+  ~text() { free(s); }
+  bool operator<(const text &x) const { return strcmp(s, x.s) < 0; }
+};
+}
+
+TEST_CASE("ulist sort keeps the elements when a node allocation fails",
+          "[stl_ulist]") {
+  int left = 1000;
+  using U = ulist<text, 4, budget_allocator<text>>;
+  U u{budget_allocator<text>(&left)};
+  list<int> l;
+  for (int i = 0; i < 100; ++i) {
+    u.push_back(text((i * 37) % 100));
+    l.push_back((i * 37) % 100);
+  }
+  // The new chain needs 25 nodes.
+  left = 10;
+  REQUIRE_THROWS_AS(u.sort(), std::bad_alloc);
+  REQUIRE(left == 10);
+  REQUIRE(u.size() == 100);
+  list<int>::iterator j = l.begin();
+  for (U::iterator i = u.begin(); i != u.end(); ++i, ++j) {
+    REQUIRE((i->s != nullptr && strcmp(i->s, text(*j).s) == 0));
+  }
+
+  left = 1000;
+  u.sort();
+  U::iterator prev = u.begin(), i = prev;
+  for (++i; i != u.end(); prev = i, ++i) REQUIRE(*prev < *i);
+}
+
+TEST_CASE("ulist inserts copies of one of its own elements", "[stl_ulist]") {
+  ulist<text, 4> u;
+  for (int i = 0; i < 8; ++i) u.push_back(text(i));
+  ulist<text, 4>::iterator third = u.begin();
+  ++third;
+  ++third;
+  // The first insert splits the full node that holds *third.
+  u.insert(++u.begin(), 5, *third);
+  u.insert(u.end(), 3, u.front());
+  const int expect[] = {0, 2, 2, 2, 2, 2, 1, 2, 3, 4, 5, 6, 7, 0, 0, 0};
+  REQUIRE(u.size() == 16);
+  int k = 0;
+  for (ulist<text, 4>::iterator i = u.begin(); i != u.end(); ++i, ++k) {
+    REQUIRE(strcmp(i->s, text(expect[k]).s) == 0);
+  }
+}
+
+SHADOW_STL_END_NAMESPACE
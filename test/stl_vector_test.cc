@@ -1,5 +1,10 @@
 #include <catch2/catch_test_macros.hpp>
 #include <climits>
+#include <vector>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <utility>
 #include "container/vector.h"
 
 SHADOW_STL_BEGIN_NAMESPACE
@@ -34,4 +39,388 @@ TEST_CASE("bvector", "[stl_bvector]") {
     REQUIRE(v.capacity() == WORD_BIT);
 }
 
-SHADOW_STL_END_NAMESPACE
\ No newline at end of file
+namespace {
+struct alignas(32) avx_lane {
+    float f[8];
+};
+}
+
+TEST_CASE("vector of over-aligned elements", "[stl_vector]") {
+    vector<avx_lane> v;
+    for (int i = 0; i < 100; ++i) {
+        avx_lane x;
+        for (int j = 0; j < 8; ++j) x.f[j] = (float)(i + j);
+        v.push_back(x);
+        REQUIRE((size_t)&v[0] % 32 == 0);
+    }
+    REQUIRE(v[99].f[7] == 106.0f);
+}
+
+namespace {
+// Counts copies and moves.  NoexceptMove says whether moving is
+// declared noexcept.
+template <bool NoexceptMove>
+struct counted {
+    static int copies;
+    static int moves;
+    int value;
+
+    counted(int v = 0) : value(v) {}
+    counted(const counted& x) : value(x.value) { ++copies; }
+    counted(counted&& x) noexcept(NoexceptMove) : value(x.value) {
+        x.value = -1;
+        ++moves;
+    }
+    counted& operator=(const counted& x) {
+        value = x.value;
+        ++copies;
+        return *this;
+    }
+    counted& operator=(counted&& x) noexcept(NoexceptMove) {
+        value = x.value;
+        x.value = -1;
+        ++moves;
+        return *this;
+    }
+    static void reset() { copies = moves = 0; }
+};
+template <bool NoexceptMove> int counted<NoexceptMove>::copies = 0;
+template <bool NoexceptMove> int counted<NoexceptMove>::moves = 0;
+}
+
+TEST_CASE("vector move semantics", "[stl_vector]") {
+    using item = counted<true>;
+    item::reset();
+    vector<item> v;
+    for (int i = 0; i < 100; ++i) v.emplace_back(i);
+    item x(100);
+    v.push_back(std::move(x));
+    // Growing moved the elements instead of copying them.
+    REQUIRE(item::copies == 0);
+    REQUIRE(v.size() == 101);
+    REQUIRE(v[100].value == 100);
+    REQUIRE(x.value == -1);
+
+    v.reserve(1000);
+    v.emplace(v.begin(), -5);
+    v.insert(v.begin() + 1, item(-6));
+    v.erase(v.begin() + 2);
+    REQUIRE(item::copies == 0);
+    REQUIRE(v[0].value == -5);
+    REQUIRE(v[1].value == -6);
+    REQUIRE(v[2].value == 1);
+    REQUIRE(v.back().value == 100);
+
+    // Emplacing a copy of one of the elements themselves.
+    v.emplace(v.begin(), v.back());
+    REQUIRE(v.front().value == 100);
+    REQUIRE(item::copies == 1);
+
+    item::reset();
+    vector<item> w(std::move(v));
+    REQUIRE(v.empty());
+    REQUIRE(v.capacity() == 0);
+    REQUIRE(w.size() == 103);
+    v = std::move(w);
+    REQUIRE(w.empty());
+    REQUIRE(v.size() == 103);
+    REQUIRE(item::copies == 0);
+    REQUIRE(item::moves == 0);
+}
+
+TEST_CASE("vector copies elements whose move may throw", "[stl_vector]") {
+    using item = counted<false>;
+    item::reset();
+    vector<item> v;
+    for (int i = 0; i < 8; ++i) v.emplace_back(i);
+    // Growing from 1, 2 and 4 elements copied 7 of them.
+    REQUIRE(item::copies == 7);
+    REQUIRE(item::moves == 0);
+    REQUIRE(v[7].value == 7);
+}
+
+namespace {
+// Owns a heap buffer, like a string.
+struct record {
+    char* text;
+
+    record(const char* t = "") : text(strdup(t)) {}
+    record(const record& x) : text(strdup(x.text)) {}
+    record(record&& x) noexcept : text(x.text) { x.text = nullptr; }
+    record& operator=(const record& x) {
+        if (this != &x) {
+            free(text);
+            text = strdup(x.text);
+        }
+        return *this;
+    }
+    record& operator=(record&& x) noexcept {
+        std::swap(text, x.text);
+        return *this;
+    }
+    ~record() { free(text); }
+    bool operator==(const record& x) const { return strcmp(text, x.text) == 0; }
+    bool operator!=(const record& x) const { return !(*this == x); }
+};
+}
+
+TEST_CASE("vector of heap-owning records", "[stl_vector]") {
+    vector<record> v;
+    char buf[2] = "a";
+    for (int i = 0; i < 100; ++i) {
+        buf[0] = char('a' + i % 26);
+        v.push_back(record(buf));
+    }
+    v.insert(v.begin() + 10, 5, record("x"));
+    v.erase(v.begin(), v.begin() + 3);
+    REQUIRE(v.size() == 102);
+    REQUIRE(v[7] == record("x"));
+    REQUIRE(v[12] == record("k"));
+    vector<record> w;
+    w.push_back("short");
+    w = v;
+    REQUIRE(w == v);
+    w.insert(w.begin(), v.begin(), v.begin() + 3);
+    REQUIRE(w.size() == 105);
+    REQUIRE(w[3] == v[0]);
+    w.insert(w.end(), 200, record("y"));
+    REQUIRE(w.size() == 305);
+    REQUIRE(w.back() == record("y"));
+}
+
+namespace {
+// Owns an int like unique_ptr, and counts moves and frees.
+struct handle {
+    static int moves;
+    static int frees;
+    int* p;
+
+    explicit handle(int v) : p(new int(v)) {}
+    handle(handle&& x) noexcept : p(x.p) {
+        x.p = nullptr;
+        ++moves;
+    }
+    handle(const handle&) = delete;
+    handle& operator=(handle&& x) noexcept {
+        std::swap(p, x.p);
+        ++moves;
+        return *this;
+    }
+    ~handle() {
+        if (p != nullptr) ++frees;
+        delete p;
+    }
+};
+int handle::moves = 0;
+int handle::frees = 0;
+}
+
+template <>
+struct _Is_trivially_relocatable<handle> {
+    using _Relocatable = _true_type;
+};
+
+TEST_CASE("vector relocates trivially relocatable elements", "[stl_vector]") {
+    {
+        vector<handle> v;
+        for (int i = 0; i < 1024; ++i) v.emplace_back(i);
+        v.emplace(v.begin(), -1);
+        v.reserve(5000);
+        // Growing copied bytes: no moves, and nothing freed twice.
+        REQUIRE(handle::moves == 0);
+        REQUIRE(handle::frees == 0);
+        REQUIRE(*v[0].p == -1);
+        REQUIRE(*v[1024].p == 1023);
+    }
+    REQUIRE(handle::frees == 1025);
+}
+
+TEST_CASE("vector appends an element of its own while growing", "[stl_vector]") {
+    vector<int> v;
+    v.push_back(7);
+    for (int i = 0; i < 20; ++i) v.push_back(v[0]);
+    v.insert(v.end(), v.size(), v.back());
+    REQUIRE(v.size() == 42);
+    REQUIRE(v[41] == 7);
+
+    vector<handle> h;
+    h.emplace_back(5);
+    for (int i = 0; i < 20; ++i) h.emplace_back(*h[0].p);
+    REQUIRE(*h[20].p == 5);
+}
+
+// The capacities v goes through while n elements are pushed.
+template <typename Vector>
+static std::vector<size_t> capacities(Vector& v, size_t n) {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < n; ++i) {
+        v.push_back(0);
+        if (result.empty() || result.back() != v.capacity()) result.push_back(v.capacity());
+    }
+    return result;
+}
+
+TEST_CASE("vector growth policies", "[stl_vector]") {
+    vector<int> doubling;
+    REQUIRE(capacities(doubling, 20) == std::vector<size_t>{1, 2, 4, 8, 16, 32});
+    vector<int, alloc, grow_by_half> half;
+    REQUIRE(capacities(half, 19) == std::vector<size_t>{1, 2, 3, 4, 6, 9, 13, 19});
+
+    // Small buffers fill their size class ...
+    vector<int, alloc, grow_to_fit_allocator> fit;
+    fit.push_back(0);
+    REQUIRE(fit.capacity() == alloc::good_size(sizeof(int)) / sizeof(int));
+    // ... and large ones whole pages.
+    capacities(fit, 100000);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    REQUIRE((fit.capacity() * sizeof(int) + 16) % page == 0);
+
+    // Growth by n at once takes at least n.
+    vector<int, alloc, grow_by_half> bulk(10, 1);
+    bulk.insert(bulk.end(), 100, 2);
+    REQUIRE(bulk.capacity() >= 110);
+    REQUIRE(bulk[109] == 2);
+
+    vector<bool, alloc, grow_by_half> bits;
+    for (int i = 0; i < 1000; ++i) bits.push_back(i % 3 == 0);
+    REQUIRE(bits.size() == 1000);
+    REQUIRE(bits[999]);
+    REQUIRE(!bits[998]);
+}
+
+TEST_CASE("vector shrink_to_fit", "[stl_vector]") {
+    vector<int> v(100, 1);
+    v.reserve(1000);
+    v.shrink_to_fit();
+    REQUIRE(v.capacity() == 100);
+    REQUIRE(v[99] == 1);
+    v.clear();
+    v.shrink_to_fit();
+    REQUIRE(v.capacity() == 0);
+
+    vector<record> r;
+    for (int i = 0; i < 5; ++i) r.push_back("abc");
+    r.shrink_to_fit();
+    REQUIRE(r.capacity() == 5);
+    REQUIRE(r[4] == record("abc"));
+
+    vector<bool> b(100, true);
+    b.reserve(10000);
+    b.shrink_to_fit();
+    REQUIRE(b.capacity() == (100 + WORD_BIT - 1) / WORD_BIT * WORD_BIT);
+    REQUIRE(b[99]);
+
+    // Range inserts that grow a vector<bool> keep the range.
+    bool src[] = {true, false, true};
+    vector<bool> c;
+    c.insert(c.end(), src, src + 3);
+    REQUIRE(c.size() == 3);
+    REQUIRE((c[0] && !c[1] && c[2]));
+}
+
+namespace {
+// A malloc-backed allocator with state, so that a vector keeps an
+// instance of it and reallocates through allocate and deallocate.
+template <typename T>
+struct counting_allocator {
+    template <typename U>
+    struct rebind {
+        using other = counting_allocator<U>;
+    };
+    size_t* bytes;  // outstanding
+
+    explicit counting_allocator(size_t* b) : bytes(b) {}
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& x) : bytes(x.bytes) {}
+
+    T* allocate(size_t n) {
+        *bytes += n * sizeof(T);
+        return (T*)malloc(n * sizeof(T));
+    }
+    void deallocate(T* p, size_t n) {
+        *bytes -= n * sizeof(T);
+        free(p);
+    }
+};
+}
+
+TEST_CASE("vector shrink_to_fit with a stateful allocator", "[stl_vector]") {
+    size_t bytes = 0;
+    {
+        vector<int, counting_allocator<int>> v{counting_allocator<int>(&bytes)};
+        for (int i = 0; i < 1000; ++i) v.push_back(i);
+        v.resize(3);
+        v.shrink_to_fit();
+        REQUIRE(v.capacity() == 3);
+        REQUIRE(bytes == 3 * sizeof(int));
+        REQUIRE((v[0] == 0 && v[1] == 1 && v[2] == 2));
+        v.reserve(500);
+        REQUIRE(v[2] == 2);
+    }
+    REQUIRE(bytes == 0);
+}
+
+namespace {
+// Fills the blocks it hands out with 0xa5 bytes, so that elements left
+// default-initialized show the pattern.
+template <typename T>
+struct patterned_allocator {
+    template <typename U>
+    struct rebind {
+        using other = patterned_allocator<U>;
+    };
+
+    patterned_allocator() {}
+    template <typename U>
+    patterned_allocator(const patterned_allocator<U>&) {}
+
+    T* allocate(size_t n) {
+        void* p = malloc(n * sizeof(T));
+        memset(p, 0xa5, n * sizeof(T));
+        return (T*)p;
+    }
+    void deallocate(T* p, size_t) { free(p); }
+};
+
+struct defaulted {
+    static int constructed;
+    int value;
+    defaulted() : value(5) { ++constructed; }
+};
+int defaulted::constructed = 0;
+}
+
+TEST_CASE("vector default-initialization", "[stl_vector]") {
+    int pattern;
+    memset(&pattern, 0xa5, sizeof pattern);
+
+    // default_init leaves the bytes as the allocator returned them.
+    vector<int, patterned_allocator<int>> v(16, default_init);
+    REQUIRE(v.size() == 16);
+    for (int i = 0; i < 16; ++i) REQUIRE(v[i] == pattern);
+
+    v[0] = 1;
+    v.resize_default_init(4);
+    REQUIRE(v.size() == 4);
+    v.resize_default_init(1000);
+    REQUIRE(v.size() == 1000);
+    REQUIRE(v.capacity() >= 1000);
+    REQUIRE(v[0] == 1);
+    REQUIRE(v[4] == pattern);
+    REQUIRE(v[999] == pattern);
+    v[999] = 1;
+    v.resize_default_init(1000);
+    REQUIRE(v[999] == 1);
+    // resize still value-initializes.
+    v.resize(1001);
+    REQUIRE(v[1000] == 0);
+
+    // Elements with a default constructor still get it.
+    defaulted::constructed = 0;
+    vector<defaulted, patterned_allocator<defaulted>> d(3, default_init);
+    d.resize_default_init(10);
+    REQUIRE(defaulted::constructed == 10);
+    REQUIRE(d[9].value == 5);
+}
+
+SHADOW_STL_END_NAMESPACE